@@ -0,0 +1,160 @@
+#include "bench.h"
+
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "ray_trace/real.h"
+
+
+static const char* getSimdName()
+{
+#if defined(__AVX512F__)
+  return "avx512";
+#elif defined(__AVX2__)
+  return "avx2";
+#else
+  return "scalar";
+#endif
+}
+
+static void writeJsonString(FILE* file, const std::string& str)
+{
+  fputc('"', file);
+  for (char ch : str)
+  {
+    if (ch == '"' || ch == '\\')
+      fputc('\\', file);
+    fputc(ch, file);
+  }
+  fputc('"', file);
+}
+
+void BenchReport::writeJson(FILE* file) const
+{
+  fprintf(file, "{\n");
+#ifdef _DEBUG
+  fprintf(file, "  \"build\": \"debug\",\n");
+#else
+  fprintf(file, "  \"build\": \"release\",\n");
+#endif
+  fprintf(file, "  \"simd\": \"%s\",\n", getSimdName());
+  fprintf(file, "  \"precision\": \"%s\",\n",
+          sizeof(real) == sizeof(float) ? "float" : "double");
+  fprintf(file, "  \"peak_rss_kb\": %ld,\n", getPeakRssKb());
+
+  fprintf(file, "  \"micro\": [");
+  for (size_t i = 0; i < m_micro.size(); ++i)
+  {
+    const MicroResult& result = m_micro[i];
+    fprintf(file, "%s\n    {\"name\": ", i > 0 ? "," : "");
+    writeJsonString(file, result.name);
+    fprintf(file, ", \"iterations\": %zu, \"ns_per_op\": %.3f}",
+            result.iterations, result.nsPerOp);
+  }
+  fprintf(file, "%s],\n", m_micro.empty() ? "" : "\n  ");
+
+  fprintf(file, "  \"scenes\": [");
+  for (size_t i = 0; i < m_scenes.size(); ++i)
+  {
+    const SceneResult& result = m_scenes[i];
+    fprintf(file, "%s\n    {\"name\": ", i > 0 ? "," : "");
+    writeJsonString(file, result.name);
+    fprintf(file,
+            ", \"objects\": %zu, \"lights\": %s, \"light_samples\": %zu,"
+            " \"reflections\": %s, \"reflection_cutoff\": %.6f,"
+            " \"engine\": \"%s\", \"sorted_rays\": %s,"
+            " \"path_tracing\": %s,"
+            " \"width\": %zu, \"height\": %zu, \"spp\": %zu,"
+            " \"frames\": %zu, \"threads\": %zu,"
+            " \"bvh_build_ms\": %.3f, \"light_list_ms\": %.3f,"
+            " \"frame_ms\": %.3f, \"trace_ms\": %.3f,"
+            " \"mrays_per_s\": %.6f, \"ns_per_pixel\": %.1f,",
+            result.objects,
+            result.lights      ? "true" : "false",
+            result.lightSamples,
+            result.reflections ? "true" : "false",
+            result.reflectionCutoff,
+            result.wavefront  ? "wavefront" : "depth_first",
+            result.sortedRays ? "true" : "false",
+            result.pathTracing ? "true" : "false",
+            result.width, result.height, result.samplesPerPixel,
+            result.frames, result.threads,
+            result.buildMs, result.lightsMs, result.frameMs, result.traceMs,
+            result.mraysPerSecond, result.nsPerPixel);
+
+    // Unknown count is null, not a number
+    if (result.cacheMisses >= 0)
+      fprintf(file, " \"cache_misses\": %lld,", result.cacheMisses);
+    else
+      fprintf(file, " \"cache_misses\": null,");
+
+    fprintf(file, " \"peak_rss_kb\": %ld}", result.peakRssKb);
+  }
+  fprintf(file, "%s],\n", m_scenes.empty() ? "" : "\n  ");
+
+  fprintf(file, "  \"loads\": [");
+  for (size_t i = 0; i < m_loads.size(); ++i)
+  {
+    const LoadResult& result = m_loads[i];
+    fprintf(file, "%s\n    {\"name\": ", i > 0 ? "," : "");
+    writeJsonString(file, result.name);
+    fprintf(file,
+            ", \"objects\": %zu, \"format\": \"%s\", \"file_bytes\": %zu,"
+            " \"load_ms\": %.3f, \"bvh_build_ms\": %.3f,"
+            " \"peak_rss_kb\": %ld}",
+            result.objects, result.compiled ? "compiled" : "text",
+            result.fileBytes, result.loadMs, result.buildMs,
+            result.peakRssKb);
+  }
+  fprintf(file, "%s]\n", m_loads.empty() ? "" : "\n  ");
+
+  fprintf(file, "}\n");
+}
+
+bool isSelected(const BenchOptions& options, const char* name)
+{
+  return options.filter == nullptr || strstr(name, options.filter) != nullptr;
+}
+
+long getPeakRssKb()
+{
+  struct rusage usage = {};
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return -1;
+
+  // Linux reports maximum resident set size in kilobytes
+  return usage.ru_maxrss;
+}
+
+CacheMissCounter::CacheMissCounter() :
+  m_fd(-1)
+{
+  perf_event_attr attributes = {};
+  attributes.type           = PERF_TYPE_HARDWARE;
+  attributes.size           = sizeof(attributes);
+  attributes.config         = PERF_COUNT_HW_CACHE_MISSES;
+  attributes.inherit        = 1;
+  attributes.exclude_kernel = 1;
+  attributes.exclude_hv     = 1;
+
+  // Count this thread on any CPU
+  m_fd = int(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+}
+
+CacheMissCounter::~CacheMissCounter()
+{
+  if (m_fd >= 0)
+    close(m_fd);
+}
+
+long long CacheMissCounter::read() const
+{
+  long long count = 0;
+  if (m_fd < 0 || ::read(m_fd, &count, sizeof(count)) != sizeof(count))
+    return -1;
+
+  return count;
+}
@@ -0,0 +1,183 @@
+/**
+ * @file bench.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Minimal benchmark harness with JSON reporting
+ *
+ * @version 0.1
+ * @date 2023-09-27
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __BENCH_BENCH_H
+#define __BENCH_BENCH_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Keep compiler from optimizing away computation of `value`
+ */
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct MicroResult
+{
+  std::string name;
+  size_t      iterations;
+  double      nsPerOp;
+};
+
+struct SceneResult
+{
+  std::string name;
+  size_t      objects;
+  bool        lights;
+  size_t      lightSamples;
+  bool        reflections;
+  double      reflectionCutoff;
+  bool        wavefront;
+  bool        sortedRays;
+  bool        pathTracing;
+  size_t      width;
+  size_t      height;
+  size_t      samplesPerPixel;
+  size_t      frames;
+  size_t      threads;
+  double      buildMs;
+  double      lightsMs;
+  double      frameMs;
+  double      traceMs;
+  double      mraysPerSecond;
+  double      nsPerPixel;
+  long long   cacheMisses;
+  long        peakRssKb;
+};
+
+struct LoadResult
+{
+  std::string name;
+  size_t      objects;
+  bool        compiled;
+  size_t      fileBytes;
+  double      loadMs;
+  double      buildMs;
+  long        peakRssKb;
+};
+
+struct BenchOptions
+{
+  const char* filter;
+  const char* output;
+  size_t      width;
+  size_t      height;
+  size_t      samples;
+  size_t      frames;
+  size_t      threads;
+  size_t      maxObjects;
+  double      minTime;
+  bool        wavefront;
+};
+
+class BenchReport
+{
+public:
+  BenchReport() : m_micro(), m_scenes(), m_loads() {}
+
+  BenchReport(const BenchReport& other) = delete;
+  BenchReport& operator=(const BenchReport& other) = delete;
+
+  ~BenchReport() = default;
+
+  void add(const MicroResult& result) { m_micro.push_back(result); }
+  void add(const SceneResult& result) { m_scenes.push_back(result); }
+  void add(const LoadResult&  result) { m_loads .push_back(result); }
+
+  /**
+   * @brief Write all results as a single JSON object
+   */
+  void writeJson(FILE* file) const;
+
+private:
+  std::vector<MicroResult> m_micro;
+  std::vector<SceneResult> m_scenes;
+  std::vector<LoadResult>  m_loads;
+};
+
+/**
+ * @brief `true` if benchmark `name` is selected by `options`
+ */
+bool isSelected(const BenchOptions& options, const char* name);
+
+/**
+ * @brief Peak resident set size of this process, in kilobytes
+ */
+long getPeakRssKb();
+
+/**
+ * @brief Hardware counter of cache misses of this thread and threads it
+ * starts while counter exists. Counts are -1 where hardware counters are
+ * not available, as in most virtual machines.
+ */
+class CacheMissCounter
+{
+public:
+  CacheMissCounter();
+  CacheMissCounter(const CacheMissCounter& other) = delete;
+  CacheMissCounter& operator=(const CacheMissCounter& other) = delete;
+
+  ~CacheMissCounter();
+
+  /**
+   * @brief Misses counted so far. Started threads add their misses only
+   * once they exit.
+   */
+  long long read() const;
+
+private:
+  int m_fd;
+};
+
+/**
+ * @brief Call `body(batch)` with growing batch sizes until one call takes
+ * at least `min_time` seconds. `body` must perform `batch` operations.
+ */
+template <typename Body>
+MicroResult runMicro(const char* name, double min_time, Body&& body)
+{
+  using Clock = std::chrono::steady_clock;
+
+  // Warm up caches and branch predictors
+  body(size_t(1024));
+
+  size_t batch = 1024;
+  double elapsed = 0;
+  for (;;)
+  {
+    const Clock::time_point start = Clock::now();
+    body(batch);
+    elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    if (elapsed >= min_time)
+      break;
+
+    // Aim slightly above `min_time` on next attempt
+    const double scale = elapsed > 0 ? 1.5 * min_time / elapsed : 16;
+    batch = size_t(double(batch) * (scale < 16 ? (scale > 2 ? scale : 2)
+                                               : 16));
+  }
+
+  return MicroResult{name, batch, elapsed / double(batch) * 1e9};
+}
+
+void runMicroBenchmarks(const BenchOptions& options, BenchReport& report);
+void runSceneBenchmarks(const BenchOptions& options, BenchReport& report);
+void runLoadBenchmarks (const BenchOptions& options, BenchReport& report);
+
+#endif /* bench.h */
@@ -0,0 +1,108 @@
+#include "bench.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ray_trace/bvh.h"
+#include "ray_trace/scene.h"
+#include "ray_trace/scene_file.h"
+#include "procedural_scene.h"
+
+static LoadResult runLoad(const char* name, const char* path, size_t count,
+                          bool compiled);
+
+void runLoadBenchmarks(const BenchOptions& options, BenchReport& report)
+{
+  static const size_t counts[] = {1000, 100000, 1000000};
+
+  for (size_t count : counts)
+  {
+    if (count > options.maxObjects)
+      continue;
+
+    const std::string text_name     = "load_text_"     + std::to_string(count);
+    const std::string compiled_name = "load_compiled_" + std::to_string(count);
+    const bool run_text     = isSelected(options, text_name.c_str());
+    const bool run_compiled = isSelected(options, compiled_name.c_str());
+    if (!run_text && !run_compiled)
+      continue;
+
+    char text_path[] = "/tmp/ray_trace_bench_XXXXXX";
+    const int fd = mkstemp(text_path);
+    if (fd < 0)
+    {
+      fprintf(stderr, "Failed to create temporary scene file\n");
+      return;
+    }
+    close(fd);
+    const std::string compiled_path = std::string(text_path) + ".bin";
+
+    // Both files are written from the same scene and stay in page cache,
+    // so only parsing and mapping are compared
+    {
+      std::unique_ptr<Scene> scene(new Scene(Camera(Transform(Vec(0, 0, 0)))));
+      populateSpheres(*scene, count, true, true);
+      if (!writeSceneText(text_path, *scene)
+       || !writeCompiledScene(compiled_path.c_str(), *scene))
+        fprintf(stderr, "Failed to write scene files\n");
+    }
+
+    if (run_text)
+      report.add(runLoad(text_name.c_str(), text_path, count, false));
+    if (run_compiled)
+      report.add(runLoad(compiled_name.c_str(), compiled_path.c_str(), count,
+                         true));
+
+    remove(text_path);
+    remove(compiled_path.c_str());
+  }
+}
+
+static LoadResult runLoad(const char* name, const char* path, size_t count,
+                          bool compiled)
+{
+  using Clock = std::chrono::steady_clock;
+
+  fprintf(stderr, "%-34s", name);
+
+  std::unique_ptr<Scene> scene(new Scene(Camera(Transform(Vec(0, 0, 0)))));
+  const Clock::time_point load_start = Clock::now();
+  const bool loaded = compiled ? mapCompiledScene(path, *scene)
+                               : readSceneText   (path, *scene);
+  const Clock::time_point load_end = Clock::now();
+
+  // Mapped objects are paged in on first use, so hierarchy build, which
+  // touches every object, is part of the cost of loading
+  double build_time = 0;
+  {
+    Bvh bvh;
+    const Clock::time_point start = Clock::now();
+    bvh.build(*scene);
+    build_time = std::chrono::duration<double>(Clock::now() - start).count();
+  }
+
+  const double load_time =
+                  std::chrono::duration<double>(load_end - load_start).count();
+  if (!loaded || scene->objectCount() != count)
+    fprintf(stderr, "failed to load '%s'\n", path);
+  else
+    fprintf(stderr, "%12.3f ms load %12.3f ms build\n",
+            load_time * 1e3, build_time * 1e3);
+
+  struct stat file_stat = {};
+  stat(path, &file_stat);
+
+  return LoadResult{
+    .name      = name,
+    .objects   = scene->objectCount(),
+    .compiled  = compiled,
+    .fileBytes = size_t(file_stat.st_size),
+    .loadMs    = load_time * 1e3,
+    .buildMs   = build_time * 1e3,
+    .peakRssKb = getPeakRssKb()
+  };
+}
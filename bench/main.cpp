@@ -0,0 +1,133 @@
+/**
+ * @file main.cpp
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Benchmark runner. Progress goes to stderr, JSON report goes to
+ * stdout or to file given with `-o`.
+ *
+ * @version 0.1
+ * @date 2023-09-27
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+#include "bench.h"
+
+static void printUsage(const char* program);
+static bool parseSize(const char* str, size_t& value);
+static bool parseOptions(int argc, char** argv, BenchOptions& options);
+
+int main(int argc, char** argv)
+{
+  BenchOptions options = {
+    .filter     = nullptr,
+    .output     = nullptr,
+    .width      = 128,
+    .height     = 80,
+    .samples    = 1,
+    .frames     = 3,
+    .threads    = 0,
+    .maxObjects = 1000000,
+    .minTime    = 0.2,
+    .wavefront  = false
+  };
+
+  if (!parseOptions(argc, argv, options))
+  {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+#ifdef _DEBUG
+  fprintf(stderr, "Warning: benchmarking debug build, "
+                  "use 'make BUILDTYPE=Release bench'\n");
+#endif
+
+  BenchReport report;
+  runMicroBenchmarks(options, report);
+  runSceneBenchmarks(options, report);
+  runLoadBenchmarks (options, report);
+
+  FILE* output = options.output ? fopen(options.output, "w") : stdout;
+  if (!output)
+  {
+    fprintf(stderr, "Failed to open '%s'\n", options.output);
+    return 1;
+  }
+
+  report.writeJson(output);
+
+  if (output != stdout)
+    fclose(output);
+
+  return 0;
+}
+
+static void printUsage(const char* program)
+{
+  fprintf(stderr,
+    "Usage: %s [options]\n"
+    "  -f FILTER   run only benchmarks with FILTER in their name\n"
+    "  -o FILE     write JSON report to FILE instead of stdout\n"
+    "  -w WIDTH    image width for scene benchmarks (default 128)\n"
+    "  -h HEIGHT   image height for scene benchmarks (default 80)\n"
+    "  -s SAMPLES  samples per pixel, a perfect square (default 1)\n"
+    "  -n FRAMES   frames rendered per scene (default 3)\n"
+    "  -t THREADS  render threads, 0 for all cores (default 0)\n"
+    "  -m OBJECTS  skip scenes with more than OBJECTS spheres"
+                   " (default 1000000)\n"
+    "  -q          quick run, shorter microbenchmarks\n"
+    "  -W          render scenes with wavefront engine\n",
+    program);
+}
+
+static bool parseSize(const char* str, size_t& value)
+{
+  char* end = nullptr;
+  const unsigned long long parsed = strtoull(str, &end, 10);
+  if (end == str || *end != '\0')
+    return false;
+
+  value = size_t(parsed);
+  return true;
+}
+
+static bool parseOptions(int argc, char** argv, BenchOptions& options)
+{
+  int option = 0;
+  while ((option = getopt(argc, argv, "f:o:w:h:s:n:t:m:qW")) != -1)
+  {
+    bool valid = true;
+    switch (option)
+    {
+    case 'f': options.filter = optarg; break;
+    case 'o': options.output = optarg; break;
+    case 'w': valid = parseSize(optarg, options.width);      break;
+    case 'h': valid = parseSize(optarg, options.height);     break;
+    case 's': valid = parseSize(optarg, options.samples);    break;
+    case 'n': valid = parseSize(optarg, options.frames);     break;
+    case 't': valid = parseSize(optarg, options.threads);    break;
+    case 'm': valid = parseSize(optarg, options.maxObjects); break;
+    case 'q': options.minTime = 0.02; break;
+    case 'W': options.wavefront = true; break;
+    default:  return false;
+    }
+
+    if (!valid)
+      return false;
+  }
+
+  if (options.width == 0 || options.height == 0 || options.frames == 0)
+    return false;
+
+  size_t grid = 1;
+  while (grid * grid < options.samples)
+    ++grid;
+  if (options.samples == 0 || grid * grid != options.samples)
+    return false;
+
+  return optind == argc;
+}
@@ -0,0 +1,308 @@
+#include "bench.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "ray_trace/bounds.h"
+#include "ray_trace/camera.h"
+#include "ray_trace/matrix.h"
+#include "ray_trace/ray.h"
+#include "ray_trace/ray_packet.h"
+#include "ray_trace/render_plane.h"
+#include "ray_trace/scene.h"
+#include "ray_trace/transform.h"
+#include "ray_trace/vec.h"
+#include "procedural_scene.h"
+
+static constexpr size_t INPUT_COUNT = 1024;
+
+static std::vector<Ray> getRays(uint64_t seed);
+static std::vector<Vec> getVecs(uint64_t seed);
+
+/**
+ * @brief Sources and directions of `rays`, interleaved, in precision `T`
+ */
+template <typename T>
+static std::vector<VecT<T>> convertVecs(const std::vector<Ray>& rays)
+{
+  std::vector<VecT<T>> vecs;
+  vecs.reserve(2 * rays.size());
+  for (const Ray& ray : rays)
+  {
+    vecs.push_back(VecT<T>(ray.source()));
+    vecs.push_back(VecT<T>(ray.direction()));
+  }
+
+  return vecs;
+}
+
+void runMicroBenchmarks(const BenchOptions& options, BenchReport& report)
+{
+  const std::vector<Ray> rays = getRays(1);
+  const std::vector<Vec> vecs = getVecs(2);
+
+  // Object-space shapes: identity transform leaves only the hit kernel
+  Scene shapes(Camera(Transform(Vec(0, 0, 0))));
+  const uint32_t white = shapes.addMaterial(Material(1, Color::White));
+  const size_t sphere = shapes.addObject(
+      SceneObject(ObjectType::Sphere, white,
+                  Transform(Vec(0, 0, 0))));
+  const size_t plane = shapes.addObject(
+      SceneObject(ObjectType::Plane, white,
+                  Transform(Vec(0, -1, 0))));
+  const size_t box = shapes.addObject(
+      SceneObject(ObjectType::Box, white,
+                  Transform(Vec(0, 0, 0))));
+
+  Transform ellipsoid_transform(Vec(0.1, -0.2, 0.3), Vec(0.8, 0.8, 1.5));
+  ellipsoid_transform.rotate(Vec::UNIT_X, -45);
+  ellipsoid_transform.rotate(Vec::UNIT_Y, -75);
+  const size_t ellipsoid = shapes.addObject(
+      SceneObject(ObjectType::Sphere, white,
+                  ellipsoid_transform));
+
+  auto run = [&options, &report](const char* name, auto&& body)
+  {
+    if (!isSelected(options, name))
+      return;
+
+    fprintf(stderr, "%-28s", name);
+    const MicroResult result = runMicro(name, options.minTime, body);
+    fprintf(stderr, "%10.2f ns/op\n", result.nsPerOp);
+    report.add(result);
+  };
+
+  run("hitSphere", [&](size_t batch)
+  {
+    for (size_t i = 0; i < batch; ++i)
+      doNotOptimize(rays[i % INPUT_COUNT].getRayHit(shapes, sphere));
+  });
+
+  run("hitPlane", [&](size_t batch)
+  {
+    for (size_t i = 0; i < batch; ++i)
+      doNotOptimize(rays[i % INPUT_COUNT].getRayHit(shapes, plane));
+  });
+
+  run("hitBox", [&](size_t batch)
+  {
+    for (size_t i = 0; i < batch; ++i)
+      doNotOptimize(rays[i % INPUT_COUNT].getRayHit(shapes, box));
+  });
+
+  run("getRayHit", [&](size_t batch)
+  {
+    for (size_t i = 0; i < batch; ++i)
+      doNotOptimize(rays[i % INPUT_COUNT].getRayHit(shapes, ellipsoid));
+  });
+
+  run("packet/hitSphere", [&](size_t batch)
+  {
+    RayPacket packet;
+    for (size_t i = 0; i < batch; i += RayPacket::SIZE)
+    {
+      packet.setRays(&rays[i % INPUT_COUNT], Real8::ALL_MASK);
+      PacketHit hit;
+      packet.intersect(shapes, ellipsoid, Real8::ALL_MASK, hit);
+      doNotOptimize(hit);
+    }
+  });
+
+  run("packet/hitBox", [&](size_t batch)
+  {
+    RayPacket packet;
+    for (size_t i = 0; i < batch; i += RayPacket::SIZE)
+    {
+      packet.setRays(&rays[i % INPUT_COUNT], Real8::ALL_MASK);
+      PacketHit hit;
+      packet.intersect(shapes, box, Real8::ALL_MASK, hit);
+      doNotOptimize(hit);
+    }
+  });
+
+  // Eight unit boxes along x axis, half of rays hit some of them
+  std::vector<Bounds> boxes;
+  std::vector<real>   box_coords(6 * RayPacket::SIZE);
+  for (size_t i = 0; i < RayPacket::SIZE; ++i)
+  {
+    const Bounds bounds = Bounds::fromCenter(Point(real(i) - 3.5, 0, 0),
+                                             Vec(0.5, 0.5, 0.5));
+    boxes.push_back(bounds);
+    box_coords[0 * RayPacket::SIZE + i] = bounds.min().m_x;
+    box_coords[1 * RayPacket::SIZE + i] = bounds.min().m_y;
+    box_coords[2 * RayPacket::SIZE + i] = bounds.min().m_z;
+    box_coords[3 * RayPacket::SIZE + i] = bounds.max().m_x;
+    box_coords[4 * RayPacket::SIZE + i] = bounds.max().m_y;
+    box_coords[5 * RayPacket::SIZE + i] = bounds.max().m_z;
+  }
+  const BoundsPack box_pack = BoundsPack::load(box_coords.data(),
+                                               RayPacket::SIZE);
+
+  std::vector<Vec> inv_directions;
+  inv_directions.reserve(INPUT_COUNT);
+  for (size_t i = 0; i < INPUT_COUNT; ++i)
+    inv_directions.push_back(
+        Bounds::getInverseDirection(rays[i].direction()));
+
+  run("Bounds::clip*8", [&](size_t batch)
+  {
+    for (size_t i = 0; i < batch; ++i)
+    {
+      LaneMask mask = 0;
+      for (size_t j = 0; j < boxes.size(); ++j)
+      {
+        real t_entry = 0;
+        real t_exit  = 0;
+        if (boxes[j].clip(rays[i % INPUT_COUNT].source(),
+                          inv_directions[i % INPUT_COUNT], INFINITY,
+                          t_entry, t_exit))
+          mask |= LaneMask(1) << j;
+      }
+      doNotOptimize(mask);
+    }
+  });
+
+  run("BoundsPack::intersect", [&](size_t batch)
+  {
+    for (size_t i = 0; i < batch; ++i)
+      doNotOptimize(box_pack.intersect(rays[i % INPUT_COUNT].source(),
+                                       inv_directions[i % INPUT_COUNT],
+                                       INFINITY));
+  });
+
+  // Primary rays of a 640x480 image, as before and after precomputing
+  // camera basis
+  const Camera camera(Transform(Vec(0.5, 1, -3)), 60);
+  const RenderPlane render_plane(camera, 640, 480, 3.0/640);
+
+  run("Camera::getDirectionAt", [&](size_t batch)
+  {
+    for (size_t i = 0; i < batch; ++i)
+      doNotOptimize(camera.getDirectionAt(double(i % 640) / 320 - 1,
+                                          double(i / 640 % 480) / 320));
+  });
+
+  run("RenderPlane::getRayFrom", [&](size_t batch)
+  {
+    for (size_t i = 0; i < batch; ++i)
+      doNotOptimize(render_plane.getRayFrom(double(i % 640),
+                                            double(i / 640 % 480)));
+  });
+
+  run("RenderPlane::getPacketFrom", [&](size_t batch)
+  {
+    RayPacket        packet;
+    std::vector<Ray> packet_rays;
+    real x[RayPacket::SIZE];
+    real y[RayPacket::SIZE];
+    for (size_t i = 0; i < batch; i += RayPacket::SIZE)
+    {
+      for (size_t lane = 0; lane < RayPacket::SIZE; ++lane)
+      {
+        x[lane] = real((i + lane) % 640);
+        y[lane] = real((i + lane) / 640 % 480);
+      }
+      render_plane.getPacketFrom(x, y, Real8::ALL_MASK, packet, packet_rays);
+      doNotOptimize(packet);
+    }
+  });
+
+  // Same kernel in both precisions, regardless of `real`
+  const std::vector<VecT<float>>  float_vecs  = convertVecs<float> (rays);
+  const std::vector<VecT<double>> double_vecs = convertVecs<double>(rays);
+
+  run("intersectUnitSphere<float>", [&](size_t batch)
+  {
+    for (size_t i = 0; i < batch; ++i)
+      doNotOptimize(intersectUnitSphere(float_vecs[2*(i % INPUT_COUNT)],
+                                        float_vecs[2*(i % INPUT_COUNT) + 1],
+                                        float(render_margin)));
+  });
+
+  run("intersectUnitSphere<double>", [&](size_t batch)
+  {
+    for (size_t i = 0; i < batch; ++i)
+      doNotOptimize(intersectUnitSphere(double_vecs[2*(i % INPUT_COUNT)],
+                                        double_vecs[2*(i % INPUT_COUNT) + 1],
+                                        double(render_margin)));
+  });
+
+  run("Matrix::getInverse", [&](size_t batch)
+  {
+    const Matrix& matrix = ellipsoid_transform.matrix();
+    for (size_t i = 0; i < batch; ++i)
+    {
+      Matrix copy = matrix;
+      doNotOptimize(copy);
+      doNotOptimize(copy.getInverse());
+    }
+  });
+
+  run("Vec::dotProduct", [&](size_t batch)
+  {
+    for (size_t i = 0; i < batch; ++i)
+      doNotOptimize(Vec::dotProduct(vecs[i % INPUT_COUNT],
+                                    vecs[(i + 1) % INPUT_COUNT]));
+  });
+
+  run("Vec::crossProduct", [&](size_t batch)
+  {
+    for (size_t i = 0; i < batch; ++i)
+      doNotOptimize(Vec::crossProduct(vecs[i % INPUT_COUNT],
+                                      vecs[(i + 1) % INPUT_COUNT]));
+  });
+
+  run("Vec::normalized", [&](size_t batch)
+  {
+    for (size_t i = 0; i < batch; ++i)
+      doNotOptimize(vecs[i % INPUT_COUNT].normalized());
+  });
+
+  run("Vec::operator+*", [&](size_t batch)
+  {
+    for (size_t i = 0; i < batch; ++i)
+      doNotOptimize(vecs[i % INPUT_COUNT]
+                  + vecs[(i + 1) % INPUT_COUNT] * 0.5);
+  });
+
+  run("Matrix*Vec", [&](size_t batch)
+  {
+    const Matrix& matrix = ellipsoid_transform.matrix();
+    for (size_t i = 0; i < batch; ++i)
+      doNotOptimize(matrix * vecs[i % INPUT_COUNT]);
+  });
+}
+
+static std::vector<Ray> getRays(uint64_t seed)
+{
+  // Rays start around unit shapes and aim near their center, so that
+  // roughly half of them hit
+  SplitMix64 random(seed);
+  std::vector<Ray> rays;
+  rays.reserve(INPUT_COUNT + RayPacket::SIZE);
+  for (size_t i = 0; i < INPUT_COUNT + RayPacket::SIZE; ++i)
+  {
+    const Vec source(random.uniform(-3, 3),
+                     random.uniform(-3, 3),
+                     random.uniform(-8, -4));
+    const Vec target(random.uniform(-1.5, 1.5),
+                     random.uniform(-1.5, 1.5),
+                     random.uniform(-1.5, 1.5));
+    rays.push_back(Ray(source, target - source));
+  }
+
+  return rays;
+}
+
+static std::vector<Vec> getVecs(uint64_t seed)
+{
+  SplitMix64 random(seed);
+  std::vector<Vec> vecs;
+  vecs.reserve(INPUT_COUNT);
+  for (size_t i = 0; i < INPUT_COUNT; ++i)
+    vecs.push_back(Vec(random.uniform(-10, 10),
+                       random.uniform(-10, 10),
+                       random.uniform(-10, 10)));
+
+  return vecs;
+}
@@ -0,0 +1,253 @@
+#include "procedural_scene.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "ray_trace/color.h"
+#include "ray_trace/material.h"
+#include "ray_trace/scene_object.h"
+#include "ray_trace/transform.h"
+
+void populateSpheres(Scene& scene, size_t count, bool lights,
+                     bool reflections, uint64_t seed)
+{
+  constexpr double cube_side    = 6;
+  constexpr double cube_center  = 13;
+  constexpr size_t light_count  = 4;
+
+  SplitMix64 random(seed);
+
+  scene.camera() = Camera(Transform(Vec(0, 0, 0)), 30);
+  scene.ambientLight() = Color::White * 0.3;
+  scene.directedLight() = lights
+                        ? DirectedLight(Vec(0, -1, 1), Color::White * 1.5)
+                        : DirectedLight();
+
+  // Keep sphere density constant so that scenes differ in depth complexity
+  // rather than in how much of the screen is covered
+  const double spacing = cube_side / std::cbrt(double(count));
+  const double radius  = 0.35 * spacing;
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    const Vec position(random.uniform(-cube_side/2, cube_side/2),
+                       random.uniform(-cube_side/2, cube_side/2),
+                       random.uniform(-cube_side/2, cube_side/2)
+                       + cube_center);
+    const Color color = Color::fromNormalized(random.uniform(0.2, 1),
+                                              random.uniform(0.2, 1),
+                                              random.uniform(0.2, 1));
+    const double diffusion = reflections ? random.uniform(0.3, 1) : 1;
+
+    const bool is_light = lights && i < light_count;
+    const Material material = is_light
+                            ? Material(1, color, color)
+                            : Material(diffusion, color);
+
+    scene.addObject(SceneObject(ObjectType::Sphere,
+                                scene.addMaterial(material),
+                                Transform(position, Vec(radius,
+                                                        radius,
+                                                        radius))));
+  }
+}
+
+/**
+ * @brief Surface of revolution of polyline `profile` around y axis, given
+ * as (radius, height) pairs. Each segment of profile is split into `steps`
+ * rings of `segments` quads.
+ */
+static std::shared_ptr<const Mesh> makeLathe(const double (*profile)[2],
+                                             size_t profile_size,
+                                             size_t segments, size_t steps)
+{
+  std::vector<Point>    vertices;
+  std::vector<uint32_t> indices;
+
+  size_t ring_count = 0;
+  for (size_t i = 0; i + 1 < profile_size; ++i)
+  {
+    for (size_t step = 0; step < steps; ++step)
+    {
+      const double t      = double(step) / double(steps);
+      const double radius = profile[i][0] + t*(profile[i + 1][0] - profile[i][0]);
+      const double height = profile[i][1] + t*(profile[i + 1][1] - profile[i][1]);
+      for (size_t j = 0; j < segments; ++j)
+      {
+        const double angle = 2 * M_PI * double(j) / double(segments);
+        vertices.push_back(Point(radius * cos(angle), height,
+                                 radius * sin(angle)));
+      }
+      ++ring_count;
+    }
+  }
+
+  // Profile ends on the axis, last ring collapses into apex
+  const uint32_t apex = uint32_t(vertices.size());
+  vertices.push_back(Point(0, profile[profile_size - 1][1], 0));
+
+  for (size_t ring = 0; ring < ring_count; ++ring)
+  {
+    for (size_t j = 0; j < segments; ++j)
+    {
+      const uint32_t a = uint32_t(ring * segments + j);
+      const uint32_t b = uint32_t(ring * segments + (j + 1) % segments);
+      if (ring + 1 == ring_count)
+      {
+        indices.insert(indices.end(), {a, b, apex});
+        continue;
+      }
+
+      const uint32_t c = uint32_t(a + segments);
+      const uint32_t d = uint32_t(b + segments);
+      indices.insert(indices.end(), {a, b, d, a, d, c});
+    }
+  }
+
+  std::shared_ptr<Mesh> mesh(new Mesh());
+  mesh->setTriangles(vertices, indices);
+  return mesh;
+}
+
+void populateForest(Scene& scene, size_t count, bool lights,
+                    bool reflections, uint64_t seed)
+{
+  constexpr double spacing = 1.5;
+  constexpr double ground  = -2;
+  constexpr size_t palette = 4;
+
+  // Trunk, then three stacked cones of needles
+  static const double profile[][2] = {
+    {0.12, 0.0}, {0.12, 0.5},
+    {0.80, 0.5}, {0.25, 1.1},
+    {0.65, 1.1}, {0.15, 1.7},
+    {0.45, 1.7}, {0.00, 2.3}
+  };
+
+  SplitMix64 random(seed);
+
+  scene.camera() = Camera(Transform(Vec(0, 0, 0)), 30);
+  scene.ambientLight() = Color::White * 0.3;
+  scene.directedLight() = lights
+                        ? DirectedLight(Vec(0, -1, 1), Color::White * 1.5)
+                        : DirectedLight();
+
+  const uint32_t tree = scene.addMesh(
+      makeLathe(profile, sizeof(profile) / sizeof(profile[0]), 64, 8));
+
+  uint32_t materials[palette] = {};
+  for (size_t i = 0; i < palette; ++i)
+  {
+    const Color color = Color::fromNormalized(random.uniform(0.1, 0.3),
+                                              random.uniform(0.4, 0.7),
+                                              random.uniform(0.1, 0.3));
+    const double diffusion = reflections ? random.uniform(0.5, 1) : 1;
+    materials[i] = scene.addMaterial(Material(diffusion, color));
+  }
+
+  scene.addObject(SceneObject(ObjectType::Plane,
+                              scene.addMaterial(Material(1, Color::White)),
+                              Transform(Vec(0, ground, 0))));
+
+  // Trees stand on a square grid, slightly jittered, starting in front of
+  // the camera
+  const size_t side = size_t(std::ceil(std::sqrt(double(count))));
+  for (size_t i = 0; i < count; ++i)
+  {
+    const double x = (double(i % side) - double(side) / 2) * spacing
+                   + random.uniform(-0.3, 0.3) * spacing;
+    const double z = 4 + double(i / side) * spacing
+                   + random.uniform(-0.3, 0.3) * spacing;
+    const double size = random.uniform(0.7, 1.3);
+
+    Transform transform(Vec(x, ground, z), Vec(size, size, size));
+    transform.rotate(Vec::UNIT_Y, random.uniform(0, 360));
+
+    scene.addObject(SceneObject(ObjectType::Mesh,
+                                materials[random.next() % palette],
+                                transform, tree));
+  }
+}
+
+void populateMirrors(Scene& scene, uint32_t mirror_depth, uint64_t seed)
+{
+  constexpr size_t sphere_count = 100;
+  constexpr double wall_offset  = 3;
+  constexpr double ground       = -2;
+
+  SplitMix64 random(seed);
+
+  scene.camera() = Camera(Transform(Vec(0, 0, 0)), 30);
+  scene.ambientLight() = Color::White * 0.2;
+  scene.directedLight() = DirectedLight(Vec(0.3, -1, 1), Color::White);
+
+  // Slightly tinted, so that each bounce loses a fifth of light
+  Material mirror(0.2, Color::fromNormalized(0.8, 0.9, 1));
+  mirror.setMaxReflections(mirror_depth);
+  const uint32_t mirror_material = scene.addMaterial(mirror);
+
+  for (double side : {-1.0, 1.0})
+  {
+    Transform transform(Vec(side * wall_offset, 0, 0));
+    transform.rotate(Vec::UNIT_Z, 90);
+    scene.addObject(SceneObject(ObjectType::Plane, mirror_material,
+                                transform));
+  }
+
+  scene.addObject(SceneObject(ObjectType::Plane,
+                              scene.addMaterial(Material(1, Color::White)),
+                              Transform(Vec(0, ground, 0))));
+
+  for (size_t i = 0; i < sphere_count; ++i)
+  {
+    const Vec position(random.uniform(-wall_offset + 0.5, wall_offset - 0.5),
+                       random.uniform(ground + 0.3, 1.5),
+                       random.uniform(4, 20));
+    const Color color = Color::fromNormalized(random.uniform(0.2, 1),
+                                              random.uniform(0.2, 1),
+                                              random.uniform(0.2, 1));
+    const double radius = random.uniform(0.15, 0.4);
+
+    scene.addObject(SceneObject(ObjectType::Sphere,
+                                scene.addMaterial(Material(1, color)),
+                                Transform(position, Vec(radius,
+                                                        radius,
+                                                        radius))));
+  }
+}
+
+void populateEmitters(Scene& scene, size_t emitter_count, uint64_t seed)
+{
+  constexpr size_t sphere_count = 1000;
+  constexpr double cube_side    = 6;
+  constexpr double cube_center  = 13;
+  constexpr double total_power  = 24;
+
+  populateSpheres(scene, sphere_count, false, false, seed);
+  scene.ambientLight() = Color::Black;
+
+  // Emitters get their own sequence, so diffuse spheres stay the same
+  SplitMix64 random(~seed);
+
+  const double radius = 0.1 * cube_side / std::cbrt(double(sphere_count));
+  const double power  = total_power / double(emitter_count);
+
+  for (size_t i = 0; i < emitter_count; ++i)
+  {
+    const Vec position(random.uniform(-cube_side/2, cube_side/2),
+                       random.uniform(-cube_side/2, cube_side/2),
+                       random.uniform(-cube_side/2, cube_side/2)
+                       + cube_center);
+    const Color glow = Color::fromNormalized(random.uniform(0.5, 1),
+                                             random.uniform(0.5, 1),
+                                             random.uniform(0.5, 1));
+
+    scene.addObject(SceneObject(ObjectType::Sphere,
+                                scene.addMaterial(Material(1, glow,
+                                                           glow * power)),
+                                Transform(position, Vec(radius,
+                                                        radius,
+                                                        radius))));
+  }
+}
@@ -0,0 +1,82 @@
+/**
+ * @file procedural_scene.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Reproducible generated scenes for benchmarks
+ *
+ * @version 0.1
+ * @date 2023-09-27
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __BENCH_PROCEDURAL_SCENE_H
+#define __BENCH_PROCEDURAL_SCENE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ray_trace/scene.h"
+
+/**
+ * @brief Small pseudo-random generator, produces the same sequence with
+ * every standard library
+ */
+class SplitMix64
+{
+public:
+  explicit SplitMix64(uint64_t seed) : m_state(seed) {}
+
+  uint64_t next()
+  {
+    uint64_t value = (m_state += 0x9E3779B97F4A7C15ull);
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+  }
+
+  /**
+   * @brief Uniformly distributed number in [`min`, `max`)
+   */
+  double uniform(double min, double max)
+  {
+    return min + (max - min) * double(next() >> 11) * 0x1.0p-53;
+  }
+
+private:
+  uint64_t m_state;
+};
+
+/**
+ * @brief Fill `scene` with `count` spheres scattered in a cube in front of
+ * the camera. With `lights` scene gets directed light and a few glowing
+ * spheres (included in `count`), otherwise only ambient light. With
+ * `reflections` spheres are partially reflective, otherwise fully diffuse.
+ */
+void populateSpheres(Scene& scene, size_t count, bool lights,
+                     bool reflections, uint64_t seed = 42);
+
+/**
+ * @brief Fill `scene` with `count` fir trees standing on a floor plane.
+ * All trees are instances of one mesh of a few thousand triangles and use
+ * a handful of shared materials. With `lights` scene gets directed light,
+ * with `reflections` trees are partially reflective.
+ */
+void populateForest(Scene& scene, size_t count, bool lights,
+                    bool reflections, uint64_t seed = 42);
+
+/**
+ * @brief Fill `scene` with 1000 diffuse spheres like `populateSpheres`,
+ * lit only by `emitter_count` small glowing spheres scattered among them.
+ * Total power of emitters does not depend on their count.
+ */
+void populateEmitters(Scene& scene, size_t emitter_count, uint64_t seed = 42);
+
+/**
+ * @brief Fill `scene` with two parallel mirror walls and 100 diffuse
+ * spheres between them, lit by directed light. Mirrors reflect up to
+ * `mirror_depth` times, other materials follow renderer's limit, so most
+ * rays bounce between the walls until their weight becomes negligible.
+ */
+void populateMirrors(Scene& scene, uint32_t mirror_depth, uint64_t seed = 42);
+
+#endif /* procedural_scene.h */
@@ -0,0 +1,343 @@
+#include "bench.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "ray_trace/bvh.h"
+#include "ray_trace/renderer.h"
+#include "ray_trace/scene.h"
+#include "procedural_scene.h"
+
+using PopulateFunction = void (*)(Scene& scene, size_t count, bool lights,
+                                  bool reflections, uint64_t seed);
+
+/**
+ * @brief Renderer settings of one scene benchmark
+ */
+struct SceneSettings
+{
+  bool   lights;
+  bool   reflections;
+  size_t lightSamples;
+  double reflectionCutoff;
+  bool   wavefront;
+  bool   sortRays;
+  bool   pathTracing;
+};
+
+static SceneResult runScene(const BenchOptions& options, const char* name,
+                            Scene& scene, const SceneSettings& settings);
+static void        printResult(const SceneResult& result);
+
+void runSceneBenchmarks(const BenchOptions& options, BenchReport& report)
+{
+  // Renderer's default weight below which reflections are not traced
+  static const double default_cutoff = 1.0 / 256;
+
+  static const size_t counts[] = {10, 1000, 100000, 1000000};
+
+  struct Layout
+  {
+    const char*      prefix;
+    PopulateFunction populate;
+  };
+  // Forest shares one mesh between all trees, so its memory should grow
+  // by instance records only
+  static const Layout layouts[] = {
+    {"spheres_", populateSpheres},
+    {"forest_",  populateForest }
+  };
+
+  struct Variant
+  {
+    const char* suffix;
+    bool        lights;
+    bool        reflections;
+  };
+  static const Variant variants[] = {
+    {"plain",              false, false},
+    {"lights",             true,  false},
+    {"reflections",        false, true },
+    {"lights_reflections", true,  true }
+  };
+
+  for (const Layout& layout : layouts)
+  {
+    for (size_t count : counts)
+    {
+      if (count > options.maxObjects)
+        continue;
+
+      for (const Variant& variant : variants)
+      {
+        const std::string name = layout.prefix + std::to_string(count)
+                               + "_" + variant.suffix;
+        if (!isSelected(options, name.c_str()))
+          continue;
+
+        fprintf(stderr, "%-34s", name.c_str());
+
+        // Scene is large, keep it off the stack and free it right after use
+        std::unique_ptr<Scene> scene(
+            new Scene(Camera(Transform(Vec(0, 0, 0)))));
+        layout.populate(*scene, count, variant.lights, variant.reflections,
+                        42);
+
+        const SceneResult result = runScene(options, name.c_str(), *scene,
+                                            SceneSettings{
+          .lights           = variant.lights,
+          .reflections      = variant.reflections,
+          .lightSamples     = 0,
+          .reflectionCutoff = default_cutoff,
+          .wavefront        = options.wavefront,
+          .sortRays         = true,
+          .pathTracing      = false
+        });
+        printResult(result);
+        report.add(result);
+      }
+    }
+  }
+
+  // Sampling few lights per hit should keep cost per pixel flat as
+  // emitters multiply, tracing all of them grows linearly. Tracing all
+  // lights of the largest scene takes minutes, so it is left out.
+  static const size_t emitter_counts[] = {16, 256, 4096};
+  static const size_t max_traced_all   = 256;
+  static const size_t light_samples    = 4;
+
+  for (size_t emitters : emitter_counts)
+  {
+    for (bool sampled : {false, true})
+    {
+      if (!sampled && emitters > max_traced_all)
+        continue;
+
+      const std::string name = "emitters_" + std::to_string(emitters)
+                             + (sampled ? "_sampled" : "_all");
+      if (!isSelected(options, name.c_str()))
+        continue;
+
+      fprintf(stderr, "%-34s", name.c_str());
+
+      std::unique_ptr<Scene> scene(
+          new Scene(Camera(Transform(Vec(0, 0, 0)))));
+      populateEmitters(*scene, emitters, 42);
+
+      const SceneResult result = runScene(options, name.c_str(), *scene,
+                                          SceneSettings{
+        .lights           = true,
+        .reflections      = false,
+        .lightSamples     = sampled ? light_samples : 0,
+        .reflectionCutoff = default_cutoff,
+        .wavefront        = options.wavefront,
+        .sortRays         = true,
+        .pathTracing      = false
+      });
+      printResult(result);
+      report.add(result);
+    }
+  }
+
+  // Mirrors facing each other reflect up to their own limit, cutting off
+  // faint reflections should save most of those rays at no visible cost
+  static const uint32_t mirror_depth = 64;
+
+  for (bool cutoff : {false, true})
+  {
+    const char* name = cutoff ? "mirrors_cutoff" : "mirrors_full";
+    if (!isSelected(options, name))
+      continue;
+
+    fprintf(stderr, "%-34s", name);
+
+    std::unique_ptr<Scene> scene(
+        new Scene(Camera(Transform(Vec(0, 0, 0)))));
+    populateMirrors(*scene, mirror_depth, 42);
+
+    const SceneResult result = runScene(options, name, *scene,
+                                        SceneSettings{
+      .lights           = true,
+      .reflections      = true,
+      .lightSamples     = 0,
+      .reflectionCutoff = cutoff ? default_cutoff : 0,
+      .wavefront        = options.wavefront,
+      .sortRays         = true,
+      .pathTracing      = false
+    });
+    printResult(result);
+    report.add(result);
+  }
+
+  // Reflection and shadow rays of large scenes go all over the hierarchy,
+  // tracing them sorted by origin and direction should miss cache less
+  static const size_t coherence_counts[] = {100000, 1000000};
+
+  for (const Layout& layout : layouts)
+  {
+    for (size_t count : coherence_counts)
+    {
+      if (count > options.maxObjects)
+        continue;
+
+      for (bool sorted : {false, true})
+      {
+        const std::string name = std::string("coherence_") + layout.prefix
+                               + std::to_string(count)
+                               + (sorted ? "_sorted" : "_unsorted");
+        if (!isSelected(options, name.c_str()))
+          continue;
+
+        fprintf(stderr, "%-34s", name.c_str());
+
+        std::unique_ptr<Scene> scene(
+            new Scene(Camera(Transform(Vec(0, 0, 0)))));
+        layout.populate(*scene, count, true, true, 42);
+
+        const SceneResult result = runScene(options, name.c_str(), *scene,
+                                            SceneSettings{
+          .lights           = true,
+          .reflections      = true,
+          .lightSamples     = 0,
+          .reflectionCutoff = default_cutoff,
+          .wavefront        = true,
+          .sortRays         = sorted,
+          .pathTracing      = false
+        });
+        printResult(result);
+        report.add(result);
+      }
+    }
+  }
+
+  // Path tracing follows a bounce off every surface, not only mirrors,
+  // compared against the same scenes shaded by mirror reflections
+  static const size_t path_count = 1000;
+
+  for (const Layout& layout : layouts)
+  {
+    if (path_count > options.maxObjects)
+      continue;
+
+    for (bool path_tracing : {false, true})
+    {
+      const std::string name = std::string("shading_") + layout.prefix
+                             + std::to_string(path_count)
+                             + (path_tracing ? "_paths" : "_mirrors");
+      if (!isSelected(options, name.c_str()))
+        continue;
+
+      fprintf(stderr, "%-34s", name.c_str());
+
+      std::unique_ptr<Scene> scene(
+          new Scene(Camera(Transform(Vec(0, 0, 0)))));
+      layout.populate(*scene, path_count, true, true, 42);
+
+      const SceneResult result = runScene(options, name.c_str(), *scene,
+                                          SceneSettings{
+        .lights           = true,
+        .reflections      = true,
+        .lightSamples     = 0,
+        .reflectionCutoff = default_cutoff,
+        .wavefront        = options.wavefront,
+        .sortRays         = true,
+        .pathTracing      = path_tracing
+      });
+      printResult(result);
+      report.add(result);
+    }
+  }
+}
+
+static void printResult(const SceneResult& result)
+{
+  fprintf(stderr, "%12.6f Mrays/s %12.1f ns/pixel",
+          result.mraysPerSecond, result.nsPerPixel);
+  if (result.cacheMisses >= 0)
+    fprintf(stderr, " %14lld misses", result.cacheMisses);
+  fprintf(stderr, "\n");
+}
+
+static SceneResult runScene(const BenchOptions& options, const char* name,
+                            Scene& scene, const SceneSettings& settings)
+{
+  using Clock = std::chrono::steady_clock;
+
+  // Hierarchy build is timed separately, but renderer also rebuilds it
+  // every frame, so it is included in frame time as well
+  double build_time = 0;
+  {
+    Bvh bvh;
+    const Clock::time_point start = Clock::now();
+    bvh.build(scene);
+    build_time = std::chrono::duration<double>(Clock::now() - start).count();
+  }
+
+  // Render threads must exit before their cache misses are counted, so
+  // renderer lives only as long as rendering does
+  CacheMissCounter cache_misses;
+  size_t samples_per_pixel = 0;
+  size_t thread_count      = 0;
+  double total_time        = 0;
+  double lights_time       = 0;
+  double hierarchy_time    = 0;
+  {
+    Renderer renderer(options.width, options.height, options.threads);
+    size_t grid = 1;
+    while (grid * grid < options.samples)
+      ++grid;
+    renderer.setSampleGrid(grid);
+    renderer.setMaxReflections(settings.reflections ? 2 : 0);
+    renderer.setLightSamples(settings.lightSamples);
+    renderer.setReflectionThreshold(settings.reflectionCutoff);
+    renderer.setWavefront(settings.wavefront);
+    renderer.setCoherenceSorting(settings.sortRays);
+    renderer.setPathTracing(settings.pathTracing);
+
+    // Light list and hierarchy are built by the first frame and reused
+    // afterwards
+    for (size_t frame = 0; frame < options.frames; ++frame)
+    {
+      const Clock::time_point start = Clock::now();
+      renderer.renderScene(scene);
+      total_time += std::chrono::duration<double>(Clock::now() - start)
+                      .count();
+      lights_time    += renderer.frameStats().lightsMs;
+      hierarchy_time += renderer.frameStats().hierarchyMs;
+    }
+
+    samples_per_pixel = renderer.samplesPerPixel();
+    thread_count      = renderer.threadCount();
+  }
+
+  const double frame_time  = total_time / double(options.frames);
+  const double pixel_count = double(options.width * options.height);
+  const double ray_count   = pixel_count * double(samples_per_pixel);
+
+  return SceneResult{
+    .name             = name,
+    .objects          = scene.objectCount(),
+    .lights           = settings.lights,
+    .lightSamples     = settings.lightSamples,
+    .reflections      = settings.reflections,
+    .reflectionCutoff = settings.reflectionCutoff,
+    .wavefront        = settings.wavefront,
+    .sortedRays       = settings.wavefront && settings.sortRays,
+    .pathTracing      = settings.pathTracing,
+    .width            = options.width,
+    .height           = options.height,
+    .samplesPerPixel  = samples_per_pixel,
+    .frames           = options.frames,
+    .threads          = thread_count,
+    .buildMs          = build_time * 1e3,
+    .lightsMs         = lights_time,
+    .frameMs          = frame_time * 1e3,
+    .traceMs          = (total_time * 1e3 - hierarchy_time - lights_time)
+                      / double(options.frames),
+    .mraysPerSecond   = ray_count / frame_time * 1e-6,
+    .nsPerPixel       = frame_time / pixel_count * 1e9,
+    .cacheMisses      = cache_misses.read(),
+    .peakRssKb        = getPeakRssKb()
+  };
+}
@@ -12,15 +12,21 @@
 #ifndef __CONTROLLERS_MOVEMENT_CONTROLLER_H
 #define __CONTROLLERS_MOVEMENT_CONTROLLER_H
 
-#include "ray_trace/transform.h"
+#include "ray_trace/scene.h"
 #include "ui/click_button.h"
 
 class MovementController : public Clickable
 {
 public:
-  MovementController(Transform& transform, const Vec& step) :
-    m_transform(transform),
-    m_step(step)
+  /**
+   * @brief Controller moving object `object` of `scene` by `step` on
+   * every click
+   */
+  MovementController(Scene& scene, size_t object, const Vec& step) :
+    m_scene(scene),
+    m_object(object),
+    m_step(step),
+    m_hasMoved(false)
   {
   }
 
@@ -28,12 +34,28 @@ public:
 
   void onClick() override
   {
-    m_transform.move(m_step);
+    // Scene is told about the move, so that its lights follow the object
+    Transform transform = m_scene.transform(m_object);
+    transform.move(m_step);
+    m_scene.setTransform(m_object, transform);
+    m_hasMoved = true;
+  }
+
+  /**
+   * @brief Whether object was moved since last call
+   */
+  bool takeMoved()
+  {
+    const bool has_moved = m_hasMoved;
+    m_hasMoved = false;
+    return has_moved;
   }
 
 private:
-  Transform& m_transform;
-  Vec        m_step;
+  Scene& m_scene;
+  size_t m_object;
+  Vec    m_step;
+  bool   m_hasMoved;
 };
 
 #endif /* movement_controller.h */
@@ -12,15 +12,19 @@
 #include <SFML/Window/VideoMode.hpp>
 #include <cassert>
 #include <cstdio>
+#include <vector>
 
 #include "controllers/movement_controller.h"
 #include "ray_trace/camera.h"
 #include "ray_trace/color.h"
 #include "ray_trace/material.h"
+#include "ray_trace/render_thread.h"
 #include "ray_trace/renderer.h"
 #include "ray_trace/scene.h"
+#include "ray_trace/scene_file.h"
 #include "ray_trace/scene_object.h"
 #include "ray_trace/transform.h"
+#include "scenes/demo_scene.h"
 #include "ui/button.h"
 #include "ui/click_button.h"
 
@@ -34,22 +38,39 @@ public:
   void onClick() override { puts("Clicked!"); }
 };
 
-static void populateScene(Scene& scene);
-
-int main()
+int main(int argc, char** argv)
 {
-  Camera camera(Transform(Vec(0, 0, 0)), 30);
-  Scene scene(camera,
-              Color::White * 0.3,
-              DirectedLight(Vec(0, -1, 1), Color::White * 1.5));
-  populateScene(scene);
+  Scene scene(getDemoCamera());
+  if (argc > 1)
+  {
+    if (!loadScene(argv[1], scene))
+      return 1;
+  }
+  else
+    populateDemoScene(scene);
+
+  // Buttons move the first object
+  if (scene.objectCount() == 0)
+  {
+    fprintf(stderr, "Scene has no objects to move\n");
+    return 1;
+  }
 
   sf::Texture texture;
   texture.create(SCREEN_WIDTH, SCREEN_HEIGHT);
 
-  Renderer renderer(texture);
-  // renderer.renderScene(scene);
-  // texture.copyToImage().saveToFile("render.png");
+  // Rendering runs apart from event loop, which stays responsive however
+  // long a frame takes
+  RenderThread render_thread(SCREEN_WIDTH, SCREEN_HEIGHT, scene.camera());
+  Renderer& renderer = render_thread.renderer();
+
+  // Show noisy image right away, refine it while nothing moves
+  renderer.setSampleGrid(1);
+  renderer.setProgressive(true);
+
+  // Moving an object re-traces only tiles it could have changed
+  renderer.setIncremental(true);
+  std::vector<Pixel> rect_pixels;
   sf::Sprite sprite(texture);
 
   sf::Texture left_texture;
@@ -57,13 +78,13 @@ int main()
   sf::Texture right_texture;
   assert(right_texture.loadFromFile("assets/right.png"));
 
-  MovementController left_controller(scene[0].transform(), -Vec::UNIT_X*0.1);
+  MovementController left_controller(scene, 0, -Vec::UNIT_X*0.1);
   ClickButton left_button(left_controller, left_texture);
   left_button.sprite().setPosition(sf::Vector2f(
                                     SCREEN_WIDTH - 220,
                                     SCREEN_HEIGHT - 110));
 
-  MovementController right_controller(scene[0].transform(), Vec::UNIT_X*0.1);
+  MovementController right_controller(scene, 0, Vec::UNIT_X*0.1);
   ClickButton right_button(right_controller, right_texture);
   right_button.sprite().setPosition(sf::Vector2f(
                                       SCREEN_WIDTH - 110,
@@ -71,9 +92,13 @@ int main()
 
   sf::RenderWindow window(sf::VideoMode(SCREEN_WIDTH, SCREEN_HEIGHT),
                           "Ray trace");
+  window.setVerticalSyncEnabled(true);
   window.clear(sf::Color::Black);
   window.display();
 
+  render_thread.publishScene(scene);
+  render_thread.start();
+
   while (window.isOpen())
   {
     sf::Event event;
@@ -86,7 +111,27 @@ int main()
       right_button.handleEvent(MouseEvent::getMouseEvent(window, event));
     }
 
-    renderer.renderScene(scene);
+    // Controllers edit scene in place, render thread gets a copy only
+    // when something actually moved. Copy shares unchanged chunks of
+    // objects, so it costs time per chunk
+    const bool left_moved  = left_controller.takeMoved();
+    const bool right_moved = right_controller.takeMoved();
+    if (left_moved || right_moved)
+      render_thread.publishScene(scene);
+
+    // Upload only parts of image changed since last uploaded frame
+    if (render_thread.takeFrame())
+    {
+      const RenderedFrame& frame = render_thread.frame();
+      for (const ImageRect& rect : frame.updatedRects)
+      {
+        rect_pixels.resize(rect.width * rect.height);
+        frame.copyRect(rect, rect_pixels.data());
+        texture.update((const sf::Uint8*) rect_pixels.data(),
+                       unsigned(rect.width), unsigned(rect.height),
+                       unsigned(rect.x),     unsigned(rect.y));
+      }
+    }
 
     window.clear(sf::Color::White);
     window.draw(sprite);
@@ -97,59 +142,3 @@ int main()
 
   return 0;
 }
-
-static void populateScene(Scene& scene)
-{
-  SceneObject ellipsoid(ObjectType::Sphere,
-                        Material(0.85, Color::Red + Color::White * 0.33),
-                        Transform(
-                            /* position = */ Vec(0, 0, 10),
-                            /* scale    = */ Vec(0.8, 0.8, 1.5)));
-  ellipsoid.transform().rotate(Vec::UNIT_X, -45);
-  ellipsoid.transform().rotate(Vec::UNIT_Y, -75);
-
-  SceneObject mirror(ObjectType::Sphere,
-                     Material(0.3, Color::fromNormalized(0.5, 0.7, 0.6)),
-                     Transform(
-                       /* position = */ Vec(-2, -1, 11),
-                       /* scale    = */ Vec(0.7, 0.7, 0.7)));
-  SceneObject sphere(ObjectType::Sphere,
-                     Material(0.98, Color::fromNormalized(0.8, 0.7, 0.65)),
-                     Transform(
-                       /* position = */ Vec(-0.7, -1.5, 8.5),
-                       /* scale    = */ Vec(0.5, 0.5, 0.5)));
-
-  SceneObject floor(ObjectType::Plane,
-                    Material(1, Color::White),
-                    Transform(Vec(0, -2, 0)));
-  SceneObject left_wall(ObjectType::Plane,
-                        Material(1, Color::Blue),
-                        Transform(Vec(-3, 0, 0)));
-  left_wall.transform().rotate(Vec::UNIT_Z, 90);
-
-  SceneObject right_wall(ObjectType::Plane,
-                        Material(1, Color::Green),
-                        Transform(Vec(3, 0, 0)));
-  right_wall.transform().rotate(Vec::UNIT_Z, 90);
-
-  SceneObject back_wall(ObjectType::Plane,
-                        Material(1, Color::White*0.3),
-                        Transform(Vec(0, 0, 15)));
-  back_wall.transform().rotate(Vec::UNIT_X, 90);
-
-  Color blue_light = Color::Blue*0.7 + 0.5 * Color::White;
-  SceneObject light(ObjectType::Sphere,
-                    Material(1, blue_light, blue_light),
-                    Transform(Vec(1.7, -0.1, 8), Vec(0.2, 0.2, 0.2)));
-
-  scene.addObject(ellipsoid);
-  /*
-  scene.addObject(mirror);
-  scene.addObject(sphere);
-  scene.addObject(floor);
-  scene.addObject(back_wall);
-  scene.addObject(left_wall);
-  scene.addObject(right_wall);
-  scene.addObject(light);
-  */
-}
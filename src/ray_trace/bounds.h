@@ -0,0 +1,194 @@
+/**
+ * @file bounds.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Axis-aligned bounding box
+ *
+ * @version 0.1
+ * @date 2023-09-21
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __RAY_TRACE_BOUNDS_H
+#define __RAY_TRACE_BOUNDS_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "ray_trace/real.h"
+#include "ray_trace/vec.h"
+
+class Bounds
+{
+public:
+  /**
+   * @brief Create empty bounds, containing no points
+   */
+  Bounds() :
+    m_min( INFINITY,  INFINITY,  INFINITY),
+    m_max(-INFINITY, -INFINITY, -INFINITY)
+  {
+  }
+
+  Bounds(const Point& min, const Point& max) :
+    m_min(min), m_max(max)
+  {
+  }
+
+  Bounds(const Bounds& other) = default;
+  Bounds& operator=(const Bounds& other) = default;
+
+  ~Bounds() = default;
+
+  static Bounds infinite()
+  {
+    return Bounds(Point(-INFINITY, -INFINITY, -INFINITY),
+                  Point( INFINITY,  INFINITY,  INFINITY));
+  }
+
+  static Bounds fromCenter(const Point& center, const Vec& half_extent)
+  {
+    return Bounds(center - half_extent, center + half_extent);
+  }
+
+  const Point& min() const { return m_min; }
+  const Point& max() const { return m_max; }
+
+  bool isEmpty() const
+  {
+    return m_min.m_x > m_max.m_x
+        || m_min.m_y > m_max.m_y
+        || m_min.m_z > m_max.m_z;
+  }
+
+  bool isFinite() const
+  {
+    return std::isfinite(m_min.m_x) && std::isfinite(m_max.m_x)
+        && std::isfinite(m_min.m_y) && std::isfinite(m_max.m_y)
+        && std::isfinite(m_min.m_z) && std::isfinite(m_max.m_z);
+  }
+
+  Point centroid() const { return (m_min + m_max) * 0.5; }
+  Vec   extent()   const { return m_max - m_min; }
+
+  double surfaceArea() const
+  {
+    if (isEmpty())
+      return 0;
+
+    const Vec size = extent();
+    return 2 * (size.m_x*size.m_y + size.m_y*size.m_z + size.m_z*size.m_x);
+  }
+
+  Bounds& operator|=(const Point& point)
+  {
+    m_min = Point(fmin(m_min.m_x, point.m_x),
+                  fmin(m_min.m_y, point.m_y),
+                  fmin(m_min.m_z, point.m_z));
+    m_max = Point(fmax(m_max.m_x, point.m_x),
+                  fmax(m_max.m_y, point.m_y),
+                  fmax(m_max.m_z, point.m_z));
+    return *this;
+  }
+
+  Bounds& operator|=(const Bounds& other)
+  {
+    if (other.isEmpty())
+      return *this;
+    *this |= other.m_min;
+    *this |= other.m_max;
+    return *this;
+  }
+
+  Bounds operator|(const Bounds& other) const { return Bounds(*this) |= other; }
+  Bounds operator|(const Point&  point) const { return Bounds(*this) |= point; }
+
+  bool overlaps(const Bounds& other) const
+  {
+    return m_min.m_x <= other.m_max.m_x && other.m_min.m_x <= m_max.m_x
+        && m_min.m_y <= other.m_max.m_y && other.m_min.m_y <= m_max.m_y
+        && m_min.m_z <= other.m_max.m_z && other.m_min.m_z <= m_max.m_z;
+  }
+
+  bool contains(const Bounds& other) const
+  {
+    return other.isEmpty()
+        || (m_min.m_x <= other.m_min.m_x && other.m_max.m_x <= m_max.m_x
+         && m_min.m_y <= other.m_min.m_y && other.m_max.m_y <= m_max.m_y
+         && m_min.m_z <= other.m_min.m_z && other.m_max.m_z <= m_max.m_z);
+  }
+
+  /**
+   * @brief Component-wise inverse of ray `direction` for slab tests. Zero
+   * components give huge finite values instead of infinities, so that rays
+   * parallel to a slab and starting on its plane get distance 0 rather
+   * than NaN, and every slab test stays free of NaNs.
+   */
+  static Vec getInverseDirection(const Vec& direction)
+  {
+    return Vec(getInverse(direction.m_x),
+               getInverse(direction.m_y),
+               getInverse(direction.m_z));
+  }
+
+  /**
+   * @brief Slab test of ray `source + t*direction` against the box.
+   *
+   * @param[in]  inv_direction  Inverse of ray direction, as given by
+   *                            `getInverseDirection`
+   * @param[in]  t_max          Hits further than this are ignored
+   * @param[out] t_entry        Ray parameter at which ray enters the box
+   * @param[out] t_exit         Ray parameter at which ray leaves the box,
+   *                            or `t_max` if that happens later
+   *
+   * @return Whether ray hits the box at some t in [0, t_max]
+   */
+  bool clip(const Point& source, const Vec& inv_direction,
+            real t_max, real& t_entry, real& t_exit) const
+  {
+    const real tx_0 = (m_min.m_x - source.m_x) * inv_direction.m_x;
+    const real tx_1 = (m_max.m_x - source.m_x) * inv_direction.m_x;
+    const real ty_0 = (m_min.m_y - source.m_y) * inv_direction.m_y;
+    const real ty_1 = (m_max.m_y - source.m_y) * inv_direction.m_y;
+    const real tz_0 = (m_min.m_z - source.m_z) * inv_direction.m_z;
+    const real tz_1 = (m_max.m_z - source.m_z) * inv_direction.m_z;
+
+    // No NaNs here, so plain comparisons select without branches
+    const real t_near = std::max(std::max(std::min(tx_0, tx_1),
+                                          std::min(ty_0, ty_1)),
+                                 std::max(std::min(tz_0, tz_1), real(0)));
+    const real t_far  = std::min(std::min(std::max(tx_0, tx_1),
+                                          std::max(ty_0, ty_1)),
+                                 std::min(std::max(tz_0, tz_1), t_max));
+
+    t_entry = t_near;
+    t_exit  = t_far;
+    return t_near <= t_far;
+  }
+
+  /**
+   * @brief Same as `clip`, for callers which need only entry point
+   */
+  bool intersect(const Point& source, const Vec& inv_direction,
+                 real t_max, real& t_entry) const
+  {
+    real t_exit = 0;
+    return clip(source, inv_direction, t_max, t_entry, t_exit);
+  }
+
+private:
+  Point m_min;
+  Point m_max;
+
+  static real getInverse(real coord)
+  {
+    constexpr real huge = std::numeric_limits<real>::max();
+    if (!(coord < 0) && !(coord > 0))
+      return std::signbit(coord) ? -huge : huge;
+
+    return 1 / coord;
+  }
+};
+
+#endif /* bounds.h */
@@ -0,0 +1,263 @@
+#include "ray_trace/bvh.h"
+
+#include <algorithm>
+#include <cmath>
+
+void Bvh::build(const Scene& scene)
+{
+  m_scene = &scene;
+  m_unbounded.clear();
+
+  std::vector<BvhBuildItem> items;
+  items.reserve(scene.objectCount());
+
+  for (size_t i = 0; i < scene.objectCount(); ++i)
+  {
+    const Bounds bounds = scene.bounds(i);
+
+    // Object cannot be hit
+    if (bounds.isEmpty())
+      continue;
+
+    // Object is unbounded
+    if (!bounds.isFinite())
+    {
+      m_unbounded.push_back(uint32_t(i));
+      continue;
+    }
+
+    items.push_back(BvhBuildItem{bounds, bounds.centroid(), uint32_t(i)});
+  }
+
+  buildBvh(items, MAX_LEAF_SIZE, m_nodes, m_objects);
+
+  m_boundsStride = m_objects.size() + Real8::SIZE;
+  m_objectBounds.assign(6 * m_boundsStride, 0);
+  for (size_t i = 0; i < m_objects.size(); ++i)
+  {
+    const Bounds bounds = scene.bounds(m_objects[i]);
+    m_objectBounds[0 * m_boundsStride + i] = bounds.min().m_x;
+    m_objectBounds[1 * m_boundsStride + i] = bounds.min().m_y;
+    m_objectBounds[2 * m_boundsStride + i] = bounds.min().m_z;
+    m_objectBounds[3 * m_boundsStride + i] = bounds.max().m_x;
+    m_objectBounds[4 * m_boundsStride + i] = bounds.max().m_y;
+    m_objectBounds[5 * m_boundsStride + i] = bounds.max().m_z;
+  }
+}
+
+LaneMask Bvh::getLeafCandidates(const BvhNode& node, const Point& source,
+                                const Vec& inv_direction, real t_max) const
+{
+  static_assert(MAX_LEAF_SIZE <= Real8::SIZE,
+                "Leaf must fit into single pack of bounds");
+
+  const BoundsPack pack = BoundsPack::load(&m_objectBounds[node.offset],
+                                           m_boundsStride);
+  const LaneMask leaf_mask = (LaneMask(1) << node.count) - 1;
+  return pack.intersect(source, inv_direction, t_max) & leaf_mask;
+}
+
+Bounds Bvh::getObjectBounds(size_t position) const
+{
+  const real* coords = &m_objectBounds[position];
+  return Bounds(Point(coords[0 * m_boundsStride],
+                      coords[1 * m_boundsStride],
+                      coords[2 * m_boundsStride]),
+                Point(coords[3 * m_boundsStride],
+                      coords[4 * m_boundsStride],
+                      coords[5 * m_boundsStride]));
+}
+
+RayHit Bvh::getClosestHit(const Ray& ray) const
+{
+  const Scene& scene = *m_scene;
+  RayHit best_hit;
+
+  // Unbounded objects are tested for every ray
+  for (uint32_t index : m_unbounded)
+  {
+    RayHit hit = ray.getRayHit(scene, index);
+    if (hit.hasHit() && hit.distance() < best_hit.distance())
+      best_hit = hit;
+  }
+
+  if (m_nodes.empty())
+    return best_hit;
+
+  const Vec inv_direction = Bounds::getInverseDirection(ray.direction());
+  const bool is_negative[3] = {
+    inv_direction.m_x < 0,
+    inv_direction.m_y < 0,
+    inv_direction.m_z < 0
+  };
+
+  uint32_t stack[2 * BVH_MAX_DEPTH];
+  size_t   stack_size = 0;
+  stack[stack_size++] = 0;
+
+  while (stack_size > 0)
+  {
+    const uint32_t node_index = stack[--stack_size];
+    const BvhNode& node       = m_nodes[node_index];
+
+    // Skip nodes which start behind the closest hit so far
+    real t_entry = 0;
+    if (!node.bounds.intersect(ray.source(), inv_direction,
+                               best_hit.distance(), t_entry))
+      continue;
+
+    if (node.count > 0)
+    {
+      // Exact test only for objects whose own bounds are hit
+      LaneMask candidates = getLeafCandidates(node, ray.source(),
+                                              inv_direction,
+                                              best_hit.distance());
+      for (; candidates != 0; candidates &= candidates - 1)
+      {
+        const uint32_t i = node.offset + uint32_t(__builtin_ctz(candidates));
+        RayHit hit = ray.getRayHit(scene, m_objects[i]);
+        if (hit.hasHit() && hit.distance() < best_hit.distance())
+          best_hit = hit;
+      }
+      continue;
+    }
+
+    // Visit near child first, far child waits on the stack
+    if (is_negative[node.axis])
+    {
+      stack[stack_size++] = node_index + 1;
+      stack[stack_size++] = node.offset;
+    }
+    else
+    {
+      stack[stack_size++] = node.offset;
+      stack[stack_size++] = node_index + 1;
+    }
+  }
+
+  return best_hit;
+}
+
+size_t Bvh::findOccluder(const Ray& ray, real max_distance) const
+{
+  const Scene& scene = *m_scene;
+
+  // Unbounded objects are tested for every ray
+  for (uint32_t index : m_unbounded)
+    if (ray.getHitDistance(scene, index) < max_distance)
+      return index;
+
+  if (m_nodes.empty())
+    return RayHit::NO_OBJECT;
+
+  const Vec inv_direction = Bounds::getInverseDirection(ray.direction());
+  const bool is_negative[3] = {
+    inv_direction.m_x < 0,
+    inv_direction.m_y < 0,
+    inv_direction.m_z < 0
+  };
+
+  uint32_t stack[2 * BVH_MAX_DEPTH];
+  size_t   stack_size = 0;
+  stack[stack_size++] = 0;
+
+  while (stack_size > 0)
+  {
+    const uint32_t node_index = stack[--stack_size];
+    const BvhNode& node       = m_nodes[node_index];
+
+    // Skip nodes which start beyond maximal distance
+    real t_entry = 0;
+    if (!node.bounds.intersect(ray.source(), inv_direction,
+                               max_distance, t_entry))
+      continue;
+
+    if (node.count > 0)
+    {
+      LaneMask candidates = getLeafCandidates(node, ray.source(),
+                                              inv_direction, max_distance);
+      for (; candidates != 0; candidates &= candidates - 1)
+      {
+        const uint32_t i = node.offset + uint32_t(__builtin_ctz(candidates));
+        if (ray.getHitDistance(scene, m_objects[i]) < max_distance)
+          return m_objects[i];
+      }
+      continue;
+    }
+
+    // Near child is more likely to block the ray
+    if (is_negative[node.axis])
+    {
+      stack[stack_size++] = node_index + 1;
+      stack[stack_size++] = node.offset;
+    }
+    else
+    {
+      stack[stack_size++] = node.offset;
+      stack[stack_size++] = node_index + 1;
+    }
+  }
+
+  return RayHit::NO_OBJECT;
+}
+
+void Bvh::getClosestHits(const RayPacket& packet, PacketHit& hit) const
+{
+  const Scene&   scene  = *m_scene;
+  const LaneMask active = packet.activeMask();
+
+  // Unbounded objects are tested for every ray
+  for (uint32_t index : m_unbounded)
+    packet.intersect(scene, index, active, hit);
+
+  if (m_nodes.empty() || active == 0)
+    return;
+
+  // Rays are coherent, so order children by direction of any active lane
+  const size_t     lead_lane     = size_t(__builtin_ctz(active));
+  const VecPacket& inv_direction = packet.inverseDirection();
+  const bool is_negative[3] = {
+    inv_direction.m_x[lead_lane] < 0,
+    inv_direction.m_y[lead_lane] < 0,
+    inv_direction.m_z[lead_lane] < 0
+  };
+
+  uint32_t stack[2 * BVH_MAX_DEPTH];
+  size_t   stack_size = 0;
+  stack[stack_size++] = 0;
+
+  while (stack_size > 0)
+  {
+    const uint32_t node_index = stack[--stack_size];
+    const BvhNode& node       = m_nodes[node_index];
+
+    // Lanes which can still find a closer hit inside node
+    const LaneMask node_mask = packet.intersect(node.bounds, hit.distance,
+                                                active);
+    if (node_mask == 0)
+      continue;
+
+    if (node.count > 0)
+    {
+      // Each object gets only lanes which hit its own bounds
+      for (uint32_t i = node.offset; i < node.offset + node.count; ++i)
+        packet.intersect(scene, m_objects[i],
+                         packet.intersect(getObjectBounds(i), hit.distance,
+                                          node_mask),
+                         hit);
+      continue;
+    }
+
+    // Visit near child first, far child waits on the stack
+    if (is_negative[node.axis])
+    {
+      stack[stack_size++] = node_index + 1;
+      stack[stack_size++] = node.offset;
+    }
+    else
+    {
+      stack[stack_size++] = node.offset;
+      stack[stack_size++] = node_index + 1;
+    }
+  }
+}
@@ -0,0 +1,103 @@
+/**
+ * @file bvh.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Bounding volume hierarchy over scene objects
+ *
+ * @version 0.1
+ * @date 2023-09-21
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __RAY_TRACE_BVH_H
+#define __RAY_TRACE_BVH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ray_trace/bounds.h"
+#include "ray_trace/bvh_builder.h"
+#include "ray_trace/ray.h"
+#include "ray_trace/ray_packet.h"
+#include "ray_trace/scene.h"
+
+class Bvh
+{
+public:
+  static constexpr size_t MAX_LEAF_SIZE = 4;
+
+  Bvh() :
+    m_scene(nullptr),
+    m_nodes(),
+    m_objects(),
+    m_objectBounds(),
+    m_boundsStride(0),
+    m_unbounded()
+  {
+  }
+
+  Bvh(const Bvh& other) = delete;
+  Bvh& operator=(const Bvh& other) = delete;
+
+  ~Bvh() = default;
+
+  /**
+   * @brief Rebuild hierarchy over all objects of `scene` using surface area
+   * heuristic. Objects with infinite bounds (planes) are kept in a separate
+   * list which is tested for every ray.
+   */
+  void build(const Scene& scene);
+
+  /**
+   * @brief Use hierarchy for `scene`, which must hold the same objects as
+   * the scene it was built for, e.g. a snapshot copy of it
+   */
+  void setScene(const Scene& scene) { m_scene = &scene; }
+
+  const Scene& scene() const { return *m_scene; }
+
+  size_t nodeCount() const { return m_nodes.size(); }
+
+  RayHit getClosestHit(const Ray& ray) const;
+
+  /**
+   * @brief Find any object hit by `ray` closer than `max_distance`,
+   * skipping nodes beyond it. Returns as soon as one is found,
+   * `RayHit::NO_OBJECT` if there is none.
+   */
+  size_t findOccluder(const Ray& ray, real max_distance) const;
+
+  /**
+   * @brief Find closest hit for every active lane of `packet`. The packet
+   * descends into a node while at least one lane hits its bounds.
+   */
+  void getClosestHits(const RayPacket& packet, PacketHit& hit) const;
+
+private:
+  const Scene*          m_scene;
+  std::vector<BvhNode>  m_nodes;
+  std::vector<uint32_t> m_objects;
+
+  // World bounds of `m_objects`, as rows of minimal x, y, z and maximal
+  // x, y, z coordinates. Rows are padded, so that eight boxes can be
+  // loaded starting at any leaf.
+  std::vector<real>     m_objectBounds;
+  size_t                m_boundsStride;
+
+  std::vector<uint32_t> m_unbounded;
+
+  /**
+   * @brief Objects of leaf `node` whose bounds ray enters before `t_max`,
+   * as bits relative to `node.offset`
+   */
+  LaneMask getLeafCandidates(const BvhNode& node, const Point& source,
+                             const Vec& inv_direction, real t_max) const;
+
+  /**
+   * @brief Bounds of object at `position` in `m_objects`
+   */
+  Bounds getObjectBounds(size_t position) const;
+};
+
+#endif /* bvh.h */
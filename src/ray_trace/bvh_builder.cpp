@@ -0,0 +1,197 @@
+#include "ray_trace/bvh_builder.h"
+
+#include <algorithm>
+#include <cmath>
+
+static constexpr size_t BIN_COUNT = 16;
+
+/**
+ * @brief Outputs of hierarchy being built
+ */
+struct BuildContext
+{
+  std::vector<BvhNode>&  nodes;
+  std::vector<uint32_t>& leafItems;
+  size_t                 maxLeafSize;
+};
+
+static double getAxis(const Vec& vec, size_t axis)
+{
+  switch (axis)
+  {
+  case 0:  return vec.m_x;
+  case 1:  return vec.m_y;
+  default: return vec.m_z;
+  }
+}
+
+static uint32_t buildNode(BuildContext& context,
+                          std::vector<BvhBuildItem>& items,
+                          size_t begin, size_t end, size_t depth);
+
+void buildBvh(std::vector<BvhBuildItem>& items, size_t max_leaf_size,
+              std::vector<BvhNode>& nodes, std::vector<uint32_t>& leaf_items)
+{
+  nodes.clear();
+  leaf_items.clear();
+
+  if (items.empty())
+    return;
+
+  nodes.reserve(2 * items.size());
+  leaf_items.reserve(items.size());
+
+  BuildContext context = {
+    .nodes       = nodes,
+    .leafItems   = leaf_items,
+    .maxLeafSize = max_leaf_size
+  };
+  buildNode(context, items, 0, items.size(), 0);
+}
+
+static uint32_t buildNode(BuildContext& context,
+                          std::vector<BvhBuildItem>& items,
+                          size_t begin, size_t end, size_t depth)
+{
+  std::vector<BvhNode>& nodes = context.nodes;
+
+  const uint32_t node_index = uint32_t(nodes.size());
+  nodes.push_back(BvhNode());
+
+  Bounds bounds;
+  Bounds centroid_bounds;
+  for (size_t i = begin; i < end; ++i)
+  {
+    bounds          |= items[i].bounds;
+    centroid_bounds |= items[i].centroid;
+  }
+  nodes[node_index].bounds = bounds;
+
+  const size_t count = end - begin;
+
+  auto make_leaf = [&context, &items, node_index, begin, end, count]()
+  {
+    context.nodes[node_index].offset = uint32_t(context.leafItems.size());
+    context.nodes[node_index].count  = uint16_t(count);
+    for (size_t i = begin; i < end; ++i)
+      context.leafItems.push_back(items[i].index);
+    return node_index;
+  };
+
+  if (count == 1)
+    return make_leaf();
+
+  // Split along the axis with largest centroid spread
+  const Vec spread = centroid_bounds.extent();
+  size_t axis = 0;
+  if (spread.m_y > getAxis(spread, axis)) axis = 1;
+  if (spread.m_z > getAxis(spread, axis)) axis = 2;
+
+  const double axis_min    = getAxis(centroid_bounds.min(), axis);
+  const double axis_spread = getAxis(spread, axis);
+
+  size_t mid = begin;
+
+  if (axis_spread <= 0)
+  {
+    // All centroids coincide, nothing to gain from splitting
+    if (count <= context.maxLeafSize)
+      return make_leaf();
+    mid = begin + count / 2;
+  }
+  else if (depth >= BVH_MAX_DEPTH)
+  {
+    // Fall back to median split to bound tree depth
+    mid = begin + count / 2;
+    std::nth_element(items.begin() + begin, items.begin() + mid,
+                     items.begin() + end,
+      [axis](const BvhBuildItem& lhs, const BvhBuildItem& rhs)
+      {
+        return getAxis(lhs.centroid, axis) < getAxis(rhs.centroid, axis);
+      });
+  }
+  else
+  {
+    auto get_bin = [axis, axis_min, axis_spread](const BvhBuildItem& item)
+    {
+      const double offset = getAxis(item.centroid, axis) - axis_min;
+      const size_t bin    = size_t(offset / axis_spread * BIN_COUNT);
+      return bin < BIN_COUNT ? bin : BIN_COUNT - 1;
+    };
+
+    // Sort items into bins by centroid
+    Bounds bin_bounds[BIN_COUNT];
+    size_t bin_count [BIN_COUNT] = {};
+    for (size_t i = begin; i < end; ++i)
+    {
+      const size_t bin = get_bin(items[i]);
+      bin_bounds[bin] |= items[i].bounds;
+      ++bin_count[bin];
+    }
+
+    // Sweep from the right to get cost of right halves
+    double right_area [BIN_COUNT - 1];
+    size_t right_count[BIN_COUNT - 1];
+    {
+      Bounds accumulated;
+      size_t accumulated_count = 0;
+      for (size_t bin = BIN_COUNT - 1; bin > 0; --bin)
+      {
+        accumulated       |= bin_bounds[bin];
+        accumulated_count += bin_count[bin];
+        right_area [bin - 1] = accumulated.surfaceArea();
+        right_count[bin - 1] = accumulated_count;
+      }
+    }
+
+    // Sweep from the left and pick the cheapest split
+    constexpr double traversal_cost = 0.125;
+    const double total_area = bounds.surfaceArea() > 0
+                            ? bounds.surfaceArea() : 1;
+
+    double best_cost = INFINITY;
+    size_t best_bin  = 0;
+    {
+      Bounds accumulated;
+      size_t accumulated_count = 0;
+      for (size_t bin = 0; bin < BIN_COUNT - 1; ++bin)
+      {
+        accumulated       |= bin_bounds[bin];
+        accumulated_count += bin_count[bin];
+        if (accumulated_count == 0 || right_count[bin] == 0)
+          continue;
+
+        const double cost = traversal_cost
+            + (accumulated_count * accumulated.surfaceArea()
+             + right_count[bin]  * right_area[bin]) / total_area;
+        if (cost < best_cost)
+        {
+          best_cost = cost;
+          best_bin  = bin;
+        }
+      }
+    }
+
+    // Intersecting everything is cheaper than splitting
+    const double leaf_cost = double(count);
+    if (count <= context.maxLeafSize && leaf_cost <= best_cost)
+      return make_leaf();
+
+    mid = size_t(std::partition(items.begin() + begin, items.begin() + end,
+      [&get_bin, best_bin](const BvhBuildItem& item)
+      {
+        return get_bin(item) <= best_bin;
+      }) - items.begin());
+
+    if (mid == begin || mid == end)
+      mid = begin + count / 2;
+  }
+
+  buildNode(context, items, begin, mid, depth + 1);
+  const uint32_t second_child = buildNode(context, items, mid, end,
+                                          depth + 1);
+
+  nodes[node_index].offset = second_child;
+  nodes[node_index].axis   = uint8_t(axis);
+  return node_index;
+}
@@ -0,0 +1,60 @@
+/**
+ * @file bvh_builder.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Surface area heuristic build of bounding volume hierarchies
+ *
+ * @version 0.1
+ * @date 2023-09-30
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __RAY_TRACE_BVH_BUILDER_H
+#define __RAY_TRACE_BVH_BUILDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ray_trace/bounds.h"
+#include "ray_trace/vec.h"
+
+/**
+ * @brief Node of hierarchy stored in depth-first order: first child of
+ * inner node immediately follows it
+ */
+struct BvhNode
+{
+  Bounds   bounds;
+  uint32_t offset; // First item for leaf, second child for inner node
+  uint16_t count;  // Zero for inner node
+  uint8_t  axis;
+
+  BvhNode() : bounds(), offset(0), count(0), axis(0) {}
+};
+
+/**
+ * @brief Bounded item to be placed into hierarchy
+ */
+struct BvhBuildItem
+{
+  Bounds   bounds;
+  Point    centroid;
+  uint32_t index;
+};
+
+/**
+ * @brief Depth past which nodes are split at median, so that traversal
+ * stacks of `2 * BVH_MAX_DEPTH` entries never overflow
+ */
+constexpr size_t BVH_MAX_DEPTH = 64;
+
+/**
+ * @brief Build hierarchy over `items` into `nodes` using binned surface
+ * area heuristic. Leaves refer to ranges of `leaf_items`, which receives
+ * item indices. Both outputs are cleared first, `items` are reordered.
+ */
+void buildBvh(std::vector<BvhBuildItem>& items, size_t max_leaf_size,
+              std::vector<BvhNode>& nodes, std::vector<uint32_t>& leaf_items);
+
+#endif /* bvh_builder.h */
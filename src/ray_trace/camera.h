@@ -40,10 +40,15 @@ public:
   const Transform& transform() const { return m_transform; }
         Transform& transform()       { return m_transform; }
 
+  /**
+   * @brief Distance from camera to image plane of half-width 1, cotangent
+   * of half the field of view
+   */
+  double focalLength() const { return cos(m_fov / 2) / sin(m_fov / 2); }
+
   Vec getDirectionAt(double x, double y) const
   {
-    double cot = cos(m_fov / 2) / sin(m_fov / 2);
-    return (transform().forward() * cot
+    return (transform().forward() * focalLength()
           + transform().right()   * x
           + transform().up()      * y).normalized();
   }
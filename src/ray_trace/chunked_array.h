@@ -0,0 +1,155 @@
+/**
+ * @file chunked_array.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Growable array which never moves its elements
+ *
+ * @version 0.1
+ * @date 2023-09-22
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __RAY_TRACE_CHUNKED_ARRAY_H
+#define __RAY_TRACE_CHUNKED_ARRAY_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Append-only array stored in fixed-size contiguous chunks.
+ *
+ * Unlike `std::vector`, growing the array never relocates existing
+ * elements. Full chunks may also live in external memory, such as a mapped
+ * file, adopted without copying.
+ *
+ * Copies made by `assign()` share chunks with the original until either
+ * array changes one of them, which then gets a private copy of the chunk.
+ * References stay valid until the element is changed with `set()`. Arrays
+ * sharing chunks may be read from any thread, but copies must be made,
+ * changed and dropped by one thread.
+ */
+template<typename T, size_t ChunkSize = 1024>
+class ChunkedArray
+{
+public:
+  static constexpr size_t CHUNK_SIZE = ChunkSize;
+
+  ChunkedArray() : m_chunks(), m_owned(), m_size(0) {}
+
+  // Copies must be explicit, see `assign()`
+  ChunkedArray(const ChunkedArray& other) = delete;
+  ChunkedArray& operator=(const ChunkedArray& other) = delete;
+
+  ChunkedArray(ChunkedArray&& other) = default;
+  ChunkedArray& operator=(ChunkedArray&& other) = default;
+
+  ~ChunkedArray() = default;
+
+  size_t size()  const { return m_size; }
+  bool   empty() const { return m_size == 0; }
+
+  const T& operator[](size_t index) const
+  {
+    return m_chunks[index / CHUNK_SIZE][index % CHUNK_SIZE];
+  }
+
+  /**
+   * @brief Replace element at `index`, copying its chunk first if it is
+   * shared or external
+   */
+  void set(size_t index, const T& value)
+  {
+    makeUnique(index / CHUNK_SIZE)[index % CHUNK_SIZE] = value;
+  }
+
+  void push_back(const T& value)
+  {
+    // Last chunk, unless full, is always owned by array
+    if (m_size % CHUNK_SIZE == 0)
+      addChunk();
+
+    makeUnique(m_chunks.size() - 1).push_back(value);
+    ++m_size;
+  }
+
+  /**
+   * @brief Append `count` elements stored at `data` of an empty or
+   * chunk-aligned array. Full chunks are used in place, so `data` must
+   * outlive the array and its copies, the rest is copied.
+   */
+  void adopt(T* data, size_t count)
+  {
+    const size_t full_count = count - count % CHUNK_SIZE;
+    for (size_t i = 0; i < full_count; i += CHUNK_SIZE)
+    {
+      m_chunks.push_back(data + i);
+      m_owned.emplace_back();
+    }
+    m_size += full_count;
+
+    for (size_t i = full_count; i < count; ++i)
+      push_back(data[i]);
+  }
+
+  /**
+   * @brief Replace contents with copy of `other`. Chunks are shared, so
+   * time taken depends on number of chunks, not elements.
+   */
+  void assign(const ChunkedArray& other)
+  {
+    m_chunks = other.m_chunks;
+    m_owned  = other.m_owned;
+    m_size   = other.m_size;
+  }
+
+  void clear()
+  {
+    m_chunks.clear();
+    m_owned.clear();
+    m_size = 0;
+  }
+
+private:
+  using Chunk = std::vector<T>;
+
+  // Start of every chunk, either owned or external
+  std::vector<T*>                     m_chunks;
+
+  // Owned chunks, possibly shared with copies, null for external ones
+  std::vector<std::shared_ptr<Chunk>> m_owned;
+  size_t                              m_size;
+
+  void addChunk()
+  {
+    // Chunk is allocated once and never grows past its capacity, so
+    // elements are never relocated
+    m_owned.push_back(std::make_shared<Chunk>());
+    m_owned.back()->reserve(CHUNK_SIZE);
+    m_chunks.push_back(m_owned.back()->data());
+  }
+
+  /**
+   * @brief Owned chunk at `chunk_index`, copied first unless no other
+   * array refers to it
+   */
+  Chunk& makeUnique(size_t chunk_index)
+  {
+    std::shared_ptr<Chunk>& owned = m_owned[chunk_index];
+    if (owned && owned.use_count() == 1)
+      return *owned;
+
+    const T*     chunk = m_chunks[chunk_index];
+    const size_t count = std::min(CHUNK_SIZE,
+                                  m_size - chunk_index*CHUNK_SIZE);
+
+    owned = std::make_shared<Chunk>();
+    owned->reserve(CHUNK_SIZE);
+    owned->assign(chunk, chunk + count);
+    m_chunks[chunk_index] = owned->data();
+    return *owned;
+  }
+};
+
+#endif /* chunked_array.h */
@@ -12,47 +12,64 @@
 #ifndef __RAY_TRACE_COLOR_H
 #define __RAY_TRACE_COLOR_H
 
+#include <cstddef>
 #include <cstdint>
 #include <cmath>
+#include <type_traits>
 
-class Color
+#include "ray_trace/real.h"
+
+template <typename T>
+class ColorT
 {
 public:
+  using Scalar = T;
+
+  static const ColorT Black;
+  static const ColorT Red;
+  static const ColorT Green;
+  static const ColorT Blue;
+  static const ColorT Yellow;
+  static const ColorT Cyan;
+  static const ColorT Magenta;
+  static const ColorT White;
+
+  ColorT(const ColorT&) = default;
+  ColorT& operator=(const ColorT&) = default;
+  ~ColorT() = default;
+
+  /**
+   * @brief Convert color of other precision
+   */
+  template <typename U>
+  constexpr explicit ColorT(const ColorT<U>& other) :
+    m_red  (T(other.redNormalized())),
+    m_green(T(other.greenNormalized())),
+    m_blue (T(other.blueNormalized()))
+  {
+  }
 
-  static const Color Black;
-  static const Color Red;
-  static const Color Green;
-  static const Color Blue;
-  static const Color Yellow;
-  static const Color Cyan;
-  static const Color Magenta;
-  static const Color White;
-
-  Color(const Color&) = default;
-  Color& operator=(const Color&) = default;
-  ~Color() = default;
-
-  static Color fromRGB(uint8_t red, uint8_t green, uint8_t blue)
+  static constexpr ColorT fromRGB(uint8_t red, uint8_t green, uint8_t blue)
   {
-    return Color((double) red   / rgb_max,
-                 (double) green / rgb_max,
-                 (double) blue  / rgb_max);
+    return ColorT((T) red   / rgb_max,
+                  (T) green / rgb_max,
+                  (T) blue  / rgb_max);
   }
 
-  static Color fromNormalized(double red, double green, double blue)
+  static constexpr ColorT fromNormalized(T red, T green, T blue)
   {
-    return Color(red, green, blue);
+    return ColorT(red, green, blue);
   }
 
-  uint8_t red()   const { return m_red < 1   ? m_red   * rgb_max : rgb_max; }
-  uint8_t green() const { return m_green < 1 ? m_green * rgb_max : rgb_max; }
-  uint8_t blue()  const { return m_blue < 1  ? m_blue  * rgb_max : rgb_max; }
+  constexpr uint8_t red()   const { return m_red < 1   ? m_red   * rgb_max : rgb_max; }
+  constexpr uint8_t green() const { return m_green < 1 ? m_green * rgb_max : rgb_max; }
+  constexpr uint8_t blue()  const { return m_blue < 1  ? m_blue  * rgb_max : rgb_max; }
 
-  double redNormalized()   const { return m_red; }
-  double greenNormalized() const { return m_green; }
-  double blueNormalized()  const { return m_blue; }
+  constexpr T redNormalized()   const { return m_red; }
+  constexpr T greenNormalized() const { return m_green; }
+  constexpr T blueNormalized()  const { return m_blue; }
 
-  Color& operator+=(const Color& other)
+  constexpr ColorT& operator+=(const ColorT& other)
   {
     m_red   += other.m_red;
     m_green += other.m_green;
@@ -60,40 +77,39 @@ public:
     return *this;
   }
 
-  Color& operator*=(const Color& other)
+  constexpr ColorT& operator*=(const ColorT& other)
   {
     m_red   *= other.m_red;
     m_green *= other.m_green;
     m_blue  *= other.m_blue; return *this;
   }
 
-  Color& operator*=(double scale)
+  constexpr ColorT& operator*=(T scale)
   {
-    m_red   *= fabs(scale);
-    m_green *= fabs(scale);
-    m_blue  *= fabs(scale);
+    const T abs_scale = scale < 0 ? -scale : scale;
+    m_red   *= abs_scale;
+    m_green *= abs_scale;
+    m_blue  *= abs_scale;
     return *this;
   }
 
-  Color& operator/=(double scale)
+  constexpr ColorT& operator/=(T scale)
   {
-    return *this *= 1.0 / scale;
+    return *this *= T(1) / scale;
   }
 
-  Color operator+(const Color& other) const { return Color(*this) += other; }
-  Color operator*(const Color& other) const { return Color(*this) *= other; }
+  constexpr ColorT operator+(const ColorT& other) const { return ColorT(*this) += other; }
+  constexpr ColorT operator*(const ColorT& other) const { return ColorT(*this) *= other; }
 
-  Color operator*(double scale)       const { return Color(*this) *= scale; }
-  Color operator/(double scale)       const { return Color(*this) /= scale; }
+  constexpr ColorT operator*(T scale)             const { return ColorT(*this) *= scale; }
+  constexpr ColorT operator/(T scale)             const { return ColorT(*this) /= scale; }
 
-  friend bool operator==(const Color& lhs, const Color& rhs);
-
-private:
   static constexpr size_t rgb_max = 255;
 
-  double m_red, m_green, m_blue;
+private:
+  T m_red, m_green, m_blue;
 
-  Color(double red, double green, double blue) :
+  constexpr ColorT(T red, T green, T blue) :
     m_red(red),
     m_green(green),
     m_blue(blue)
@@ -101,20 +117,38 @@ private:
   }
 };
 
-inline Color operator*(double scale, const Color& color)
+template <typename T> RAY_TRACE_MATH_CONSTEXPR ColorT<T> ColorT<T>::Black   = ColorT<T>::fromNormalized(0, 0, 0);
+template <typename T> RAY_TRACE_MATH_CONSTEXPR ColorT<T> ColorT<T>::Red     = ColorT<T>::fromNormalized(1, 0, 0);
+template <typename T> RAY_TRACE_MATH_CONSTEXPR ColorT<T> ColorT<T>::Green   = ColorT<T>::fromNormalized(0, 1, 0);
+template <typename T> RAY_TRACE_MATH_CONSTEXPR ColorT<T> ColorT<T>::Blue    = ColorT<T>::fromNormalized(0, 0, 1);
+template <typename T> RAY_TRACE_MATH_CONSTEXPR ColorT<T> ColorT<T>::Yellow  = ColorT<T>::fromNormalized(1, 1, 0);
+template <typename T> RAY_TRACE_MATH_CONSTEXPR ColorT<T> ColorT<T>::Cyan    = ColorT<T>::fromNormalized(0, 1, 1);
+template <typename T> RAY_TRACE_MATH_CONSTEXPR ColorT<T> ColorT<T>::Magenta = ColorT<T>::fromNormalized(1, 0, 1);
+template <typename T> RAY_TRACE_MATH_CONSTEXPR ColorT<T> ColorT<T>::White   = ColorT<T>::fromNormalized(1, 1, 1);
+
+template <typename T>
+constexpr ColorT<T> operator*(typename ColorT<T>::Scalar scale,
+                           const ColorT<T>& color)
 {
   return color * scale;
 }
-inline bool operator==(const Color& lhs, const Color& rhs)
+template <typename T>
+inline bool operator==(const ColorT<T>& lhs, const ColorT<T>& rhs)
 {
-  constexpr double eps = 1.0 / Color::rgb_max;
-  return fabs(lhs.m_red   - rhs.m_red)   < eps
-      && fabs(lhs.m_green - rhs.m_green) < eps
-      && fabs(lhs.m_blue  - rhs.m_blue)  < eps;
+  constexpr T eps = T(1) / ColorT<T>::rgb_max;
+  return std::fabs(lhs.redNormalized()   - rhs.redNormalized())   < eps
+      && std::fabs(lhs.greenNormalized() - rhs.greenNormalized()) < eps
+      && std::fabs(lhs.blueNormalized()  - rhs.blueNormalized())  < eps;
 }
-inline bool operator!=(const Color& lhs, const Color& rhs)
+template <typename T>
+inline bool operator!=(const ColorT<T>& lhs, const ColorT<T>& rhs)
 {
   return !(lhs == rhs);
 }
 
+using Color = ColorT<real>;
+
+static_assert(std::is_trivially_copyable<Color>::value,
+              "Color must be copyable with memcpy");
+
 #endif /* color.h */
@@ -0,0 +1,161 @@
+#include "ray_trace/image_writer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+bool writePpm(const char* filename, const Pixel* pixels,
+              size_t width, size_t height)
+{
+  FILE* file = fopen(filename, "wb");
+  if (!file)
+    return false;
+
+  fprintf(file, "P6\n%zu %zu\n255\n", width, height);
+
+  std::vector<uint8_t> row(3 * width);
+  bool success = true;
+  for (size_t y = 0; y < height && success; ++y)
+  {
+    for (size_t x = 0; x < width; ++x)
+    {
+      const Pixel& pixel = pixels[y * width + x];
+      row[3*x + 0] = pixel.red;
+      row[3*x + 1] = pixel.green;
+      row[3*x + 2] = pixel.blue;
+    }
+    success = fwrite(row.data(), 1, row.size(), file) == row.size();
+  }
+
+  return fclose(file) == 0 && success;
+}
+
+static void putBigEndian(std::vector<uint8_t>& data, uint32_t value)
+{
+  data.push_back(uint8_t(value >> 24));
+  data.push_back(uint8_t(value >> 16));
+  data.push_back(uint8_t(value >>  8));
+  data.push_back(uint8_t(value >>  0));
+}
+
+struct Crc32Table
+{
+  uint32_t values[256];
+
+  Crc32Table() : values{}
+  {
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+      uint32_t value = i;
+      for (size_t bit = 0; bit < 8; ++bit)
+        value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+      values[i] = value;
+    }
+  }
+};
+
+static uint32_t getCrc32(const uint8_t* data, size_t size)
+{
+  static const Crc32Table table;
+
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < size; ++i)
+    crc = table.values[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+
+  return crc ^ 0xFFFFFFFFu;
+}
+
+static void putChunk(std::vector<uint8_t>& png, const char* type,
+                     const std::vector<uint8_t>& data)
+{
+  putBigEndian(png, uint32_t(data.size()));
+
+  // CRC covers chunk type and data
+  const size_t type_start = png.size();
+  png.insert(png.end(), type, type + 4);
+  png.insert(png.end(), data.begin(), data.end());
+  putBigEndian(png, getCrc32(png.data() + type_start,
+                             png.size() - type_start));
+}
+
+bool writePng(const char* filename, const Pixel* pixels,
+              size_t width, size_t height)
+{
+  // Raw scanlines, each starts with filter type "none"
+  const size_t row_size = 1 + sizeof(Pixel) * width;
+  std::vector<uint8_t> raw(row_size * height);
+  for (size_t y = 0; y < height; ++y)
+  {
+    raw[y * row_size] = 0;
+    memcpy(&raw[y * row_size + 1], pixels + y * width, sizeof(Pixel) * width);
+  }
+
+  // Zlib stream made of uncompressed deflate blocks
+  constexpr size_t max_block_size = 65535;
+  std::vector<uint8_t> zlib;
+  zlib.reserve(raw.size() + raw.size() / max_block_size * 5 + 16);
+  zlib.push_back(0x78);
+  zlib.push_back(0x01);
+
+  size_t offset = 0;
+  do
+  {
+    const size_t   block_size = std::min(max_block_size, raw.size() - offset);
+    const uint16_t length     = uint16_t(block_size);
+    const bool     is_last    = offset + block_size == raw.size();
+
+    zlib.push_back(is_last ? 1 : 0);
+    zlib.push_back(uint8_t(length));
+    zlib.push_back(uint8_t(length >> 8));
+    zlib.push_back(uint8_t(~length));
+    zlib.push_back(uint8_t(~length >> 8));
+    zlib.insert(zlib.end(), raw.begin() + offset,
+                            raw.begin() + offset + block_size);
+    offset += block_size;
+  } while (offset < raw.size());
+
+  // Adler-32 checksum of uncompressed data
+  uint32_t adler_low = 1, adler_high = 0;
+  for (uint8_t byte : raw)
+  {
+    adler_low  = (adler_low + byte) % 65521;
+    adler_high = (adler_high + adler_low) % 65521;
+  }
+  putBigEndian(zlib, (adler_high << 16) | adler_low);
+
+  std::vector<uint8_t> header;
+  putBigEndian(header, uint32_t(width));
+  putBigEndian(header, uint32_t(height));
+  header.push_back(8); // Bit depth
+  header.push_back(6); // Color type: RGBA
+  header.push_back(0); // Compression: deflate
+  header.push_back(0); // Filter method: adaptive
+  header.push_back(0); // Interlace: none
+
+  static const uint8_t signature[] = {
+    0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'
+  };
+  std::vector<uint8_t> png(signature, signature + sizeof(signature));
+  putChunk(png, "IHDR", header);
+  putChunk(png, "IDAT", zlib);
+  putChunk(png, "IEND", std::vector<uint8_t>());
+
+  FILE* file = fopen(filename, "wb");
+  if (!file)
+    return false;
+
+  const bool success = fwrite(png.data(), 1, png.size(), file) == png.size();
+  return fclose(file) == 0 && success;
+}
+
+bool writeImage(const char* filename, const Pixel* pixels,
+                size_t width, size_t height)
+{
+  const size_t length = strlen(filename);
+  if (length >= 4 && strcmp(filename + length - 4, ".png") == 0)
+    return writePng(filename, pixels, width, height);
+
+  return writePpm(filename, pixels, width, height);
+}
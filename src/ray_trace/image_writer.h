@@ -0,0 +1,43 @@
+/**
+ * @file image_writer.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Saving rendered images without graphics libraries
+ *
+ * @version 0.1
+ * @date 2023-09-26
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __RAY_TRACE_IMAGE_WRITER_H
+#define __RAY_TRACE_IMAGE_WRITER_H
+
+#include <cstddef>
+
+#include "ray_trace/renderer.h"
+
+/**
+ * @brief Write `width` by `height` RGBA image as binary PPM, dropping alpha
+ *
+ * @return `true` on success, `false` if file could not be written
+ */
+bool writePpm(const char* filename, const Pixel* pixels,
+              size_t width, size_t height);
+
+/**
+ * @brief Write `width` by `height` RGBA image as PNG. Image data is stored
+ * without compression, trading file size for zero dependencies.
+ *
+ * @return `true` on success, `false` if file could not be written
+ */
+bool writePng(const char* filename, const Pixel* pixels,
+              size_t width, size_t height);
+
+/**
+ * @brief Pick format by extension of `filename`: PNG for ".png",
+ * PPM otherwise
+ */
+bool writeImage(const char* filename, const Pixel* pixels,
+                size_t width, size_t height);
+
+#endif /* image_writer.h */
@@ -0,0 +1,162 @@
+#include "ray_trace/light_tree.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "ray_trace/color.h"
+
+static double getPower(const Color& color)
+{
+  return double(color.redNormalized())
+       + double(color.greenNormalized())
+       + double(color.blueNormalized());
+}
+
+/**
+ * @brief Upper bound of light given to surface at `point` with `normal` by
+ * lights of total `power` inside `bounds`. Renderer does not attenuate
+ * light with distance, only by cosine of incidence on either side of the
+ * surface, so the bound is power times the largest such cosine towards
+ * any point of a sphere around bounds.
+ */
+static double getImportance(const Point& point, const Vec& normal,
+                            const Bounds& bounds, double power)
+{
+  const Vec    offset   = bounds.centroid() - point;
+  const Vec    extent   = bounds.extent();
+  const double distance = sqrt(double(Vec::dotProduct(offset, offset)));
+  const double radius   = 0.5 * sqrt(double(Vec::dotProduct(extent, extent)));
+
+  // Point is inside the sphere, light may come from any direction
+  if (!(distance > radius))
+    return power;
+
+  // Cone of directions to sphere and angle between its axis and normal
+  const double sin_cone = radius / distance;
+  const double cos_cone = sqrt(1 - sin_cone * sin_cone);
+  const double cos_axis =
+      std::min(fabs(double(Vec::dotProduct(offset, normal))) / distance, 1.0);
+  const double sin_axis = sqrt(1 - cos_axis * cos_axis);
+
+  // Normal is inside the cone
+  if (cos_axis >= cos_cone)
+    return power;
+
+  // Cosine of angle between normal and the closest direction in cone
+  return power * (cos_axis * cos_cone + sin_axis * sin_cone);
+}
+
+void LightTree::build(const std::vector<SceneLight>& lights)
+{
+  std::vector<BvhBuildItem> items;
+  items.reserve(lights.size());
+  for (size_t i = 0; i < lights.size(); ++i)
+  {
+    // Glowing planes are sampled as if all their light came from center
+    const Bounds bounds = lights[i].bounds.isFinite()
+                        ? lights[i].bounds
+                        : Bounds(lights[i].position, lights[i].position);
+    items.push_back(BvhBuildItem{bounds, bounds.centroid(), uint32_t(i)});
+  }
+
+  buildBvh(items, MAX_LEAF_SIZE, m_nodes, m_lights);
+
+  // Builder reorders items, so they are looked up by light index
+  std::vector<Bounds> bounds(lights.size());
+  for (const BvhBuildItem& item : items)
+    bounds[item.index] = item.bounds;
+
+  m_lightBounds.clear();
+  m_lightPower .clear();
+  for (uint32_t light : m_lights)
+  {
+    m_lightBounds.push_back(bounds[light]);
+    m_lightPower .push_back(getPower(lights[light].power));
+  }
+
+  // Children follow their parents, so walking backwards sums them first
+  m_nodePower.assign(m_nodes.size(), 0);
+  for (size_t i = m_nodes.size(); i-- > 0;)
+  {
+    const BvhNode& node = m_nodes[i];
+    if (node.count == 0)
+    {
+      m_nodePower[i] = m_nodePower[i + 1] + m_nodePower[node.offset];
+      continue;
+    }
+
+    for (size_t j = node.offset; j < node.offset + node.count; ++j)
+      m_nodePower[i] += m_lightPower[j];
+  }
+}
+
+size_t LightTree::sample(const Point& point, const Vec& normal,
+                         double random, double& probability) const
+{
+  probability = 0;
+  if (m_nodes.empty())
+    return NO_LIGHT;
+
+  probability = 1;
+
+  // Rounding must not push rescaled number out of [0, 1)
+  constexpr double max_random = 1 - 0x1.0p-53;
+
+  // Each choice uses part of range left of `random` by previous ones
+  uint32_t node_index = 0;
+  while (m_nodes[node_index].count == 0)
+  {
+    const uint32_t first  = node_index + 1;
+    const uint32_t second = m_nodes[node_index].offset;
+
+    const double first_importance  = getImportance(point, normal,
+                                                   m_nodes[first].bounds,
+                                                   m_nodePower[first]);
+    const double second_importance = getImportance(point, normal,
+                                                   m_nodes[second].bounds,
+                                                   m_nodePower[second]);
+    const double total = first_importance + second_importance;
+
+    // Lights without power are as good as any other
+    const double first_share = total > 0 ? first_importance / total : 0.5;
+    if (random < first_share)
+    {
+      random       = std::min(random / first_share, max_random);
+      probability *= first_share;
+      node_index   = first;
+    }
+    else
+    {
+      random       = std::min((random - first_share) / (1 - first_share),
+                              max_random);
+      probability *= 1 - first_share;
+      node_index   = second;
+    }
+  }
+
+  // Pick light inside leaf the same way
+  const BvhNode& leaf  = m_nodes[node_index];
+  const size_t   begin = leaf.offset;
+  const size_t   end   = leaf.offset + leaf.count;
+
+  double total = 0;
+  for (size_t i = begin; i < end; ++i)
+    total += getImportance(point, normal,
+                           m_lightBounds[i], m_lightPower[i]);
+
+  for (size_t i = begin; i < end; ++i)
+  {
+    const double importance = getImportance(point, normal,
+                                            m_lightBounds[i], m_lightPower[i]);
+    const double share = total > 0 ? importance / total
+                                   : 1.0 / double(leaf.count);
+    if (random < share || i + 1 == end)
+    {
+      probability *= share;
+      return m_lights[i];
+    }
+    random -= share;
+  }
+
+  return NO_LIGHT;
+}
@@ -0,0 +1,81 @@
+/**
+ * @file light_tree.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Hierarchy over light sources for picking few of many lights
+ *
+ * @version 0.1
+ * @date 2023-10-02
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __RAY_TRACE_LIGHT_TREE_H
+#define __RAY_TRACE_LIGHT_TREE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ray_trace/bounds.h"
+#include "ray_trace/bvh_builder.h"
+#include "ray_trace/scene.h"
+#include "ray_trace/vec.h"
+
+/**
+ * @brief Bounding volume hierarchy over scene lights, each node knowing
+ * total power of lights below it. Walking down the tree and choosing
+ * children by their estimated contribution to a surface point picks a
+ * light with probability roughly proportional to its share of light at
+ * that point, in time logarithmic in light count.
+ */
+class LightTree
+{
+public:
+  static constexpr size_t NO_LIGHT = size_t(-1);
+
+  LightTree() :
+    m_nodes(),
+    m_nodePower(),
+    m_lights(),
+    m_lightBounds(),
+    m_lightPower()
+  {
+  }
+
+  LightTree(const LightTree& other) = delete;
+  LightTree& operator=(const LightTree& other) = delete;
+
+  ~LightTree() = default;
+
+  /**
+   * @brief Rebuild hierarchy over `lights`, as listed by `Scene::lights()`
+   */
+  void build(const std::vector<SceneLight>& lights);
+
+  size_t lightCount() const { return m_lights.size(); }
+
+  /**
+   * @brief Pick light for shading surface at `point` with `normal`
+   *
+   * @param[in]  random       Uniformly distributed number in [0, 1)
+   * @param[out] probability  Probability of picking returned light
+   *
+   * @return Index of light in list tree was built from, `NO_LIGHT` if
+   * there are no lights
+   */
+  size_t sample(const Point& point, const Vec& normal, double random,
+                double& probability) const;
+
+private:
+  static constexpr size_t MAX_LEAF_SIZE = 1;
+
+  std::vector<BvhNode>  m_nodes;
+  std::vector<double>   m_nodePower;
+
+  // Light indices, bounds and powers in order of hierarchy leaves
+  std::vector<uint32_t> m_lights;
+  std::vector<Bounds>   m_lightBounds;
+  std::vector<double>   m_lightPower;
+};
+
+#endif /* light_tree.h */
@@ -0,0 +1,45 @@
+#include "ray_trace/mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool MappedFile::open(const char* path)
+{
+  close();
+
+  const int fd = ::open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat status = {};
+  if (fstat(fd, &status) != 0 || status.st_size <= 0)
+  {
+    ::close(fd);
+    return false;
+  }
+
+  const size_t size = size_t(status.st_size);
+  void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                    fd, 0);
+
+  // Mapping stays valid after descriptor is closed
+  ::close(fd);
+  if (data == MAP_FAILED)
+    return false;
+
+  m_data = static_cast<char*>(data);
+  m_size = size;
+  return true;
+}
+
+void MappedFile::close()
+{
+  if (!m_data)
+    return;
+
+  munmap(m_data, m_size);
+  m_data = nullptr;
+  m_size = 0;
+}
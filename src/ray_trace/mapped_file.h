@@ -0,0 +1,53 @@
+/**
+ * @file mapped_file.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Read-only file mapped into memory
+ *
+ * @version 0.1
+ * @date 2023-09-29
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __RAY_TRACE_MAPPED_FILE_H
+#define __RAY_TRACE_MAPPED_FILE_H
+
+#include <cstddef>
+
+/**
+ * @brief Private copy-on-write mapping of a file. Pages are read lazily on
+ * first access, writes stay in memory and never reach the file.
+ */
+class MappedFile
+{
+public:
+  MappedFile() : m_data(nullptr), m_size(0) {}
+
+  MappedFile(const MappedFile& other) = delete;
+  MappedFile& operator=(const MappedFile& other) = delete;
+
+  ~MappedFile() { close(); }
+
+  /**
+   * @brief Map whole file at `path`, unmapping previous one
+   *
+   * @return `false` if file could not be opened or mapped
+   */
+  bool open(const char* path);
+
+  void close();
+
+  bool isOpen() const { return m_data != nullptr; }
+
+  /**
+   * @brief Start of mapping, aligned to page size
+   */
+  char*  data() const { return m_data; }
+  size_t size() const { return m_size; }
+
+private:
+  char*  m_data;
+  size_t m_size;
+};
+
+#endif /* mapped_file.h */
@@ -12,6 +12,9 @@
 #ifndef __RAY_TRACE_MATERIAL_H
 #define __RAY_TRACE_MATERIAL_H
 
+#include <cstddef>
+#include <cstdint>
+
 #include "ray_trace/color.h"
 
 enum class MaterialType
@@ -23,8 +26,14 @@ enum class MaterialType
 class Material
 {
 public:
+  /**
+   * @brief Reflection limit of materials which follow renderer's limit
+   */
+  static constexpr uint32_t DEFAULT_REFLECTIONS = UINT32_MAX;
+
   Material() :
     m_type(MaterialType::Hidden),
+    m_maxReflections(DEFAULT_REFLECTIONS),
     m_diffusion(0),
     m_color(Color::Black),
     m_glowColor(Color::Black)
@@ -35,6 +44,7 @@ public:
            const Color& color,
            const Color& glowColor = Color::Black):
     m_type(MaterialType::SolidColor),
+    m_maxReflections(DEFAULT_REFLECTIONS),
     m_diffusion(0),
     m_color(color),
     m_glowColor(glowColor)
@@ -57,8 +67,33 @@ public:
 
   bool isHidden() const { return type() == MaterialType::Hidden; }
   bool hasGlow()  const { return glowColor() != Color::Black; }
+
+  /**
+   * @brief Rays hitting this material reflect further only while their
+   * path has fewer reflections than this, overriding renderer's limit.
+   * Lets mirrors reflect deeper than the rest of the scene, or keeps
+   * some materials from reflecting at all.
+   */
+  uint32_t maxReflections() const { return m_maxReflections; }
+  void setMaxReflections(uint32_t count) { m_maxReflections = count; }
+
+  bool hasReflectionLimit() const
+  {
+    return m_maxReflections != DEFAULT_REFLECTIONS;
+  }
+
+  /**
+   * @brief Limit on reflections after hitting this material, `fallback`
+   * unless material has its own
+   */
+  size_t getMaxReflections(size_t fallback) const
+  {
+    return hasReflectionLimit() ? m_maxReflections : fallback;
+  }
+
 private:
   MaterialType m_type;
+  uint32_t     m_maxReflections;
   double       m_diffusion;
   Color        m_color;
   Color        m_glowColor;
@@ -1,7 +0,0 @@
-#include "ray_trace/matrix.h"
-
-const Matrix Matrix::One = Matrix({
-     {1, 0, 0},
-     {0, 1, 0},
-     {0, 0, 1}
-    });
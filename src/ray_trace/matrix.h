@@ -14,63 +14,81 @@
 
 #include <cmath>
 #include <cstddef>
+#include <type_traits>
 
+#include "ray_trace/real.h"
 #include "ray_trace/vec.h"
 
-class Matrix
+template <typename T>
+class MatrixT
 {
 public:
-  static const Matrix One;
+  using Scalar = T;
 
-  Matrix() :
+  static const MatrixT One;
+
+  constexpr MatrixT() :
     m_coords{{0, 0, 0}, {0, 0, 0}, {0, 0, 0}}
   {
   }
-  Matrix(const double (&matrix)[3][3])
+  constexpr MatrixT(const T (&matrix)[3][3]) :
+    m_coords{}
   {
     for (size_t i = 0; i < 3; ++i)
       for (size_t j = 0; j < 3; ++j)
         m_coords[i][j] = matrix[i][j];
   }
-  Matrix(const Matrix& other) = default;
-  Matrix& operator=(const Matrix& other) = default;
-
-  static Matrix fromRotation(const Vec& axis, double angle_deg)
+  /**
+   * @brief Convert matrix of other precision
+   */
+  template <typename U>
+  constexpr explicit MatrixT(const MatrixT<U>& other) :
+    m_coords{}
   {
-    const double angle = angle_deg / 180 * M_PI;
-    const double cos_a = cos(angle);
-    const double sin_a = sin(angle);
-    const double u_x = axis.m_x;
-    const double u_y = axis.m_y;
-    const double u_z = axis.m_z;
+    for (size_t i = 0; i < 3; ++i)
+      for (size_t j = 0; j < 3; ++j)
+        m_coords[i][j] = T(other[i][j]);
+  }
+
+  MatrixT(const MatrixT& other) = default;
+  MatrixT& operator=(const MatrixT& other) = default;
 
-    return Matrix({
+  static MatrixT fromRotation(const VecT<T>& axis, T angle_deg)
+  {
+    const T angle = angle_deg / 180 * T(M_PI);
+    const T cos_a = std::cos(angle);
+    const T sin_a = std::sin(angle);
+    const T u_x = axis.m_x;
+    const T u_y = axis.m_y;
+    const T u_z = axis.m_z;
+
+    return MatrixT({
         { u_x*u_x*(1 - cos_a) +     cos_a, u_x*u_y*(1 - cos_a) - u_z*sin_a, u_x*u_z*(1 - cos_a) + u_y*sin_a },
         { u_y*u_x*(1 - cos_a) + u_z*sin_a, u_y*u_y*(1 - cos_a) +     cos_a, u_y*u_z*(1 - cos_a) - u_x*sin_a },
         { u_z*u_x*(1 - cos_a) - u_y*sin_a, u_z*u_y*(1 - cos_a) + u_x*sin_a, u_z*u_z*(1 - cos_a) +     cos_a }
     });
   }
 
-  static Matrix fromScale(const Vec& scale)
+  static constexpr MatrixT fromScale(const VecT<T>& scale)
   {
-    return Matrix({
+    return MatrixT({
         { scale.m_x, 0,         0         },
         { 0,         scale.m_y, 0         },
         { 0,         0,         scale.m_z }
     });
   }
 
-  typedef       double (&     Row)[3];
-  typedef const double (&ConstRow)[3];
+  typedef       T (&     Row)[3];
+  typedef const T (&ConstRow)[3];
 
-  ConstRow operator[](size_t index) const { return m_coords[index]; }
-       Row operator[](size_t index)       { return m_coords[index]; }
+  constexpr ConstRow operator[](size_t index) const { return m_coords[index]; }
+  constexpr      Row operator[](size_t index)       { return m_coords[index]; }
 
-  Matrix& operator*=(const Matrix& other)
+  constexpr MatrixT& operator*=(const MatrixT& other)
   {
     for (size_t i = 0; i < 3; ++i)
     {
-      double row[3] = { 0, 0, 0 };
+      T row[3] = { 0, 0, 0 };
       for (size_t j = 0; j < 3; ++j)
         for (size_t k = 0; k < 3; ++k)
           row[j] += m_coords[i][k] * other[k][j];
@@ -81,7 +99,7 @@ public:
     return *this;
   }
 
-  Matrix& operator*=(double scale)
+  constexpr MatrixT& operator*=(T scale)
   {
     for (size_t i = 0; i < 3; ++i)
       for (size_t j = 0; j < 3; ++j)
@@ -90,7 +108,7 @@ public:
     return *this;
   }
 
-  Matrix& operator+=(const Matrix& other)
+  constexpr MatrixT& operator+=(const MatrixT& other)
   {
     for (size_t i = 0; i < 3; ++i)
       for (size_t j = 0; j < 3; ++j)
@@ -98,7 +116,7 @@ public:
     return *this;
   }
 
-  Matrix& operator-=(const Matrix& other)
+  constexpr MatrixT& operator-=(const MatrixT& other)
   {
     for (size_t i = 0; i < 3; ++i)
       for (size_t j = 0; j < 3; ++j)
@@ -106,13 +124,13 @@ public:
     return *this;
   }
 
-  Matrix operator*(const Matrix& other) const { return Matrix(*this) *= other; }
-  Matrix operator*(double scale)        const { return Matrix(*this) *= scale; }
-  Matrix operator+(const Matrix& other) const { return Matrix(*this) += other; }
-  Matrix operator-(const Matrix& other) const { return Matrix(*this) -= other; }
-  Matrix operator-()                    const { return Matrix(*this) *= -1; }
+  constexpr MatrixT operator*(const MatrixT& other) const { return MatrixT(*this) *= other; }
+  constexpr MatrixT operator*(T scale)             const { return MatrixT(*this) *= scale; }
+  constexpr MatrixT operator+(const MatrixT& other) const { return MatrixT(*this) += other; }
+  constexpr MatrixT operator-(const MatrixT& other) const { return MatrixT(*this) -= other; }
+  constexpr MatrixT operator-()                     const { return MatrixT(*this) *= -1; }
 
-  double determinant() const
+  constexpr T determinant() const
   {
     return m_coords[0][0]*m_coords[1][1]*m_coords[2][2]
          + m_coords[0][1]*m_coords[1][2]*m_coords[2][0]
@@ -122,46 +140,56 @@ public:
          - m_coords[0][0]*m_coords[1][2]*m_coords[2][1];
   }
 
-  bool hasInverse() const
+  constexpr bool hasInverse() const
   {
-    return fabs(determinant()) >= EPS;
+    const T det = determinant();
+    return det >= EPS || det <= -EPS;
   }
 
-  Vec operator*(const Vec& vec) const
+  constexpr VecT<T> operator*(const VecT<T>& vec) const
   {
-    const Vec row_x(m_coords[0][0], m_coords[0][1], m_coords[0][2]);
-    const Vec row_y(m_coords[1][0], m_coords[1][1], m_coords[1][2]);
-    const Vec row_z(m_coords[2][0], m_coords[2][1], m_coords[2][2]);
-
-    return Vec(
-      Vec::dotProduct(row_x, vec),
-      Vec::dotProduct(row_y, vec),
-      Vec::dotProduct(row_z, vec)
+    const VecT<T> row_x(m_coords[0][0], m_coords[0][1], m_coords[0][2]);
+    const VecT<T> row_y(m_coords[1][0], m_coords[1][1], m_coords[1][2]);
+    const VecT<T> row_z(m_coords[2][0], m_coords[2][1], m_coords[2][2]);
+
+    return VecT<T>(
+      VecT<T>::dotProduct(row_x, vec),
+      VecT<T>::dotProduct(row_y, vec),
+      VecT<T>::dotProduct(row_z, vec)
     );
   }
 
-  Matrix getInverse() const
+  constexpr MatrixT getTransposed() const
+  {
+    return MatrixT({
+      {m_coords[0][0], m_coords[1][0], m_coords[2][0]},
+      {m_coords[0][1], m_coords[1][1], m_coords[2][1]},
+      {m_coords[0][2], m_coords[1][2], m_coords[2][2]}
+    });
+  }
+
+  constexpr MatrixT getInverse() const
   {
     if (!hasInverse())
-      return Matrix();
+      return MatrixT();
 
-    return Matrix({
+    return MatrixT({
       {getAdjoint(0, 0), getAdjoint(0, 1), getAdjoint(0, 2)},
       {getAdjoint(1, 0), getAdjoint(1, 1), getAdjoint(1, 2)},
       {getAdjoint(2, 0), getAdjoint(2, 1), getAdjoint(2, 2)}
-    }) *= 1.0 / determinant();
+    }) *= T(1) / determinant();
   }
 
 private:
-  static double constexpr EPS = 1e-6;
-  double m_coords[3][3];
+  static T constexpr EPS = T(1e-6);
+  T m_coords[3][3];
 
-  double getAdjoint(size_t i, size_t j) const
+  constexpr T getAdjoint(size_t i, size_t j) const
   {
     return getCofactor(j, i);
   }
 
-  double getCofactor(size_t i, size_t j) const
+  constexpr T getCofactor(size_t i, size_t j) const
   {
     const int sign = (i + j) % 2 == 0 ? 1 : -1;
 
@@ -175,9 +203,22 @@ private:
   }
 };
 
-inline Matrix operator*(double scale, const Matrix& matrix)
+template <typename T> RAY_TRACE_MATH_CONSTEXPR MatrixT<T> MatrixT<T>::One = MatrixT<T>({
+     {1, 0, 0},
+     {0, 1, 0},
+     {0, 0, 1}
+    });
+
+template <typename T>
+constexpr MatrixT<T> operator*(typename MatrixT<T>::Scalar scale,
+                            const MatrixT<T>& matrix)
 {
   return matrix * scale;
 }
 
+using Matrix = MatrixT<real>;
+
+static_assert(std::is_trivially_copyable<Matrix>::value,
+              "Matrix must be copyable with memcpy");
+
 #endif /* matrix.h */
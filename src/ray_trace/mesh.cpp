@@ -0,0 +1,379 @@
+#include "ray_trace/mesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <utility>
+
+/**
+ * @brief Ray prepared for watertight triangle test: axes are permuted so
+ * that direction is largest along `kz`, and shear moves it onto z axis
+ */
+struct ShearedRay
+{
+  Point  source;
+  size_t kx, ky, kz;
+  real   sx, sy, sz;
+};
+
+static ShearedRay getShearedRay(const Point& source, const Vec& direction)
+{
+  const real coords[3] = { direction.m_x, direction.m_y, direction.m_z };
+
+  size_t kz = 0;
+  if (std::fabs(coords[1]) > std::fabs(coords[kz])) kz = 1;
+  if (std::fabs(coords[2]) > std::fabs(coords[kz])) kz = 2;
+
+  size_t kx = (kz + 1) % 3;
+  size_t ky = (kx + 1) % 3;
+
+  // Keep winding order of triangles when direction is reversed
+  if (coords[kz] < 0)
+    std::swap(kx, ky);
+
+  return ShearedRay{
+    .source = source,
+    .kx     = kx,
+    .ky     = ky,
+    .kz     = kz,
+    .sx     = coords[kx] / coords[kz],
+    .sy     = coords[ky] / coords[kz],
+    .sz     = 1 / coords[kz]
+  };
+}
+
+static bool isZero(real value)
+{
+  return !(value < 0) && !(value > 0);
+}
+
+/**
+ * @brief Parameter of hit of `ray` with triangle (`v_0`, `v_1`, `v_2`) in
+ * (`t_min`, `t_max`), `INFINITY` if there is none. Rays through shared
+ * edges and vertices hit exactly one of adjacent triangles, so closed
+ * meshes have no cracks.
+ */
+static real intersectTriangle(const ShearedRay& ray,
+                              const Point& v_0, const Point& v_1,
+                              const Point& v_2, real t_min, real t_max)
+{
+  // Vertices relative to ray source
+  const Vec a_vec = v_0 - ray.source;
+  const Vec b_vec = v_1 - ray.source;
+  const Vec c_vec = v_2 - ray.source;
+  const real a[3] = { a_vec.m_x, a_vec.m_y, a_vec.m_z };
+  const real b[3] = { b_vec.m_x, b_vec.m_y, b_vec.m_z };
+  const real c[3] = { c_vec.m_x, c_vec.m_y, c_vec.m_z };
+
+  // Shear and scale vertices, so that ray goes along z axis
+  const real a_x = a[ray.kx] - ray.sx * a[ray.kz];
+  const real a_y = a[ray.ky] - ray.sy * a[ray.kz];
+  const real b_x = b[ray.kx] - ray.sx * b[ray.kz];
+  const real b_y = b[ray.ky] - ray.sy * b[ray.kz];
+  const real c_x = c[ray.kx] - ray.sx * c[ray.kz];
+  const real c_y = c[ray.ky] - ray.sy * c[ray.kz];
+
+  // Scaled barycentric coordinates
+  real u = c_x * b_y - c_y * b_x;
+  real v = a_x * c_y - a_y * c_x;
+  real w = b_x * a_y - b_y * a_x;
+
+  // Ray passes close to an edge, single precision cannot tell side
+  if (sizeof(real) < sizeof(double)
+      && (isZero(u) || isZero(v) || isZero(w)))
+  {
+    u = real(double(c_x) * double(b_y) - double(c_y) * double(b_x));
+    v = real(double(a_x) * double(c_y) - double(a_y) * double(c_x));
+    w = real(double(b_x) * double(a_y) - double(b_y) * double(a_x));
+  }
+
+  // Both faces are hit, so only mixed signs mean a miss
+  if ((u < 0 || v < 0 || w < 0) && (u > 0 || v > 0 || w > 0))
+    return INFINITY;
+
+  const real determinant = u + v + w;
+  if (isZero(determinant))
+    return INFINITY;
+
+  const real a_z = ray.sz * a[ray.kz];
+  const real b_z = ray.sz * b[ray.kz];
+  const real c_z = ray.sz * c[ray.kz];
+  const real t   = (u * a_z + v * b_z + w * c_z) / determinant;
+
+  return t > t_min && t < t_max ? t : INFINITY;
+}
+
+static constexpr real BOUNDS_TOLERANCE =
+  1 + 4 * std::numeric_limits<real>::epsilon();
+
+real Mesh::intersect(const Point& source, const Vec& direction,
+                     real t_min, real t_max, uint32_t& triangle) const
+{
+  return traverse<false>(source, direction, t_min, t_max, triangle);
+}
+
+bool Mesh::occludes(const Point& source, const Vec& direction,
+                    real t_min, real t_max) const
+{
+  uint32_t triangle = 0;
+  return std::isfinite(traverse<true>(source, direction, t_min, t_max,
+                                      triangle));
+}
+
+template <bool AnyHit>
+real Mesh::traverse(const Point& source, const Vec& direction,
+                    real t_min, real t_max, uint32_t& triangle) const
+{
+  if (m_nodes.empty())
+    return INFINITY;
+
+  const ShearedRay ray = getShearedRay(source, direction);
+  const Vec inv_direction = Bounds::getInverseDirection(direction);
+  const bool is_negative[3] = {
+    inv_direction.m_x < 0,
+    inv_direction.m_y < 0,
+    inv_direction.m_z < 0
+  };
+
+  real t_best = INFINITY;
+
+  uint32_t stack[2 * BVH_MAX_DEPTH];
+  size_t   stack_size = 0;
+  stack[stack_size++] = 0;
+
+  while (stack_size > 0)
+  {
+    const uint32_t node_index = stack[--stack_size];
+    const BvhNode& node       = m_nodes[node_index];
+
+    // Skip nodes which start behind the closest hit so far. Rays through
+    // vertices graze corners of triangle bounds, so exit is moved a few
+    // rounding errors further to keep them from missing.
+    real t_entry = 0;
+    real t_exit  = 0;
+    node.bounds.clip(source, inv_direction, std::min(t_best, t_max),
+                     t_entry, t_exit);
+    if (t_entry > t_exit * BOUNDS_TOLERANCE)
+      continue;
+
+    if (node.count > 0)
+    {
+      for (uint32_t i = node.offset; i < node.offset + node.count; ++i)
+      {
+        const real t = intersectTriangle(ray,
+                                         m_vertices[m_indices[3*i + 0]],
+                                         m_vertices[m_indices[3*i + 1]],
+                                         m_vertices[m_indices[3*i + 2]],
+                                         t_min, std::min(t_best, t_max));
+        if (t < t_best)
+        {
+          t_best   = t;
+          triangle = i;
+          if (AnyHit)
+            return t_best;
+        }
+      }
+      continue;
+    }
+
+    // Visit near child first, far child waits on the stack
+    if (is_negative[node.axis])
+    {
+      stack[stack_size++] = node_index + 1;
+      stack[stack_size++] = node.offset;
+    }
+    else
+    {
+      stack[stack_size++] = node.offset;
+      stack[stack_size++] = node_index + 1;
+    }
+  }
+
+  return t_best;
+}
+
+bool Mesh::setTriangles(const std::vector<Point>&    vertices,
+                        const std::vector<uint32_t>& indices)
+{
+  if (indices.size() % 3 != 0)
+    return false;
+
+  for (uint32_t index : indices)
+    if (index >= vertices.size())
+      return false;
+
+  m_vertices = vertices;
+  m_indices  = indices;
+  buildHierarchy();
+  return true;
+}
+
+void Mesh::buildHierarchy()
+{
+  const size_t triangle_count = triangleCount();
+
+  std::vector<BvhBuildItem> items;
+  items.reserve(triangle_count);
+  for (size_t i = 0; i < triangle_count; ++i)
+  {
+    const Bounds bounds = Bounds()
+                        | m_vertices[m_indices[3*i + 0]]
+                        | m_vertices[m_indices[3*i + 1]]
+                        | m_vertices[m_indices[3*i + 2]];
+    items.push_back(BvhBuildItem{bounds, bounds.centroid(), uint32_t(i)});
+  }
+
+  std::vector<uint32_t> leaf_order;
+  buildBvh(items, MAX_LEAF_SIZE, m_nodes, leaf_order);
+
+  // Leaves refer to contiguous ranges of reordered triangles
+  std::vector<uint32_t> indices(m_indices.size());
+  for (size_t i = 0; i < leaf_order.size(); ++i)
+    for (size_t j = 0; j < 3; ++j)
+      indices[3*i + j] = m_indices[3*leaf_order[i] + j];
+
+  m_indices.swap(indices);
+}
+
+static bool readFile(const char* path, std::vector<char>& contents)
+{
+  FILE* file = fopen(path, "rb");
+  if (!file)
+    return false;
+
+  bool success = fseek(file, 0, SEEK_END) == 0;
+  const long size = success ? ftell(file) : -1;
+  success = size >= 0 && fseek(file, 0, SEEK_SET) == 0;
+
+  // Terminating zero stops parser at the end of file
+  if (success)
+  {
+    contents.assign(size_t(size) + 1, '\0');
+    success = fread(contents.data(), 1, size_t(size), file) == size_t(size);
+  }
+
+  fclose(file);
+  return success;
+}
+
+/**
+ * @brief Skip blanks, return `true` if nothing but a comment is left on
+ * the line
+ */
+static bool skipToToken(const char*& pos)
+{
+  while (*pos == ' ' || *pos == '\t' || *pos == '\r')
+    ++pos;
+
+  return *pos == '\n' || *pos == '\0' || *pos == '#';
+}
+
+bool Mesh::loadObj(const char* path)
+{
+  std::vector<char> contents;
+  if (!readFile(path, contents))
+  {
+    fprintf(stderr, "%s: cannot read file\n", path);
+    return false;
+  }
+
+  std::vector<Point>    vertices;
+  std::vector<uint32_t> indices;
+  std::vector<uint32_t> face;
+
+  const char* pos  = contents.data();
+  size_t      line = 1;
+  const char* error = nullptr;
+
+  while (*pos != '\0' && !error)
+  {
+    skipToToken(pos);
+
+    if (pos[0] == 'v' && (pos[1] == ' ' || pos[1] == '\t'))
+    {
+      // Optional fourth coordinate is ignored
+      ++pos;
+      real coords[3] = {};
+      for (size_t i = 0; i < 3 && !error; ++i)
+      {
+        char* end = nullptr;
+        if (!skipToToken(pos))
+          coords[i] = real(strtod(pos, &end));
+
+        if (end == nullptr || end == pos)
+          error = "vertex coordinate expected";
+        else
+          pos = end;
+      }
+      vertices.push_back(Point(coords[0], coords[1], coords[2]));
+    }
+    else if (pos[0] == 'f' && (pos[1] == ' ' || pos[1] == '\t'))
+    {
+      ++pos;
+      face.clear();
+      while (!skipToToken(pos) && !error)
+      {
+        char* end = nullptr;
+        const long index = strtol(pos, &end, 10);
+
+        // Negative indices count back from the last vertex
+        const long absolute = index < 0 ? long(vertices.size()) + index
+                                        : index - 1;
+        if (end == pos || index == 0 || absolute < 0
+            || absolute >= long(UINT32_MAX))
+          error = "vertex index expected";
+
+        face.push_back(uint32_t(absolute));
+
+        // Skip texture coordinate and normal indices
+        pos = end;
+        while (*pos != '\0' && *pos != '\n' && *pos != ' ' && *pos != '\t'
+               && *pos != '\r')
+          ++pos;
+      }
+
+      if (!error && face.size() < 3)
+        error = "face needs at least three vertices";
+
+      // Split polygon into fan of triangles
+      for (size_t i = 2; i < face.size() && !error; ++i)
+      {
+        indices.push_back(face[0]);
+        indices.push_back(face[i - 1]);
+        indices.push_back(face[i]);
+      }
+    }
+
+    // Everything else describes normals, textures and materials
+    if (!error)
+    {
+      while (*pos != '\n' && *pos != '\0')
+        ++pos;
+      if (*pos == '\n')
+      {
+        ++pos;
+        ++line;
+      }
+    }
+  }
+
+  if (error)
+  {
+    fprintf(stderr, "%s:%zu: %s\n", path, line, error);
+    return false;
+  }
+
+  if (!setTriangles(vertices, indices))
+  {
+    fprintf(stderr, "%s: face refers to missing vertex\n", path);
+    return false;
+  }
+
+  char* absolute_path = realpath(path, nullptr);
+  m_path = absolute_path ? absolute_path : path;
+  free(absolute_path);
+
+  return true;
+}
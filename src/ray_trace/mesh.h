@@ -0,0 +1,125 @@
+/**
+ * @file mesh.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Triangle mesh with its own bounding volume hierarchy
+ *
+ * @version 0.1
+ * @date 2023-09-30
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __RAY_TRACE_MESH_H
+#define __RAY_TRACE_MESH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ray_trace/bounds.h"
+#include "ray_trace/bvh_builder.h"
+#include "ray_trace/real.h"
+#include "ray_trace/vec.h"
+
+/**
+ * @brief Indexed triangle mesh in object space. Geometry never changes
+ * after it is loaded, so one mesh can be shared by any number of scene
+ * objects, each placing it with its own transform.
+ */
+class Mesh
+{
+public:
+  static constexpr size_t MAX_LEAF_SIZE = 4;
+
+  Mesh() :
+    m_path(),
+    m_vertices(),
+    m_indices(),
+    m_nodes()
+  {
+  }
+
+  Mesh(const Mesh& other) = delete;
+  Mesh& operator=(const Mesh& other) = delete;
+
+  ~Mesh() = default;
+
+  /**
+   * @brief Replace geometry with vertices and faces of Wavefront OBJ file
+   * at `path`. Polygons are split into triangle fans, texture coordinates
+   * and normals are ignored. Errors are reported to stderr.
+   *
+   * @return `false` if file could not be read or has errors
+   */
+  bool loadObj(const char* path);
+
+  /**
+   * @brief Replace geometry with triangles given by triples of `indices`
+   * into `vertices`
+   *
+   * @return `false` if some index is out of range
+   */
+  bool setTriangles(const std::vector<Point>&    vertices,
+                    const std::vector<uint32_t>& indices);
+
+  /**
+   * @brief Absolute path of file mesh was loaded from, empty for meshes
+   * created in memory
+   */
+  const std::string& path() const { return m_path; }
+
+  size_t vertexCount()   const { return m_vertices.size(); }
+  size_t triangleCount() const { return m_indices.size() / 3; }
+
+  /**
+   * @brief Object-space bounds, empty for mesh without triangles
+   */
+  Bounds bounds() const
+  {
+    return m_nodes.empty() ? Bounds() : m_nodes[0].bounds;
+  }
+
+  /**
+   * @brief Closest hit of ray `source + t*direction` with t in
+   * (`t_min`, `t_max`), `INFINITY` if there is none. Direction need not be
+   * normalized. Hit triangle is written to `triangle`.
+   */
+  real intersect(const Point& source, const Vec& direction,
+                 real t_min, real t_max, uint32_t& triangle) const;
+
+  /**
+   * @brief Whether ray `source + t*direction` hits any triangle with t in
+   * (`t_min`, `t_max`). Stops at the first hit found.
+   */
+  bool occludes(const Point& source, const Vec& direction,
+                real t_min, real t_max) const;
+
+  /**
+   * @brief Unnormalized object-space normal of `triangle`, oriented by
+   * counter-clockwise order of its vertices
+   */
+  Vec normal(uint32_t triangle) const
+  {
+    const Point& v_0 = m_vertices[m_indices[3*triangle + 0]];
+    const Point& v_1 = m_vertices[m_indices[3*triangle + 1]];
+    const Point& v_2 = m_vertices[m_indices[3*triangle + 2]];
+    return Vec::crossProduct(v_1 - v_0, v_2 - v_0);
+  }
+
+private:
+  std::string           m_path;
+  std::vector<Point>    m_vertices;
+
+  // Three vertex indices per triangle, ordered as hierarchy leaves
+  std::vector<uint32_t> m_indices;
+  std::vector<BvhNode>  m_nodes;
+
+  void buildHierarchy();
+
+  template <bool AnyHit>
+  real traverse(const Point& source, const Vec& direction,
+                real t_min, real t_max, uint32_t& triangle) const;
+};
+
+#endif /* mesh.h */
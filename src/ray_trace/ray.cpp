@@ -0,0 +1,191 @@
+#include "ray_trace/ray.h"
+
+#include "ray_trace/bvh.h"
+#include "ray_trace/matrix.h"
+#include "ray_trace/transform.h"
+
+/**
+ * @brief Largest coordinate of `world_source` moved to object space of
+ * `transform`, including rounding error of the move
+ */
+template <typename T>
+static T getLocalMagnitude(const VecT<T>& world_source,
+                           const Transform& transform)
+{
+  // Error of world-space coordinates is magnified by inverse scale
+  const Vec& scale     = transform.scale();
+  const T    min_scale = std::min({std::fabs(scale.m_x),
+                                   std::fabs(scale.m_y),
+                                   std::fabs(scale.m_z)});
+  return (getMaxCoordinate(world_source)
+        + getMaxCoordinate(transform.position())) / min_scale;
+}
+
+template <typename T>
+RayHitT<T> RayT<T>::getRayHit(const Scene& scene, size_t index) const
+{
+  // If no object
+  if (index == RayHitT<T>::NO_OBJECT)
+  {
+    // No hit
+    return RayHitT<T>();
+  }
+
+  const ObjectType type = scene.objectType(index);
+
+  // If object is Empty
+  if (type == ObjectType::Empty)
+  {
+    // No hit
+    return RayHitT<T>();
+  }
+
+  // Move ray to object space
+  const Transform& transform = scene.transform(index);
+  RayT transformed(transform.toLocal(m_source),
+                   transform.inverseMatrix()*m_direction,
+                   m_color);
+  const T t_min = getRenderMargin(getLocalMagnitude(m_source, transform));
+
+  RayHitT<T> hit;
+
+  switch (type)
+  {
+  case ObjectType::Sphere:
+    hit = transformed.hitSphere(t_min);
+    break;
+  case ObjectType::Box:
+    hit = transformed.hitBox(t_min);
+    break;
+  case ObjectType::Plane:
+    hit = transformed.hitPlane(t_min);
+    break;
+  case ObjectType::Mesh:
+    hit = transformed.hitMesh(scene.objectMesh(index), t_min);
+    break;
+
+  case ObjectType::Empty:
+  default: return RayHitT<T>();
+  }
+
+  if (!hit.hasHit())
+  {
+    // No hit
+    return RayHitT<T>();
+  }
+
+  hit.m_hitPoint    =  transform.toWorld(hit.m_hitPoint);
+  hit.m_hitNormal   = (transform.normalMatrix()*hit.m_hitNormal).normalized();
+  hit.m_hitDistance = (m_source - hit.m_hitPoint).length();
+  hit.m_hitObject   = index;
+
+  return hit;
+}
+
+template <typename T>
+RayHitT<T> RayT<T>::getClosestRayHit(const Bvh& bvh) const
+{
+  return bvh.getClosestHit(*this);
+}
+
+template <typename T>
+T RayT<T>::getHitDistance(const Scene& scene, size_t index) const
+{
+  // Move ray to object space. Direction is left unnormalized, so that ray
+  // parameter stays equal to world-space distance
+  const Transform& transform = scene.transform(index);
+  const VecT<T> source    = transform.toLocal(m_source);
+  const VecT<T> direction = transform.inverseMatrix()*m_direction;
+
+  // Margin applies along normalized object-space direction
+  const T t_min = getRenderMargin(getLocalMagnitude(m_source, transform))
+                / direction.length();
+
+  switch (scene.objectType(index))
+  {
+  case ObjectType::Sphere:
+    return intersectUnitSphere(source, direction, t_min);
+  case ObjectType::Box:
+    return intersectUnitBox(source, direction, t_min);
+  case ObjectType::Plane:
+    return intersectUnitPlane(source, direction, t_min);
+  case ObjectType::Mesh:
+  {
+    uint32_t triangle = 0;
+    return scene.objectMesh(index).intersect(source, direction, t_min,
+                                             INFINITY, triangle);
+  }
+
+  case ObjectType::Empty:
+  default:
+    return INFINITY;
+  }
+}
+
+template <typename T>
+size_t RayT<T>::getOccluder(const Bvh& bvh, T max_distance) const
+{
+  return bvh.findOccluder(*this, max_distance);
+}
+
+template <typename T>
+RayHitT<T> RayT<T>::hitSphere(T t_min) const
+{
+  const T t = intersectUnitSphere(source(), direction(), t_min);
+  if (!std::isfinite(t))
+  {
+    // No hit
+    return RayHitT<T>();
+  }
+
+  const VecT<T> hit_point  = source() + t * direction();
+  const VecT<T> hit_normal = hit_point.normalized();
+
+  return RayHitT<T>(t, hit_point, hit_normal);
+}
+
+template <typename T>
+RayHitT<T> RayT<T>::hitBox(T t_min) const
+{
+  const T t = intersectUnitBox(source(), direction(), t_min);
+  if (!std::isfinite(t))
+  {
+    // No hit
+    return RayHitT<T>();
+  }
+
+  const VecT<T> hit_point = source() + t*direction();
+  return RayHitT<T>(t, hit_point, getUnitBoxNormal(hit_point));
+}
+
+template <typename T>
+RayHitT<T> RayT<T>::hitPlane(T t_min) const
+{
+  const T t = intersectUnitPlane(source(), direction(), t_min);
+  if (!std::isfinite(t))
+  {
+    // No hit
+    return RayHitT<T>();
+  }
+
+  const VecT<T> hit_point = source() + t*direction();
+  return RayHitT<T>(t, hit_point, VecT<T>::UNIT_Y);
+}
+
+template <typename T>
+RayHitT<T> RayT<T>::hitMesh(const Mesh& mesh, T t_min) const
+{
+  uint32_t triangle = 0;
+  const T t = mesh.intersect(source(), direction(), t_min, INFINITY,
+                             triangle);
+  if (!std::isfinite(t))
+  {
+    // No hit
+    return RayHitT<T>();
+  }
+
+  const VecT<T> hit_point = source() + t*direction();
+  return RayHitT<T>(t, hit_point, mesh.normal(triangle));
+}
+
+template class RayT<real>;
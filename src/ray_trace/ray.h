@@ -0,0 +1,317 @@
+/**
+ * @file ray.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Ray and ray-object intersection
+ *
+ * @version 0.1
+ * @date 2023-09-21
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __RAY_TRACE_RAY_H
+#define __RAY_TRACE_RAY_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "ray_trace/color.h"
+#include "ray_trace/real.h"
+#include "ray_trace/scene.h"
+#include "ray_trace/vec.h"
+
+class Bvh;
+
+/**
+ * @brief Minimal ray parameter (along normalized object-space direction) at
+ * which hit is registered. Keeps rays from hitting surface they start on.
+ */
+constexpr double render_margin=1e-6;
+
+/**
+ * @brief Margin for ray whose object-space source has coordinates up to
+ * `magnitude`. Rounding error of the source grows with its coordinates, and
+ * in single precision it quickly outgrows `render_margin`.
+ */
+template <typename T>
+inline T getRenderMargin(T magnitude)
+{
+  constexpr T relative = 256 * std::numeric_limits<T>::epsilon();
+  return std::max(T(render_margin), relative * magnitude);
+}
+
+template <typename T>
+inline T getMaxCoordinate(const VecT<T>& vec)
+{
+  return std::max({std::fabs(vec.m_x), std::fabs(vec.m_y), std::fabs(vec.m_z)});
+}
+
+/**
+ * @brief Parameter of the first hit of ray `source + t*direction` with unit
+ * sphere after `t_min`, `INFINITY` if there is none. Direction need not be
+ * normalized.
+ */
+template <typename T>
+inline T intersectUnitSphere(const VecT<T>& source, const VecT<T>& direction,
+                             T t_min)
+{
+  // Equation for sphere:
+  // (r, r) = 1
+  // Equation for ray:
+  // r = s + d*t
+  // Equation for intersection:
+  // A = (d, d)
+  // B = 2*(s, d)
+  // C = (s, s) - 1
+  // At^2 + Bt + C = 0
+  const T A      = VecT<T>::dotProduct(direction, direction);
+  const T B_half = VecT<T>::dotProduct(source, direction);
+  const T C      = VecT<T>::dotProduct(source, source) - 1;
+  const T D_half = B_half*B_half - A*C;
+
+  if (D_half < 0)
+  {
+    // No hit
+    return INFINITY;
+  }
+
+  const T D_sqrt = std::sqrt(D_half);
+  const T t_0    = (-B_half - D_sqrt) / A;
+  const T t_1    = (-B_half + D_sqrt) / A;
+
+  if (t_0 > t_min) return t_0;
+  if (t_1 > t_min) return t_1;
+
+  // No hit
+  return INFINITY;
+}
+
+/**
+ * @brief Parameters at which ray with `source` and `direction` coordinates
+ * along one axis crosses planes -1 and 1. Ray parallel to the planes is
+ * either always between them or never, division would give NaN for one
+ * starting on a plane.
+ */
+template <typename T>
+inline void getUnitSlab(T source, T direction, T& t_0, T& t_1)
+{
+  if (!(direction < 0) && !(direction > 0))
+  {
+    const bool is_inside = -1 <= source && source <= 1;
+    t_0 = -T(INFINITY);
+    t_1 = is_inside ? T(INFINITY) : -T(INFINITY);
+    return;
+  }
+
+  t_0 = (-1 - source) / direction;
+  t_1 = ( 1 - source) / direction;
+}
+
+/**
+ * @brief Parameter of the first hit of ray `source + t*direction` with box
+ * [-1, 1]^3 after `t_min`, `INFINITY` if there is none. Direction need not
+ * be normalized.
+ */
+template <typename T>
+inline T intersectUnitBox(const VecT<T>& source, const VecT<T>& direction,
+                          T t_min)
+{
+  // Ray enters slab -1 <= x <= 1 at (-1 - s.x)/d.x and leaves it at
+  // (1 - s.x)/d.x, or the other way round if d.x < 0. Ray is inside the
+  // box between the last entry and the first exit.
+  T tx_0 = 0, tx_1 = 0, ty_0 = 0, ty_1 = 0, tz_0 = 0, tz_1 = 0;
+  getUnitSlab(source.m_x, direction.m_x, tx_0, tx_1);
+  getUnitSlab(source.m_y, direction.m_y, ty_0, ty_1);
+  getUnitSlab(source.m_z, direction.m_z, tz_0, tz_1);
+
+  const T t_near = std::max({std::min(tx_0, tx_1),
+                             std::min(ty_0, ty_1),
+                             std::min(tz_0, tz_1)});
+  const T t_far  = std::min({std::max(tx_0, tx_1),
+                             std::max(ty_0, ty_1),
+                             std::max(tz_0, tz_1)});
+
+  // Rays starting inside the box hit it on exit
+  const T t = t_near > t_min ? t_near : t_far;
+  return t_near <= t_far && t > t_min ? t : T(INFINITY);
+}
+
+/**
+ * @brief Outward normal of box [-1, 1]^3 at `point` on its surface: point
+ * lies on the face across the axis of its largest coordinate
+ */
+template <typename T>
+inline VecT<T> getUnitBoxNormal(const VecT<T>& point)
+{
+  const T abs_x = std::fabs(point.m_x);
+  const T abs_y = std::fabs(point.m_y);
+  const T abs_z = std::fabs(point.m_z);
+
+  if (abs_x >= abs_y && abs_x >= abs_z)
+    return VecT<T>(std::copysign(T(1), point.m_x), 0, 0);
+  if (abs_y >= abs_z)
+    return VecT<T>(0, std::copysign(T(1), point.m_y), 0);
+  return VecT<T>(0, 0, std::copysign(T(1), point.m_z));
+}
+
+/**
+ * @brief Parameter of hit of ray `source + t*direction` with plane y = 0
+ * after `t_min`, `INFINITY` if there is none. Direction need not be
+ * normalized.
+ */
+template <typename T>
+inline T intersectUnitPlane(const VecT<T>& source, const VecT<T>& direction,
+                            T t_min)
+{
+  // Plane equation:
+  // (n, r) = 0
+  // Ray equation:
+  // r = s + d*t
+  // Intersection equation:
+  //     -(n, s)
+  // t = -------
+  //      (n, d)
+  // In standard position n = (0, 1, 0), therefore:
+  // t = -s.y / d.y
+  const T direction_sqr = VecT<T>::dotProduct(direction, direction);
+  if (direction.m_y * direction.m_y
+    < T(render_margin * render_margin) * direction_sqr)
+  {
+    // Plane parallel to ray, no hit
+    return INFINITY;
+  }
+
+  const T t = -source.m_y / direction.m_y;
+  return t > t_min ? t : INFINITY;
+}
+
+template <typename T> class RayT;
+
+template <typename T>
+class RayHitT
+{
+public:
+  friend class RayT<T>;
+  friend class Bvh;
+
+  static constexpr size_t NO_OBJECT = SIZE_MAX;
+
+  RayHitT(const RayHitT& other) = default;
+  RayHitT& operator=(const RayHitT& other) = default;
+
+  T                 distance() const { return m_hitDistance; }
+  const VecT<T>&    point()    const { return m_hitPoint; }
+  const VecT<T>&    normal()   const { return m_hitNormal; }
+
+  /**
+   * @brief Scene index of hit object, `NO_OBJECT` if nothing was hit
+   */
+  size_t            object()   const { return m_hitObject; }
+
+  bool hasHit() const { return std::isfinite(distance()); }
+
+  ~RayHitT() = default;
+private:
+  T       m_hitDistance;
+  VecT<T> m_hitPoint;
+  VecT<T> m_hitNormal;
+  size_t  m_hitObject;
+
+  RayHitT(T              distance   = INFINITY,
+          const VecT<T>& hit_point  = VecT<T>(0, 0, 0),
+          const VecT<T>& hit_normal = VecT<T>(0, 0, 0),
+          size_t         hit_object = NO_OBJECT) :
+    m_hitDistance(distance),
+    m_hitPoint(hit_point),
+    m_hitNormal(hit_normal),
+    m_hitObject(hit_object)
+  {
+  }
+};
+
+/**
+ * @brief Ray with coordinates of type `T`. Scene queries are compiled for
+ * `real` only, as scene itself is stored in it.
+ */
+template <typename T>
+class RayT
+{
+public:
+  RayT(const VecT<T>& point,
+       const VecT<T>& direction,
+       const ColorT<T>& color = ColorT<T>::Black) :
+    RayT(point, direction, color, true)
+  {
+  }
+
+  /**
+   * @brief Ray along `direction`, which is already normalized
+   */
+  static RayT fromNormalized(const VecT<T>& point, const VecT<T>& direction)
+  {
+    return RayT(point, direction, ColorT<T>::Black, false);
+  }
+
+  RayT(const RayT& other) = default;
+  RayT& operator=(const RayT& other) = default;
+
+  ~RayT() = default;
+
+  const VecT<T>& source() const { return m_source; }
+        VecT<T>& source()       { return m_source; }
+
+  const VecT<T>& direction() const { return m_direction; }
+        VecT<T>& direction()       { return m_direction; }
+
+  const ColorT<T>& color() const { return m_color; }
+        ColorT<T>& color()       { return m_color; }
+
+  /**
+   * @brief Intersect ray with object at `index` in `scene`. Objects with
+   * hidden material are not checked here, acceleration structures are
+   * expected to leave them out. `RayHit::NO_OBJECT` yields no hit.
+   */
+  RayHitT<T> getRayHit(const Scene& scene, size_t index) const;
+  RayHitT<T> getClosestRayHit(const Bvh& bvh) const;
+
+  /**
+   * @brief Distance along ray to object at `index` in `scene`, `INFINITY`
+   * if ray misses it. Cheaper than `getRayHit`, as hit point and normal are
+   * not reconstructed.
+   */
+  T getHitDistance(const Scene& scene, size_t index) const;
+
+  /**
+   * @brief Any object which ray hits closer than `max_distance`,
+   * `RayHit::NO_OBJECT` if there is none. Stops at the first one found, so
+   * it need not be the closest.
+   */
+  size_t getOccluder(const Bvh& bvh, T max_distance) const;
+
+private:
+  RayT(const VecT<T>& point, const VecT<T>& direction,
+       const ColorT<T>& color, bool normalize) :
+    m_source(point),
+    m_direction(normalize ? direction.normalized() : direction),
+    m_color(color)
+  {
+  }
+
+  RayHitT<T> hitEmpty () const { return RayHitT<T>(); }
+  RayHitT<T> hitSphere(T t_min) const;
+  RayHitT<T> hitBox   (T t_min) const;
+  RayHitT<T> hitPlane (T t_min) const;
+  RayHitT<T> hitMesh  (const Mesh& mesh, T t_min) const;
+
+  VecT<T>   m_source;
+  VecT<T>   m_direction;
+  ColorT<T> m_color;
+};
+
+using Ray    = RayT<real>;
+using RayHit = RayHitT<real>;
+
+#endif /* ray.h */
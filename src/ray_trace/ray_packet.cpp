@@ -0,0 +1,282 @@
+#include "ray_trace/ray_packet.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "ray_trace/transform.h"
+
+static Real8 getMaxCoordinate(const VecPacket& vec);
+static Real8 hitSphere(const VecPacket& source, const VecPacket& direction,
+                       const Real8& direction_sqr, const Real8& t_min);
+static Real8 hitBox   (const VecPacket& source, const VecPacket& direction,
+                       const Real8& t_min);
+static Real8 hitPlane (const VecPacket& source, const VecPacket& direction,
+                       const Real8& direction_sqr, const Real8& t_min);
+static Real8 hitMesh  (const Mesh& mesh, const VecPacket& source,
+                       const VecPacket& direction, const Real8& t_min,
+                       const Real8& t_max, LaneMask active);
+
+void RayPacket::setRays(const Ray* rays, LaneMask active)
+{
+  real coords[9][SIZE];
+  for (size_t lane = 0; lane < SIZE; ++lane)
+  {
+    const Vec& source        = rays[lane].source();
+    const Vec& direction     = rays[lane].direction();
+    const Vec  inv_direction = Bounds::getInverseDirection(direction);
+
+    coords[0][lane] = source.m_x;
+    coords[1][lane] = source.m_y;
+    coords[2][lane] = source.m_z;
+    coords[3][lane] = direction.m_x;
+    coords[4][lane] = direction.m_y;
+    coords[5][lane] = direction.m_z;
+    coords[6][lane] = inv_direction.m_x;
+    coords[7][lane] = inv_direction.m_y;
+    coords[8][lane] = inv_direction.m_z;
+  }
+
+  m_source       = VecPacket(Real8::load(coords[0]),
+                             Real8::load(coords[1]),
+                             Real8::load(coords[2]));
+  m_direction    = VecPacket(Real8::load(coords[3]),
+                             Real8::load(coords[4]),
+                             Real8::load(coords[5]));
+  m_invDirection = VecPacket(Real8::load(coords[6]),
+                             Real8::load(coords[7]),
+                             Real8::load(coords[8]));
+  m_active = active & Real8::ALL_MASK;
+}
+
+void RayPacket::setRays(const VecPacket& source, const VecPacket& direction,
+                        LaneMask active)
+{
+  // Inverse of zero is infinity of the same sign, clamping it gives the
+  // same huge value as `Bounds::getInverseDirection`
+  constexpr real huge = std::numeric_limits<real>::max();
+
+  m_source       = source;
+  m_direction    = direction;
+  m_invDirection = VecPacket(min(max(1 / direction.m_x, Real8(-huge)),
+                                 Real8(huge)),
+                             min(max(1 / direction.m_y, Real8(-huge)),
+                                 Real8(huge)),
+                             min(max(1 / direction.m_z, Real8(-huge)),
+                                 Real8(huge)));
+  m_active = active & Real8::ALL_MASK;
+}
+
+void RayPacket::getRays(std::vector<Ray>& rays) const
+{
+  real coords[6][SIZE];
+  m_source   .m_x.store(coords[0]);
+  m_source   .m_y.store(coords[1]);
+  m_source   .m_z.store(coords[2]);
+  m_direction.m_x.store(coords[3]);
+  m_direction.m_y.store(coords[4]);
+  m_direction.m_z.store(coords[5]);
+
+  // Overwrite rays in place, pushing new ones back costs more than
+  // computing the whole packet
+  rays.resize(SIZE, Ray::fromNormalized(Point(0, 0, 0), Vec(0, 0, 1)));
+  for (size_t lane = 0; lane < SIZE; ++lane)
+  {
+    rays[lane].source()    = Point(coords[0][lane], coords[1][lane],
+                                   coords[2][lane]);
+    rays[lane].direction() = Vec  (coords[3][lane], coords[4][lane],
+                                   coords[5][lane]);
+    rays[lane].color()     = Color::Black;
+  }
+}
+
+LaneMask BoundsPack::intersect(const Point& source, const Vec& inv_direction,
+                               real t_max) const
+{
+  const Real8 tx_0 = (m_min.m_x - source.m_x) * inv_direction.m_x;
+  const Real8 tx_1 = (m_max.m_x - source.m_x) * inv_direction.m_x;
+  const Real8 ty_0 = (m_min.m_y - source.m_y) * inv_direction.m_y;
+  const Real8 ty_1 = (m_max.m_y - source.m_y) * inv_direction.m_y;
+  const Real8 tz_0 = (m_min.m_z - source.m_z) * inv_direction.m_z;
+  const Real8 tz_1 = (m_max.m_z - source.m_z) * inv_direction.m_z;
+
+  const Real8 t_near = max(max(min(tx_0, tx_1), min(ty_0, ty_1)),
+                             max(min(tz_0, tz_1), Real8(0.0)));
+  const Real8 t_far  = min(min(max(tx_0, tx_1), max(ty_0, ty_1)),
+                             min(max(tz_0, tz_1), Real8(t_max)));
+
+  return t_near <= t_far;
+}
+
+LaneMask RayPacket::intersect(const Bounds& bounds, const Real8& t_max,
+                              LaneMask active) const
+{
+  const Real8 tx_0 = (bounds.min().m_x - m_source.m_x) * m_invDirection.m_x;
+  const Real8 tx_1 = (bounds.max().m_x - m_source.m_x) * m_invDirection.m_x;
+  const Real8 ty_0 = (bounds.min().m_y - m_source.m_y) * m_invDirection.m_y;
+  const Real8 ty_1 = (bounds.max().m_y - m_source.m_y) * m_invDirection.m_y;
+  const Real8 tz_0 = (bounds.min().m_z - m_source.m_z) * m_invDirection.m_z;
+  const Real8 tz_1 = (bounds.max().m_z - m_source.m_z) * m_invDirection.m_z;
+
+  const Real8 t_near = max(max(min(tx_0, tx_1), min(ty_0, ty_1)),
+                             max(min(tz_0, tz_1), Real8(0.0)));
+  const Real8 t_far  = min(min(max(tx_0, tx_1), max(ty_0, ty_1)),
+                             min(max(tz_0, tz_1), t_max));
+
+  return active & (t_near <= t_far);
+}
+
+void RayPacket::intersect(const Scene& scene, size_t index, LaneMask active,
+                          PacketHit& hit) const
+{
+  if (active == 0)
+    return;
+
+  // Move rays to object space. Directions are left unnormalized, so that
+  // ray parameter stays equal to world-space distance
+  const Transform& transform = scene.transform(index);
+  const VecPacket source    = transform.inverseMatrix()
+                            * (m_source - VecPacket(transform.position()));
+  const VecPacket direction = transform.inverseMatrix() * m_direction;
+  const Real8 direction_sqr = VecPacket::dotProduct(direction, direction);
+
+  // Same robust margin as in Ray::getClosestRayHit, computed per lane and
+  // applied along normalized object-space direction
+  const Vec&  scale     = transform.scale();
+  const real  min_scale = std::min({std::fabs(scale.m_x),
+                                    std::fabs(scale.m_y),
+                                    std::fabs(scale.m_z)});
+  const Real8 magnitude = (getMaxCoordinate(m_source)
+                         + getMaxCoordinate(transform.position()))
+                        / min_scale;
+  constexpr real relative = 256 * std::numeric_limits<real>::epsilon();
+  const Real8 t_min = max(Real8(render_margin), relative * magnitude)
+                    / sqrt(direction_sqr);
+
+  Real8 t = INFINITY;
+  switch (scene.objectType(index))
+  {
+  case ObjectType::Sphere:
+    t = hitSphere(source, direction, direction_sqr, t_min);
+    break;
+  case ObjectType::Box:
+    t = hitBox(source, direction, t_min);
+    break;
+  case ObjectType::Plane:
+    t = hitPlane(source, direction, direction_sqr, t_min);
+    break;
+  case ObjectType::Mesh:
+    t = hitMesh(scene.objectMesh(index), source, direction, t_min,
+                hit.distance, active);
+    break;
+
+  case ObjectType::Empty:
+  default:
+    return;
+  }
+
+  const LaneMask closer = active & (t < hit.distance);
+  if (closer == 0)
+    return;
+
+  hit.distance = select(closer, t, hit.distance);
+  for (size_t lane = 0; lane < SIZE; ++lane)
+    if ((closer >> lane) & 1)
+      hit.object[lane] = uint32_t(index);
+}
+
+static Real8 getMaxCoordinate(const VecPacket& vec)
+{
+  const Real8 abs_x = max(vec.m_x, -vec.m_x);
+  const Real8 abs_y = max(vec.m_y, -vec.m_y);
+  const Real8 abs_z = max(vec.m_z, -vec.m_z);
+  return max(max(abs_x, abs_y), abs_z);
+}
+
+static Real8 hitSphere(const VecPacket& source, const VecPacket& direction,
+                       const Real8& direction_sqr, const Real8& t_min)
+{
+  // Same equation as in intersectUnitSphere with A = (d, d)
+  const Real8 B_half = VecPacket::dotProduct(source, direction);
+  const Real8 C      = VecPacket::dotProduct(source, source) - 1;
+  const Real8 D_half = B_half*B_half - direction_sqr*C;
+
+  const LaneMask has_roots = D_half >= 0;
+
+  const Real8 D_sqrt = sqrt(max(D_half, 0));
+  const Real8 t_0    = (-B_half - D_sqrt) / direction_sqr;
+  const Real8 t_1    = (-B_half + D_sqrt) / direction_sqr;
+
+  const Real8 t_res = select(t_0 > t_min, t_0,
+                        select(t_1 > t_min, t_1, INFINITY));
+  return select(has_roots, t_res, INFINITY);
+}
+
+/**
+ * @brief Lane-wise `getUnitSlab`
+ */
+static void getUnitSlab(const Real8& source, const Real8& direction,
+                        Real8& t_0, Real8& t_1)
+{
+  const LaneMask parallel = ~(direction < 0) & ~(direction > 0);
+  const LaneMask inside   = (source >= -1) & (source <= 1);
+
+  t_0 = select(parallel, -INFINITY, (-1 - source) / direction);
+  t_1 = select(parallel, select(inside, Real8(INFINITY), Real8(-INFINITY)),
+               (1 - source) / direction);
+}
+
+static Real8 hitBox   (const VecPacket& source, const VecPacket& direction,
+                       const Real8& t_min)
+{
+  // Same slabs as in intersectUnitBox
+  Real8 tx_0 = 0, tx_1 = 0, ty_0 = 0, ty_1 = 0, tz_0 = 0, tz_1 = 0;
+  getUnitSlab(source.m_x, direction.m_x, tx_0, tx_1);
+  getUnitSlab(source.m_y, direction.m_y, ty_0, ty_1);
+  getUnitSlab(source.m_z, direction.m_z, tz_0, tz_1);
+
+  const Real8 t_near = max(max(min(tx_0, tx_1), min(ty_0, ty_1)),
+                           min(tz_0, tz_1));
+  const Real8 t_far  = min(min(max(tx_0, tx_1), max(ty_0, ty_1)),
+                           max(tz_0, tz_1));
+
+  const Real8 t = select(t_near > t_min, t_near, t_far);
+  return select((t_near <= t_far) & (t > t_min), t, INFINITY);
+}
+
+static Real8 hitPlane (const VecPacket& source, const VecPacket& direction,
+                       const Real8& direction_sqr, const Real8& t_min)
+{
+  // Same equation as in intersectUnitPlane, t = -s.y / d.y
+  const LaneMask parallel = direction.m_y * direction.m_y
+                          < render_margin * render_margin * direction_sqr;
+
+  const Real8 t = -source.m_y / direction.m_y;
+
+  return select(~parallel & (t > t_min), t, INFINITY);
+}
+
+static Real8 hitMesh  (const Mesh& mesh, const VecPacket& source,
+                       const VecPacket& direction, const Real8& t_min,
+                       const Real8& t_max, LaneMask active)
+{
+  // Lanes diverge inside triangle hierarchy, so they traverse it one by one
+  real t[RayPacket::SIZE];
+  for (size_t lane = 0; lane < RayPacket::SIZE; ++lane)
+  {
+    t[lane] = INFINITY;
+    if (((active >> lane) & 1) == 0)
+      continue;
+
+    const Point lane_source   (source.m_x[lane],    source.m_y[lane],
+                               source.m_z[lane]);
+    const Vec   lane_direction(direction.m_x[lane], direction.m_y[lane],
+                               direction.m_z[lane]);
+
+    uint32_t triangle = 0;
+    t[lane] = mesh.intersect(lane_source, lane_direction,
+                             t_min[lane], t_max[lane], triangle);
+  }
+
+  return Real8::load(t);
+}
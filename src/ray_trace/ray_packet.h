@@ -0,0 +1,197 @@
+/**
+ * @file ray_packet.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Group of coherent rays traced together
+ *
+ * @version 0.1
+ * @date 2023-09-24
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __RAY_TRACE_RAY_PACKET_H
+#define __RAY_TRACE_RAY_PACKET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ray_trace/bounds.h"
+#include "ray_trace/matrix.h"
+#include "ray_trace/ray.h"
+#include "ray_trace/scene.h"
+#include "ray_trace/simd.h"
+#include "ray_trace/vec.h"
+
+/**
+ * @brief One coordinate array per axis, each lane is a separate vector
+ */
+struct VecPacket
+{
+  Real8 m_x, m_y, m_z;
+
+  VecPacket() : m_x(), m_y(), m_z() {}
+  VecPacket(const Real8& x, const Real8& y, const Real8& z) :
+    m_x(x), m_y(y), m_z(z)
+  {
+  }
+  explicit VecPacket(const Vec& vec) :
+    m_x(vec.m_x), m_y(vec.m_y), m_z(vec.m_z)
+  {
+  }
+
+  VecPacket operator+(const VecPacket& other) const
+  {
+    return VecPacket(m_x + other.m_x, m_y + other.m_y, m_z + other.m_z);
+  }
+  VecPacket operator-(const VecPacket& other) const
+  {
+    return VecPacket(m_x - other.m_x, m_y - other.m_y, m_z - other.m_z);
+  }
+  VecPacket operator*(const Real8& scale) const
+  {
+    return VecPacket(m_x * scale, m_y * scale, m_z * scale);
+  }
+
+  static Real8 dotProduct(const VecPacket& vec1, const VecPacket& vec2)
+  {
+    return vec1.m_x * vec2.m_x
+         + vec1.m_y * vec2.m_y
+         + vec1.m_z * vec2.m_z;
+  }
+};
+
+inline VecPacket operator*(const Matrix& matrix, const VecPacket& vec)
+{
+  return VecPacket(
+    matrix[0][0]*vec.m_x + matrix[0][1]*vec.m_y + matrix[0][2]*vec.m_z,
+    matrix[1][0]*vec.m_x + matrix[1][1]*vec.m_y + matrix[1][2]*vec.m_z,
+    matrix[2][0]*vec.m_x + matrix[2][1]*vec.m_y + matrix[2][2]*vec.m_z);
+}
+
+/**
+ * @brief Eight boxes with one coordinate array per bound, so that a single
+ * ray is tested against all of them at once
+ */
+struct BoundsPack
+{
+  VecPacket m_min, m_max;
+
+  BoundsPack(const VecPacket& min, const VecPacket& max) :
+    m_min(min), m_max(max)
+  {
+  }
+
+  /**
+   * @brief Load eight boxes from six rows of `coords`, `stride` elements
+   * apart: minimal x, y and z coordinates followed by maximal ones
+   */
+  static BoundsPack load(const real* coords, size_t stride)
+  {
+    return BoundsPack(VecPacket(Real8::load(coords + 0 * stride),
+                                Real8::load(coords + 1 * stride),
+                                Real8::load(coords + 2 * stride)),
+                      VecPacket(Real8::load(coords + 3 * stride),
+                                Real8::load(coords + 4 * stride),
+                                Real8::load(coords + 5 * stride)));
+  }
+
+  /**
+   * @brief Slab test of ray `source + t*direction` against every box
+   *
+   * @param[in] inv_direction  Inverse of ray direction, as given by
+   *                           `Bounds::getInverseDirection`
+   *
+   * @return Boxes which ray enters at some t in [0, `t_max`]
+   */
+  LaneMask intersect(const Point& source, const Vec& inv_direction,
+                     real t_max) const;
+};
+
+/**
+ * @brief Closest hits found for each lane of a packet
+ */
+struct PacketHit
+{
+  Real8  distance;
+  uint32_t object[Real8::SIZE];
+
+  PacketHit() : distance(INFINITY), object{}
+  {
+    for (size_t i = 0; i < Real8::SIZE; ++i)
+      object[i] = uint32_t(-1);
+  }
+
+  /**
+   * @brief Scene index of object hit by lane, `RayHit::NO_OBJECT` if none
+   */
+  size_t objectAt(size_t lane) const
+  {
+    return object[lane] == uint32_t(-1) ? RayHit::NO_OBJECT : object[lane];
+  }
+};
+
+class RayPacket
+{
+public:
+  static constexpr size_t SIZE = Real8::SIZE;
+
+  /**
+   * @brief Create packet with no active lanes
+   */
+  RayPacket() :
+    m_source(), m_direction(), m_invDirection(), m_active(0)
+  {
+  }
+
+  RayPacket(const RayPacket& other) = default;
+  RayPacket& operator=(const RayPacket& other) = default;
+
+  ~RayPacket() = default;
+
+  /**
+   * @brief Fill all lanes from `rays`, activating those in `active`
+   */
+  void setRays(const Ray* rays, LaneMask active);
+
+  /**
+   * @brief Fill lanes from `source` and already normalized `direction`,
+   * activating those in `active`
+   */
+  void setRays(const VecPacket& source, const VecPacket& direction,
+               LaneMask active);
+
+  /**
+   * @brief Replace contents of `rays` with rays of all lanes
+   */
+  void getRays(std::vector<Ray>& rays) const;
+
+  LaneMask activeMask() const { return m_active; }
+
+  const VecPacket& source()           const { return m_source; }
+  const VecPacket& direction()        const { return m_direction; }
+  const VecPacket& inverseDirection() const { return m_invDirection; }
+
+  /**
+   * @brief Slab test of every lane against `bounds`
+   *
+   * @return Lanes of `active` which enter the box before `t_max`
+   */
+  LaneMask intersect(const Bounds& bounds, const Real8& t_max,
+                     LaneMask active) const;
+
+  /**
+   * @brief Intersect lanes of `active` with object at `index` in `scene`,
+   * recording hits closer than those already in `hit`
+   */
+  void intersect(const Scene& scene, size_t index, LaneMask active,
+                 PacketHit& hit) const;
+
+private:
+  VecPacket m_source;
+  VecPacket m_direction;
+  VecPacket m_invDirection;
+  LaneMask  m_active;
+};
+
+#endif /* ray_packet.h */
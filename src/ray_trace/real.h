@@ -0,0 +1,39 @@
+/**
+ * @file real.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Floating-point type used by the tracer and build options of math
+ * types
+ *
+ * @version 0.1
+ * @date 2023-09-27
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __RAY_TRACE_REAL_H
+#define __RAY_TRACE_REAL_H
+
+/**
+ * @brief Scalar type of vectors, matrices, colors and rays. Math types are
+ * templates over it, build with `RAY_TRACE_SINGLE_PRECISION` defined to
+ * trace in `float` instead of `double`.
+ */
+#ifdef RAY_TRACE_SINGLE_PRECISION
+using real = float;
+#else
+using real = double;
+#endif
+
+/**
+ * @brief Checked math, enabled in debug builds, fills destroyed vectors
+ * with NaN to catch dangling references. This gives them a destructor, so
+ * only unchecked builds have trivially copyable math types and math
+ * constants usable in constant expressions.
+ */
+#ifdef RAY_TRACE_CHECKED_MATH
+#define RAY_TRACE_MATH_CONSTEXPR const
+#else
+#define RAY_TRACE_MATH_CONSTEXPR constexpr
+#endif
+
+#endif /* real.h */
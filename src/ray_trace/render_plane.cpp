@@ -0,0 +1,54 @@
+#include "ray_trace/render_plane.h"
+
+#include <algorithm>
+
+/**
+ * @brief Half of the longer side of a plane, which spans [-1, 1] of camera
+ * field of view
+ */
+static double getHalfSpan(size_t width, size_t height)
+{
+  return double(std::max(width, height) / 2);
+}
+
+RenderPlane::RenderPlane(const Camera& camera,
+                         size_t width,
+                         size_t height,
+                         double pixel_size) :
+  m_width(width),
+  m_height(height),
+  m_sourceStepX   ( camera.transform().right() * pixel_size),
+  m_sourceStepY   (-camera.transform().up()    * pixel_size),
+  m_directionStepX( camera.transform().right()
+                  * (1 / getHalfSpan(width, height))),
+  m_directionStepY(-camera.transform().up()
+                  * (1 / getHalfSpan(width, height))),
+  m_source        (camera.transform().position()
+                  - m_sourceStepX * double(width  / 2)
+                  - m_sourceStepY * double(height / 2)),
+  m_direction     (camera.transform().forward() * camera.focalLength()
+                  - m_directionStepX * double(width  / 2)
+                  - m_directionStepY * double(height / 2))
+{
+}
+
+void RenderPlane::getPacketFrom(const real* x, const real* y,
+                                LaneMask active, RayPacket& packet,
+                                std::vector<Ray>& rays) const
+{
+  const Real8 lane_x = Real8::load(x);
+  const Real8 lane_y = Real8::load(y);
+
+  const VecPacket source = VecPacket(m_source)
+                         + VecPacket(m_sourceStepX) * lane_x
+                         + VecPacket(m_sourceStepY) * lane_y;
+  const VecPacket direction = VecPacket(m_direction)
+                            + VecPacket(m_directionStepX) * lane_x
+                            + VecPacket(m_directionStepY) * lane_y;
+
+  const Real8 inv_length =
+      1 / sqrt(VecPacket::dotProduct(direction, direction));
+
+  packet.setRays(source, direction * inv_length, active);
+  packet.getRays(rays);
+}
@@ -0,0 +1,82 @@
+/**
+ * @file render_plane.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Generation of primary rays through camera image plane
+ *
+ * @version 0.1
+ * @date 2023-10-03
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __RAY_TRACE_RENDER_PLANE_H
+#define __RAY_TRACE_RENDER_PLANE_H
+
+#include <cstddef>
+#include <vector>
+
+#include "ray_trace/camera.h"
+#include "ray_trace/ray.h"
+#include "ray_trace/ray_packet.h"
+#include "ray_trace/real.h"
+#include "ray_trace/simd.h"
+#include "ray_trace/vec.h"
+
+/**
+ * @brief Camera image plane divided into `width` by `height` sample cells.
+ * Both source and direction of a ray are affine in plane coordinates, so
+ * camera basis, focal length and steps per cell are computed once per
+ * frame, and each ray costs a few multiply-adds and a normalization.
+ */
+class RenderPlane
+{
+public:
+  /**
+   * @brief Plane of `camera` with cells `pixel_size` apart in scene units
+   */
+  RenderPlane(const Camera& camera,
+              size_t width,
+              size_t height,
+              double pixel_size);
+  RenderPlane(const RenderPlane& other) = default;
+  RenderPlane& operator=(const RenderPlane& other) = default;
+
+  ~RenderPlane() = default;
+
+  size_t width()  const { return m_width; }
+  size_t height() const { return m_height; }
+
+  /**
+   * @brief Ray through point (`x`, `y`) of the plane, measured in samples
+   * from its top left corner. Integer coordinates give the corners of
+   * sample cells.
+   */
+  Ray getRayFrom(double x, double y) const
+  {
+    return Ray(m_source    + m_sourceStepX    * x + m_sourceStepY    * y,
+               m_direction + m_directionStepX * x + m_directionStepY * y);
+  }
+
+  /**
+   * @brief Fill `packet` with rays through points (`x[i]`, `y[i]`) of the
+   * plane, activating lanes in `active`, and store the same rays in
+   * `rays`. Rays of all lanes are computed at once.
+   */
+  void getPacketFrom(const real* x, const real* y, LaneMask active,
+                     RayPacket& packet, std::vector<Ray>& rays) const;
+
+private:
+  size_t m_width;
+  size_t m_height;
+
+  // Changes of ray per cell right and down, and ray through top left
+  // corner
+  Vec    m_sourceStepX;
+  Vec    m_sourceStepY;
+  Vec    m_directionStepX;
+  Vec    m_directionStepY;
+  Point  m_source;
+  Vec    m_direction;
+};
+
+#endif /* render_plane.h */
@@ -0,0 +1,113 @@
+#include "ray_trace/render_thread.h"
+
+#include <cstring>
+
+void RenderedFrame::copyRect(const ImageRect& rect, Pixel* destination) const
+{
+  for (size_t y = 0; y < rect.height; ++y)
+    memcpy(destination + y * rect.width,
+           pixels.data() + (rect.y + y) * width + rect.x,
+           rect.width * sizeof(Pixel));
+}
+
+RenderThread::RenderThread(size_t width, size_t height,
+                           const Camera& camera) :
+  m_renderer(width, height),
+  m_scenes(camera),
+  m_frames(),
+  m_pendingRects(),
+  m_thread(),
+  m_stopping(false),
+  m_mutex(),
+  m_wakeUp()
+{
+}
+
+RenderThread::~RenderThread()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+  m_wakeUp.notify_one();
+
+  if (m_thread.joinable())
+    m_thread.join();
+}
+
+void RenderThread::start()
+{
+  if (!m_thread.joinable())
+    m_thread = std::thread(&RenderThread::renderLoop, this);
+}
+
+void RenderThread::publishScene(const Scene& scene)
+{
+  m_scenes.back().assign(scene);
+  m_scenes.publish();
+
+  // Taking the lock orders notification after render thread either saw
+  // new scene or started waiting
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+  }
+  m_wakeUp.notify_one();
+}
+
+void RenderThread::renderLoop()
+{
+  bool has_scene = false;
+  bool is_idle   = false;
+
+  while (!m_stopping)
+  {
+    if (m_scenes.take())
+    {
+      has_scene = true;
+      is_idle   = false;
+    }
+
+    // Unchanged scene which traced nothing last frame will not trace
+    // anything now, wait for a new one
+    if (!has_scene || is_idle)
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wakeUp.wait(lock, [this]()
+      {
+        return m_stopping || m_scenes.hasFresh();
+      });
+      continue;
+    }
+
+    m_renderer.renderScene(m_scenes.front());
+    is_idle = m_renderer.tracedSamples() == 0;
+
+    if (!m_renderer.updatedRects().empty())
+      publishFrame();
+  }
+}
+
+void RenderThread::publishFrame()
+{
+  // Display already has everything before this frame
+  if (!m_frames.hasFresh())
+    m_pendingRects.clear();
+
+  const std::vector<ImageRect>& updated = m_renderer.updatedRects();
+  m_pendingRects.insert(m_pendingRects.end(), updated.begin(), updated.end());
+
+  const size_t width  = m_renderer.width();
+  const size_t height = m_renderer.height();
+  if (m_pendingRects.size() > MAX_PENDING_RECTS)
+    m_pendingRects.assign(1, ImageRect{0, 0, width, height});
+
+  // Back slot holds some older frame, so the whole image is copied
+  RenderedFrame& frame = m_frames.back();
+  frame.width  = width;
+  frame.height = height;
+  frame.pixels.assign(m_renderer.pixels(),
+                      m_renderer.pixels() + width * height);
+  frame.updatedRects = m_pendingRects;
+
+  m_frames.publish();
+}
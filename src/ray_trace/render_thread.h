@@ -0,0 +1,123 @@
+/**
+ * @file render_thread.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Renderer running on its own thread, apart from user interface
+ *
+ * @version 0.1
+ * @date 2023-09-28
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __RAY_TRACE_RENDER_THREAD_H
+#define __RAY_TRACE_RENDER_THREAD_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ray_trace/camera.h"
+#include "ray_trace/renderer.h"
+#include "ray_trace/scene.h"
+#include "ray_trace/triple_buffer.h"
+
+/**
+ * @brief Image produced by render thread
+ */
+struct RenderedFrame
+{
+  size_t                 width;
+  size_t                 height;
+  std::vector<Pixel>     pixels;
+
+  /**
+   * @brief Parts of image which changed since previous frame taken by
+   * display thread
+   */
+  std::vector<ImageRect> updatedRects;
+
+  RenderedFrame() : width(0), height(0), pixels(), updatedRects() {}
+
+  /**
+   * @brief Copy pixels of `rect` row by row into `destination`, which
+   * must hold `rect.width * rect.height` pixels
+   */
+  void copyRect(const ImageRect& rect, Pixel* destination) const;
+};
+
+/**
+ * @brief Thread which renders snapshots of scene published by user
+ * interface and hands finished frames back. Neither side waits for the
+ * other: display shows the latest finished frame, renderer works on the
+ * latest published scene.
+ */
+class RenderThread
+{
+public:
+  /**
+   * @brief Create thread producing `width` by `height` images. Scene
+   * snapshots start as empty scenes seen by `camera`.
+   */
+  RenderThread(size_t width, size_t height, const Camera& camera);
+
+  RenderThread(const RenderThread& other) = delete;
+  RenderThread& operator=(const RenderThread& other) = delete;
+
+  /**
+   * @brief Stop rendering, waiting for current frame to finish
+   */
+  ~RenderThread();
+
+  /**
+   * @brief Renderer used by the thread. It may only be configured before
+   * `start()`.
+   */
+  Renderer& renderer() { return m_renderer; }
+
+  void start();
+
+  /**
+   * @brief Copy `scene` for rendering. Copy shares objects with `scene`
+   * until either changes them, so `scene` may only be changed by display
+   * thread. Called from display thread.
+   */
+  void publishScene(const Scene& scene);
+
+  /**
+   * @brief Make the latest finished frame available through `frame()`.
+   * Called from display thread.
+   *
+   * @return `false` if no frame was finished since last call
+   */
+  bool takeFrame() { return m_frames.take(); }
+
+  const RenderedFrame& frame() const { return m_frames.front(); }
+
+private:
+  /**
+   * @brief Send whole image instead of separate rects past this count
+   */
+  static constexpr size_t MAX_PENDING_RECTS = 256;
+
+  Renderer                    m_renderer;
+  TripleBuffer<Scene>         m_scenes;
+  TripleBuffer<RenderedFrame> m_frames;
+
+  // Rects changed since previous frame taken by display thread
+  std::vector<ImageRect>      m_pendingRects;
+
+  std::thread                 m_thread;
+  std::atomic<bool>           m_stopping;
+
+  // Only wake up idle render thread, scenes and frames are not guarded
+  std::mutex                  m_mutex;
+  std::condition_variable     m_wakeUp;
+
+  void renderLoop();
+  void publishFrame();
+};
+
+#endif /* render_thread.h */
@@ -1,508 +1,2094 @@
 #include "ray_trace/renderer.h"
 
-#include <SFML/Config.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <vector>
 
+#include "ray_trace/bvh.h"
 #include "ray_trace/color.h"
 #include "ray_trace/material.h"
 #include "ray_trace/matrix.h"
+#include "ray_trace/ray.h"
+#include "ray_trace/ray_packet.h"
+#include "ray_trace/render_plane.h"
 #include "ray_trace/scene.h"
 #include "ray_trace/scene_object.h"
 #include "ray_trace/transform.h"
 
-constexpr double render_margin=1e-6;
-
-class RayHit
+/**
+ * @brief Records footprint of rays traced for one tile. Does nothing if
+ * footprints are not tracked.
+ */
+class RayLog
 {
 public:
-  friend class Ray;
-
-  RayHit(const RayHit& other) = default;
-  RayHit& operator=(const RayHit& other) = default;
+  RayLog(TileFootprint* footprint, const Bounds& region) :
+    m_footprint(footprint), m_region(region)
+  {
+  }
+  RayLog(const RayLog& other) = delete;
+  RayLog& operator=(const RayLog& other) = delete;
 
-  double             distance() const { return m_hitDistance; }
-  const Point&       point()    const { return m_hitPoint; }
-  const Vec&         normal()   const { return m_hitNormal; }
-  const SceneObject* object()   const { return m_hitObject; }
+  ~RayLog()
+  {
+    if (!m_footprint)
+      return;
 
-  bool hasHit() const { return std::isfinite(distance()); }
+    // Keep objects sorted for binary search
+    std::vector<uint32_t>& objects = m_footprint->objects;
+    std::sort(objects.begin(), objects.end());
+    objects.erase(std::unique(objects.begin(), objects.end()), objects.end());
+  }
 
-  ~RayHit() = default;
-private:
-  double             m_hitDistance;
-  Point              m_hitPoint;
-  Vec                m_hitNormal;
-  const SceneObject* m_hitObject;
+  void addObject(size_t index)
+  {
+    if (m_footprint && index != RayHit::NO_OBJECT)
+      m_footprint->objects.push_back(uint32_t(index));
+  }
 
-  RayHit(double       distance         = INFINITY,
-         const Point& hit_point        = Vec(0, 0, 0),
-         const Vec& hit_normal         = Vec(0, 0, 0),
-         const SceneObject* hit_object = nullptr) :
-    m_hitDistance(distance),
-    m_hitPoint(hit_point),
-    m_hitNormal(hit_normal),
-    m_hitObject(hit_object)
+  /**
+   * @brief Record part of `ray` up to `distance` lying inside tracked
+   * region
+   */
+  void addSegment(const Ray& ray, real distance)
   {
+    if (!m_footprint)
+      return;
+
+    // Axis-aligned rays need clamped inverse to keep slab test NaN-free
+    const Vec& direction     = ray.direction();
+    const Vec  inv_direction = Bounds::getInverseDirection(direction);
+
+    real t_entry = 0, t_exit = 0;
+    if (!m_region.clip(ray.source(), inv_direction, distance,
+                       t_entry, t_exit))
+      return;
+
+    m_footprint->rays |= ray.source() + direction * t_entry;
+    m_footprint->rays |= ray.source() + direction * t_exit;
   }
+
+private:
+  TileFootprint* m_footprint;
+  const Bounds&  m_region;
 };
 
-class Ray
+/**
+ * @brief Objects which last blocked shadow rays towards each light. Shadow
+ * rays of neighbouring pixels are usually blocked by the same object, so it
+ * is tested before searching the whole hierarchy.
+ */
+class ShadowCache
 {
 public:
-  Ray(const Point& point,
-      const Vec& direction,
-      const Color& color = Color::Black) :
-    m_source(point),
-    m_direction(direction.normalized()),
-    m_color(color)
+  ShadowCache() : m_occluders() {}
+
+  /**
+   * @brief Last occluder for light in `slot`, `RayHit::NO_OBJECT` if none
+   */
+  size_t& lastOccluder(size_t slot)
   {
+    if (slot >= m_occluders.size())
+      m_occluders.resize(slot + 1, RayHit::NO_OBJECT);
+
+    return m_occluders[slot];
   }
-  Ray(const Ray& other) = default;
-  Ray& operator=(const Ray& other) = default;
 
-  ~Ray() = default;
+private:
+  std::vector<size_t> m_occluders;
+};
 
-  const Vec& source() const { return m_source; }
-        Vec& source()       { return m_source; }
+/**
+ * @brief Counter-based random numbers of one sample: n-th number is a hash
+ * of sample key and n, no state is carried from other samples. Key depends
+ * only on pixel, frame and sample index, so images do not depend on thread
+ * count or tile order.
+ */
+class SampleRandom
+{
+public:
+  SampleRandom() : m_key(0), m_counter(0) {}
 
-  const Vec& direction() const { return m_direction; }
-        Vec& direction()       { return m_direction; }
+  void seed(uint64_t key)
+  {
+    m_key     = key;
+    m_counter = 0;
+  }
 
-  const Color& color() const { return m_color; }
-        Color& color()       { return m_color; }
+  /**
+   * @brief Uniformly distributed number in [0, 1)
+   */
+  double next()
+  {
+    // SplitMix64 output function of key advanced by counter
+    uint64_t value = m_key + ++m_counter * 0x9E3779B97F4A7C15ull;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    value =  value ^ (value >> 31);
 
-  RayHit getRayHit(const SceneObject& object);
-  RayHit getClosestRayHit(const Scene& scene);
+    return double(value >> 11) * 0x1.0p-53;
+  }
 
 private:
-  RayHit hitEmpty () const { return RayHit(); }
-  RayHit hitSphere() const;
-  RayHit hitBox   () const;
-  RayHit hitPlane () const;
-
-  Point m_source;
-  Vec   m_direction;
-  Color m_color;
+  uint64_t m_key;
+  uint64_t m_counter;
 };
 
-class RenderPlane
+/**
+ * @brief Picks lights to trace shadow rays to, when not tracing all of
+ * them
+ */
+class LightSampler
 {
 public:
-  RenderPlane(const Camera& camera,
-              size_t width,
-              size_t height,
-              double pixel_size) :
-    m_camera(camera), m_width(width), m_height(height), m_pixelSize(pixel_size)
+  LightSampler(const LightTree* tree, size_t sample_count) :
+    m_tree(tree), m_sampleCount(sample_count)
   {
   }
-  RenderPlane(const RenderPlane& other) = default;
-  RenderPlane& operator=(const RenderPlane& other) = delete;
-
-  size_t width()  const { return m_width; }
-  size_t height() const { return m_height; }
-
-  Ray getRayFrom(size_t x, size_t y) const
+  LightSampler(const LightSampler& other) = delete;
+  LightSampler& operator=(const LightSampler& other) = delete;
+
+  bool   isEnabled()   const { return m_tree != nullptr; }
+  size_t sampleCount() const { return m_sampleCount; }
+
+  /**
+   * @brief Index of light in `Scene::lights()` to shade surface at
+   * `point` with `normal` by, `LightTree::NO_LIGHT` if there is none
+   */
+  size_t sample(const Point& point, const Vec& normal, SampleRandom& random,
+                double& probability) const
   {
-    const size_t max_dim    = m_width > m_height ? m_width : m_height;
-    const long   mid_x      = m_width  / 2;
-    const long   mid_y      = m_height / 2;
-    const long   max_offset = max_dim / 2;
-
-    const long x_offset = (long) x - mid_x;
-    const long y_offset = (long) mid_y - y;
-    const Vec direction = m_camera.getDirectionAt(
-                                    (double) x_offset / max_offset,
-                                    (double) y_offset / max_offset);
-    const Point start = m_camera.transform().position()
-                      + m_pixelSize * (
-                          m_camera.transform().right() * x_offset
-                        + m_camera.transform().up()    * y_offset);
-    return Ray(start, direction);
+    return m_tree->sample(point, normal, random.next(), probability);
   }
 
-  ~RenderPlane() = default;
-
 private:
-  const Camera& m_camera;
-  size_t        m_width;
-  size_t        m_height;
-  double        m_pixelSize;
+  const LightTree* m_tree;
+  size_t           m_sampleCount;
 };
 
-static Color rayCast(const Ray& ray, const Scene& scene,
-                     size_t max_reflections=0);
+/**
+ * @brief Sample traced by wavefront engine, from camera ray through its
+ * reflections
+ */
+struct WavefrontPath
+{
+  Ray             ray;
+  SampleRandom    random;
+  Color           color;        // Light gathered so far
+  double          throughput;   // Weight of `ray` in sample color
+  Color           filter;       // Color of surfaces path scattered off
+  uint32_t        sample;       // Index in list of traced samples
+  uint32_t        reflections;
+  bool            isActive;     // Whether `ray` is still to be traced
+  bool            isDiffuse;    // Whether `ray` was scattered diffusely
+
+  // Surface hit by last ray, finished once its shadow rays are traced
+  const Material* material;
+  double          cosine;
+  double          weight;
+  Color           tint;         // Filter of path at the surface
+  Color           light;
+};
+
+/**
+ * @brief Shadow ray towards one light, queued by wavefront engine
+ */
+struct WavefrontShadow
+{
+  Ray      ray;
+  real     distance;
+  Color    light;               // Added to path if nothing blocks the ray
+  uint32_t path;
+  uint32_t slot;                // Occluder cache slot of the light
+};
+
+/**
+ * @brief Ray queues of wavefront engine. Their sizes are capped, so
+ * memory does not grow with image size or sample count.
+ */
+struct WavefrontQueues
+{
+  static constexpr size_t MAX_PATHS   = 1024;
+  static constexpr size_t MAX_SHADOWS = 4096;
+
+  // Queue positions are stored in low bits of sort keys
+  static constexpr size_t   SORT_INDEX_BITS = 16;
+  static constexpr uint64_t SORT_INDEX_MASK = (1ull << SORT_INDEX_BITS) - 1;
+  static_assert(MAX_PATHS   <= SORT_INDEX_MASK + 1 &&
+                MAX_SHADOWS <= SORT_INDEX_MASK + 1,
+                "Queue positions must fit in sort keys");
+
+  std::vector<WavefrontPath>   paths;
+  std::vector<RayHit>          hits;
+  std::vector<WavefrontShadow> shadows;
+
+  // Rays of one packet of primary rays
+  std::vector<Ray>             packetRays;
+
+  // Scratch for tracing rays in coherent order
+  std::vector<uint64_t>        sortKeys;
+  std::vector<WavefrontPath>   sortedPaths;
+  std::vector<uint8_t>         isShadowed;
+
+  WavefrontQueues() :
+    paths(), hits(), shadows(), packetRays(),
+    sortKeys(), sortedPaths(), isShadowed()
+  {
+    // Queues never grow past their caps, so they are allocated up front
+    paths      .reserve(MAX_PATHS);
+    hits       .reserve(MAX_PATHS);
+    shadows    .reserve(MAX_SHADOWS);
+    packetRays .reserve(RayPacket::SIZE);
+    sortKeys   .reserve(MAX_SHADOWS);
+    sortedPaths.reserve(MAX_PATHS);
+    isShadowed .reserve(MAX_SHADOWS);
+  }
+};
+
+/**
+ * @brief Scratch state of a thread tracing one tile
+ */
+struct TileState
+{
+  RayLog          log;
+  ShadowCache     shadows;
+  LightSampler    lights;
+  SampleRandom    random;
+  WavefrontQueues& queues;      // Owned by thread, reused between tiles
+
+  TileState(TileFootprint* footprint, const Bounds& region,
+            const LightTree* light_tree, size_t light_samples,
+            WavefrontQueues& thread_queues) :
+    log(footprint, region), shadows(), lights(light_tree, light_samples),
+    random(), queues(thread_queues)
+  {
+  }
+};
 
-struct Pixel
+/**
+ * @brief Data shared by all render threads during one frame
+ */
+struct FrameContext
 {
-  uint8_t red;
-  uint8_t green;
-  uint8_t blue;
-  uint8_t alpha;
+  const Scene&       scene;
+  const Bvh&         bvh;
+  const RenderPlane& renderPlane;
+  Pixel*             pixels;
+  size_t             width;
+  size_t             height;
+  size_t             sampleGrid;
+  size_t             maxReflections;
+  bool               packetTracing;
+
+  size_t             tilesX;
+
+  // Running sums of pixel colors and number of frames summed in each
+  // tile, `nullptr` unless rendering progressively
+  Color*             accumulation;
+  const size_t*      tileFrames;
+
+  // One sample per pixel, `nullptr` unless sampling adaptively
+  Color*             baseColors;
+  double             adaptiveThreshold;
+
+  // Footprint of each tile, `nullptr` unless rendering incrementally
+  TileFootprint*     footprints;
+  const Bounds&      footprintRegion;
+
+  // Hierarchy to sample lights from, `nullptr` when tracing all of them
+  const LightTree*   lightTree;
+  size_t             lightSamples;
+
+  // Reflections weighing less than this are cut off, or left to Russian
+  // roulette when rendering progressively
+  double             reflectionThreshold;
+
+  // Trace samples stage by stage instead of one by one, sorting
+  // secondary rays by origin and direction
+  bool               wavefront;
+  bool               sortRays;
+
+  // Follow diffuse bounces as well as mirror ones
+  bool               pathTracing;
+
+  // Ray queues of each render thread
+  WavefrontQueues*   wavefrontQueues;
 };
 
+static Color rayCast(const Ray& ray, const FrameContext& frame,
+                     TileState& state);
+static Color shadeHit(const Ray& ray, const RayHit& hit,
+                      const FrameContext& frame, TileState& state);
+
+static size_t renderTile(const FrameContext& frame, size_t tile,
+                         size_t worker);
+static size_t renderBaseTile(const FrameContext& frame, size_t tile,
+                             size_t worker);
+static size_t refineTile(const FrameContext& frame, size_t tile,
+                         size_t worker);
+
+static uint64_t getObjectHash(const Scene& scene, size_t index);
+static uint64_t getViewHash(const Scene& scene);
+static std::vector<size_t> getNeighbourTiles(const std::vector<size_t>& tiles,
+                                             size_t tiles_x, size_t tiles_y);
+static void     addUpdatedTiles(const std::vector<size_t>& tiles,
+                                size_t width, size_t height,
+                                std::vector<ImageRect>& rects);
+
+Renderer::Renderer(size_t width, size_t height, size_t thread_count) :
+  m_width(width),
+  m_height(height),
+  m_threadPool(thread_count),
+  m_bvh(),
+  m_pixels(width * height),
+  m_accumulation(),
+  m_sampleGrid(2),
+  m_maxReflections(2),
+  m_reflectionThreshold(1.0 / 256),
+  m_lightSamples(0),
+  m_lightTree(),
+  m_lightTreeOutdated(true),
+  m_packetTracing(true),
+  m_wavefront(false),
+  m_coherenceSorting(false),
+  m_pathTracing(false),
+  m_progressive(false),
+  m_tileFrames(),
+  m_maxAccumulatedFrames(1024),
+  m_adaptive(false),
+  m_adaptiveThreshold(0.05),
+  m_baseColors(),
+  m_tracedSamples(0),
+  m_frameStats(),
+  m_incremental(false),
+  m_footprints(),
+  m_footprintRegion(),
+  m_updatedRects(),
+  m_wavefrontQueues(m_threadPool.threadCount()),
+  m_scene(nullptr),
+  m_objectHashes(),
+  m_objectStates(),
+  m_viewHash(0),
+  m_fullRedraw(true)
+{
+}
+
+Renderer::~Renderer() = default;
 
 void Renderer::renderScene(const Scene& scene)
 {
-  const size_t texture_width  = m_texture.getSize().x;
-  const size_t texture_height = m_texture.getSize().y;
-  Pixel* pixels = new Pixel[texture_width * texture_height];
+  const size_t tiles_x    = (m_width  + TILE_SIZE - 1) / TILE_SIZE;
+  const size_t tiles_y    = (m_height + TILE_SIZE - 1) / TILE_SIZE;
+  const size_t tile_count = tiles_x * tiles_y;
+
+  if (m_tileFrames.size() != tile_count)
+  {
+    m_tileFrames.assign(tile_count, 0);
+    m_fullRedraw = true;
+  }
+
+  // Snapshots of one scene arrive at different addresses, object hashes
+  // below tell what actually changed
+  if (m_scene != &scene)
+  {
+    m_scene = &scene;
+    m_bvh.setScene(scene);
+    m_lightTreeOutdated = true;
+  }
+
+  using Clock = std::chrono::steady_clock;
+
+  const size_t old_count = m_objectHashes.size();
+
+  std::vector<size_t> changed;
+  if (findChanges(scene, changed))
+    m_fullRedraw = true;
+
+  m_frameStats = FrameStats();
+
+  // Rebuild hierarchy only if objects moved since last frame
+  if (!changed.empty() || scene.objectCount() != old_count)
+  {
+    const Clock::time_point start = Clock::now();
+    m_bvh.build(scene);
+    m_frameStats.hierarchyMs =
+        std::chrono::duration<double, std::milli>(Clock::now() - start)
+          .count();
+  }
+
+  // Render threads only read light list, so it is brought up to date here
+  if (scene.lightsOutdated())
+  {
+    const Clock::time_point start = Clock::now();
+    scene.lights();
+    m_lightTreeOutdated = true;
+    m_frameStats.lightsMs =
+        std::chrono::duration<double, std::milli>(Clock::now() - start)
+          .count();
+  }
+  m_frameStats.lightCount = scene.lights().size();
+
+  // Few lights are cheaper to trace all than to sample
+  const bool sample_lights = m_lightSamples > 0
+                          && scene.lights().size() > m_lightSamples;
+  if (sample_lights && m_lightTreeOutdated)
+  {
+    const Clock::time_point start = Clock::now();
+    m_lightTree.build(scene.lights());
+    m_lightTreeOutdated = false;
+    m_frameStats.lightsMs +=
+        std::chrono::duration<double, std::milli>(Clock::now() - start)
+          .count();
+  }
+
+  std::vector<bool> dirty(tile_count, m_fullRedraw);
+  if (!m_fullRedraw && !changed.empty()
+   && (!m_incremental || !markDirtyTiles(scene, changed, dirty)))
+  {
+    m_fullRedraw = true;
+    dirty.assign(tile_count, true);
+  }
+
+  if (m_incremental)
+  {
+    m_objectStates.resize(scene.objectCount(), ObjectState{Bounds(), false});
+
+    // Full redraw refreshes everything, in case tracking was just enabled
+    if (m_fullRedraw)
+    {
+      changed.resize(scene.objectCount());
+      std::iota(changed.begin(), changed.end(), 0);
+    }
+
+    for (size_t index : changed)
+      m_objectStates[index] = ObjectState{scene.bounds(index),
+                                          scene.isLightSource(index)};
+
+    if (m_fullRedraw)
+    {
+      updateFootprintRegion(scene);
+      m_footprints.assign(tile_count, TileFootprint());
+    }
+  }
+
+  m_fullRedraw = false;
+
+  // Pick tiles to trace, restarting accumulation in changed ones
+  std::vector<size_t> tiles;
+  for (size_t tile = 0; tile < tile_count; ++tile)
+  {
+    if (dirty[tile])
+    {
+      m_tileFrames[tile] = 0;
+      if (m_incremental)
+        m_footprints[tile] = TileFootprint();
+    }
+
+    const bool converged = m_maxAccumulatedFrames > 0
+                        && m_tileFrames[tile] >= m_maxAccumulatedFrames;
+
+    if (m_progressive ? !converged : dirty[tile] || !m_incremental)
+      tiles.push_back(tile);
+  }
+
+  m_updatedRects.clear();
+  m_tracedSamples = 0;
+
+  // Image is already as good as it gets
+  if (tiles.empty())
+    return;
+
+  if (m_progressive && m_accumulation.size() != m_width * m_height)
+    m_accumulation.assign(m_width * m_height, Color::Black);
+
+  // Progressive rendering already spreads samples over frames
+  const bool adaptive = m_adaptive && !m_progressive;
+  if (adaptive && m_baseColors.size() != m_width * m_height)
+    m_baseColors.assign(m_width * m_height, Color::Black);
 
   // Create render plane
   RenderPlane render_plane = RenderPlane(scene.camera(),
-                                         2*texture_width,
-                                         2*texture_height,
-                                         1.5/texture_width);
-  // For each row of pixels
-  for (size_t y = 0; y < texture_height; ++y)
-  {
-    // For each column of pixels
-    for (size_t x = 0; x < texture_width; ++x)
+                                         m_sampleGrid*m_width,
+                                         m_sampleGrid*m_height,
+                                         3.0/(m_sampleGrid*m_width));
+
+  const FrameContext frame = {
+    .scene             = scene,
+    .bvh               = m_bvh,
+    .renderPlane       = render_plane,
+    .pixels            = m_pixels.data(),
+    .width             = m_width,
+    .height            = m_height,
+    .sampleGrid        = m_sampleGrid,
+    .maxReflections    = m_maxReflections,
+    .packetTracing     = m_packetTracing,
+    .tilesX            = tiles_x,
+    .accumulation      = m_progressive ? m_accumulation.data() : nullptr,
+    .tileFrames        = m_progressive ? m_tileFrames.data()   : nullptr,
+    .baseColors        = adaptive      ? m_baseColors.data()   : nullptr,
+    .adaptiveThreshold = m_adaptiveThreshold,
+    .footprints        = m_incremental ? m_footprints.data()   : nullptr,
+    .footprintRegion   = m_footprintRegion,
+    .lightTree           = sample_lights ? &m_lightTree : nullptr,
+    .lightSamples        = m_lightSamples,
+    .reflectionThreshold = m_reflectionThreshold,
+    .wavefront           = m_wavefront,
+    .sortRays            = m_wavefront && m_coherenceSorting,
+    .pathTracing         = m_pathTracing,
+    .wavefrontQueues     = m_wavefrontQueues.data()
+  };
+
+  std::atomic<size_t> traced_samples(0);
+
+  // Render tiles in parallel, each thread writes only its own pixels
+  if (adaptive)
+  {
+    // Refining needs base samples of neighbouring tiles, so it waits
+    // until all of them are done
+    m_threadPool.run(tiles.size(), [&](size_t task, size_t worker)
     {
-      // Cast ray from render plane
-      Color pixel_color = Color::Black;
-      Ray ray = render_plane.getRayFrom(2*x, 2*y);
-      pixel_color += rayCast(ray, scene, 2);
-      ray = render_plane.getRayFrom(2*x, 2*y + 1);
-      pixel_color += rayCast(ray, scene, 2);
-      ray = render_plane.getRayFrom(2*x + 1, 2*y);
-      pixel_color += rayCast(ray, scene, 2);
-      ray = render_plane.getRayFrom(2*x + 1, 2*y + 1);
-      pixel_color += rayCast(ray, scene, 2);
-
-      pixel_color *= 1.0/4;
-
-      // Color pixel with ray color
-      pixels[y * texture_width + x] = {
-        .red   = pixel_color.red(),
-        .green = pixel_color.green(),
-        .blue  = pixel_color.blue(),
-        .alpha = uint8_t(255)
-      };
-    }
+      traced_samples += renderBaseTile(frame, tiles[task], worker);
+    });
+
+    // Edge pixels of neighbouring tiles compare against new base samples
+    if (tiles.size() < tile_count)
+      tiles = getNeighbourTiles(tiles, tiles_x, tiles_y);
+
+    m_threadPool.run(tiles.size(), [&](size_t task, size_t worker)
+    {
+      traced_samples += refineTile(frame, tiles[task], worker);
+    });
   }
+  else
+  {
+    m_threadPool.run(tiles.size(), [&](size_t task, size_t worker)
+    {
+      traced_samples += renderTile(frame, tiles[task], worker);
+    });
+  }
+
+  m_tracedSamples = traced_samples;
 
-  // Update texture
-  m_texture.update((const sf::Uint8*)pixels);
+  if (m_progressive)
+    for (size_t tile : tiles)
+      ++m_tileFrames[tile];
 
-  delete[] pixels;
+  addUpdatedTiles(tiles, m_width, m_height, m_updatedRects);
 }
 
-static Color getLighting(const RayHit& hit, const Scene& scene);
-static Color getReflex(const RayHit& hit, const Scene& scene);
+size_t Renderer::accumulatedFrames() const
+{
+  if (m_fullRedraw || m_tileFrames.empty())
+    return 0;
+
+  return *std::min_element(m_tileFrames.begin(), m_tileFrames.end());
+}
 
-static Color rayCast(const Ray& ray, const Scene& scene,
-                     size_t max_reflexions)
+void Renderer::copyRect(const ImageRect& rect, Pixel* destination) const
 {
-  Ray cast = ray;
+  for (size_t y = 0; y < rect.height; ++y)
+    memcpy(destination + y * rect.width,
+           m_pixels.data() + (rect.y + y) * m_width + rect.x,
+           rect.width * sizeof(Pixel));
+}
 
-  // Try to get closest ray hit
-  RayHit hit = cast.getClosestRayHit(scene);
+bool Renderer::findChanges(const Scene& scene, std::vector<size_t>& changed)
+{
+  const uint64_t view_hash    = getViewHash(scene);
+  const bool     view_changed = view_hash != m_viewHash;
+  m_viewHash = view_hash;
+
+  // Removed objects are not tracked anywhere
+  const size_t old_count = m_objectHashes.size();
+  const bool   removed   = scene.objectCount() < old_count;
+  m_objectHashes.resize(scene.objectCount());
 
-  // If no object hit
-  if (!hit.hasHit())
+  for (size_t i = 0; i < scene.objectCount(); ++i)
   {
-    // If directed light present
-    if (scene.hasDirectedLight())
+    const uint64_t hash = getObjectHash(scene, i);
+    if (i >= old_count || hash != m_objectHashes[i])
     {
-      const double cosine =
-        Vec::dotProduct(ray.direction(), -scene.directedLight().direction);
-      if (cosine < 0)
-      {
-        // Render background pixel
-        return Color::Black;
-      }
+      m_objectHashes[i] = hash;
+      changed.push_back(i);
+    }
+  }
+
+  return view_changed || removed;
+}
+
+bool Renderer::markDirtyTiles(const Scene& scene,
+                              const std::vector<size_t>& changed,
+                              std::vector<bool>& dirty) const
+{
+  for (size_t index : changed)
+  {
+    const bool   is_new     = index >= m_objectStates.size();
+    const Bounds old_bounds = is_new ? Bounds() : m_objectStates[index].bounds;
+    const Bounds new_bounds = scene.bounds(index);
+    const bool   was_light  = !is_new && m_objectStates[index].isLightSource;
+
+    // Planes are seen from everywhere
+    if (!old_bounds.isEmpty() && !old_bounds.isFinite())
+      return false;
+
+    // Rays were not recorded outside of region
+    if (!m_footprintRegion.contains(new_bounds))
+      return false;
+
+    // New light source lights tiles which never looked at it
+    if (scene.isLightSource(index) && !was_light)
+      return false;
+
+    // Changing a light changes odds of picking every other one, and
+    // with them shading of tiles which never picked it
+    if (m_lightSamples > 0 && (scene.isLightSource(index) || was_light))
+      return false;
 
-      // Render directed light
-      return scene.directedLight().color * cosine;
+    for (size_t tile = 0; tile < dirty.size(); ++tile)
+    {
+      if (dirty[tile])
+        continue;
+
+      const TileFootprint& footprint = m_footprints[tile];
+      dirty[tile] = std::binary_search(footprint.objects.begin(),
+                                       footprint.objects.end(),
+                                       uint32_t(index))
+                 || footprint.rays.overlaps(new_bounds);
     }
+  }
 
-    // Render background pixel
-    return Color::Black;
+  return true;
+}
+
+void Renderer::updateFootprintRegion(const Scene& scene)
+{
+  Bounds finite;
+  for (size_t i = 0; i < scene.objectCount(); ++i)
+    if (m_objectStates[i].bounds.isFinite())
+      finite |= m_objectStates[i].bounds;
+
+  if (finite.isEmpty())
+  {
+    m_footprintRegion = Bounds();
+    return;
   }
 
-  if (hit.object()->isLightSource())
+  // Leave room for objects to move without redrawing everything
+  const Vec margin = finite.extent() * 0.5 + Vec(1, 1, 1);
+  m_footprintRegion = Bounds(finite.min() - margin, finite.max() + margin);
+}
+
+static std::vector<size_t> getNeighbourTiles(const std::vector<size_t>& tiles,
+                                             size_t tiles_x, size_t tiles_y)
+{
+  // Tiles sharing a side or a corner with any of `tiles`, and those tiles
+  std::vector<bool> selected(tiles_x * tiles_y, false);
+  for (size_t tile : tiles)
   {
-    const double cosine = fabs(Vec::dotProduct(hit.normal(), ray.direction()));
-    return hit.object()->material().glowColor() * (1 + cosine);
+    const size_t x = tile % tiles_x;
+    const size_t y = tile / tiles_x;
+    for (size_t ny = (y > 0 ? y - 1 : y); ny < std::min(y + 2, tiles_y); ++ny)
+      for (size_t nx = (x > 0 ? x - 1 : x); nx < std::min(x + 2, tiles_x); ++nx)
+        selected[ny * tiles_x + nx] = true;
   }
 
-  // Apply surrounding light
-  cast.color() += getLighting(hit, scene);
+  std::vector<size_t> neighbours;
+  for (size_t tile = 0; tile < selected.size(); ++tile)
+    if (selected[tile])
+      neighbours.push_back(tile);
 
-  // Apply reflex
-  // cast.color() += getReflex(hit, scene);
+  return neighbours;
+}
 
-  // Apply material to ray
-  const double dot_product = Vec::dotProduct(ray.direction(), hit.normal());
-  const double cosine = fabs(dot_product);
-  const Material& material = hit.object()->material();
+static void addUpdatedTiles(const std::vector<size_t>& tiles,
+                            size_t width, size_t height,
+                            std::vector<ImageRect>& rects)
+{
+  const size_t tile_size = Renderer::TILE_SIZE;
+  const size_t tiles_x   = (width + tile_size - 1) / tile_size;
 
-  // Apply emitted light
-  cast.color() += material.glowColor();
+  // Tiles are sorted, merge runs of neighbours in a row
+  for (size_t i = 0; i < tiles.size(); )
+  {
+    const size_t row = tiles[i] / tiles_x;
+    size_t end = i + 1;
+    while (end < tiles.size() && tiles[end] == tiles[end - 1] + 1
+        && tiles[end] / tiles_x == row)
+      ++end;
+
+    const size_t x_begin = (tiles[i] % tiles_x) * tile_size;
+    const size_t x_end   = std::min((tiles[end - 1] % tiles_x + 1) * tile_size,
+                                    width);
+    const size_t y_begin = row * tile_size;
+    const size_t y_end   = std::min(y_begin + tile_size, height);
+
+    // Extend previous rectangle if this run continues it downwards
+    ImageRect* last = rects.empty() ? nullptr : &rects.back();
+    if (last && last->x == x_begin && last->width == x_end - x_begin
+     && last->y + last->height == y_begin)
+      last->height += y_end - y_begin;
+    else
+      rects.push_back(ImageRect{x_begin, y_begin,
+                                x_end - x_begin, y_end - y_begin});
+
+    i = end;
+  }
+}
 
-  // Get diffused light
-  cast.color() *= cosine * material.diffusion() * material.color();
+static void hashValue(uint64_t& hash, uint64_t value)
+{
+  // FNV-1a over 64-bit words
+  hash = (hash ^ value) * 0x100000001B3ull;
+}
+
+static void hashValue(uint64_t& hash, double value)
+{
+  uint64_t bits = 0;
+  memcpy(&bits, &value, sizeof(bits));
+  hashValue(hash, bits);
+}
+
+static void hashValue(uint64_t& hash, const Vec& vec)
+{
+  hashValue(hash, vec.m_x);
+  hashValue(hash, vec.m_y);
+  hashValue(hash, vec.m_z);
+}
+
+static void hashValue(uint64_t& hash, const Color& color)
+{
+  hashValue(hash, color.redNormalized());
+  hashValue(hash, color.greenNormalized());
+  hashValue(hash, color.blueNormalized());
+}
+
+static void hashValue(uint64_t& hash, const Transform& transform)
+{
+  hashValue(hash, transform.position());
+  hashValue(hash, transform.scale());
+  for (size_t row = 0; row < 3; ++row)
+    for (size_t col = 0; col < 3; ++col)
+      hashValue(hash, transform.rotation()[row][col]);
+}
+
+static uint64_t getObjectHash(const Scene& scene, size_t index)
+{
+  const Material& material = scene.objectMaterial(index);
+
+  uint64_t hash = 0xCBF29CE484222325ull;
+  hashValue(hash, uint64_t(scene.objectType(index)));
+  hashValue(hash, scene.transform(index));
+
+  // Mesh geometry never changes, so its identity is enough
+  if (scene.objectType(index) == ObjectType::Mesh)
+    hashValue(hash, uint64_t(uintptr_t(&scene.objectMesh(index))));
+
+  hashValue(hash, uint64_t(material.type()));
+  hashValue(hash, material.diffusion());
+  hashValue(hash, material.color());
+  hashValue(hash, material.glowColor());
+  hashValue(hash, uint64_t(material.maxReflections()));
+
+  return hash;
+}
+
+static uint64_t getViewHash(const Scene& scene)
+{
+  uint64_t hash = 0xCBF29CE484222325ull;
+  hashValue(hash, scene.camera().transform());
+  hashValue(hash, scene.camera().fovDeg());
+  hashValue(hash, scene.ambientLight());
+  hashValue(hash, scene.directedLight().direction);
+  hashValue(hash, scene.directedLight().color);
+
+  // Zero means nothing was rendered yet
+  return hash != 0 ? hash : 1;
+}
+
+/**
+ * @brief Sample `sample` of pixel (`x`, `y`)
+ */
+struct SampleId
+{
+  size_t x;
+  size_t y;
+  size_t sample;
+};
+
+/**
+ * @brief Pixel bounds of a tile
+ */
+struct TileBounds
+{
+  size_t xBegin;
+  size_t yBegin;
+  size_t xEnd;
+  size_t yEnd;
+};
 
-  // If rendering reflections
-  if (max_reflexions > 0)
+static TileBounds getTileBounds(const FrameContext& frame, size_t tile);
+static size_t     getTileIndex(const FrameContext& frame, size_t x, size_t y);
+static TileFootprint* getFootprint(const FrameContext& frame, size_t tile);
+static void       traceSamples(const FrameContext& frame,
+                               const std::vector<SampleId>& samples,
+                               std::vector<Color>& colors, TileState& state);
+static void       storePixel(const FrameContext& frame, size_t x, size_t y,
+                             Color color);
+
+static size_t renderTile(const FrameContext& frame, size_t tile,
+                         size_t worker)
+{
+  const TileBounds bounds       = getTileBounds(frame, tile);
+  const size_t     sample_count = frame.sampleGrid * frame.sampleGrid;
+
+  TileState state(getFootprint(frame, tile), frame.footprintRegion,
+                  frame.lightTree, frame.lightSamples,
+                  frame.wavefrontQueues[worker]);
+
+  std::vector<SampleId> samples;
+  std::vector<Color>    colors;
+  samples.reserve((bounds.xEnd - bounds.xBegin)
+                * (bounds.yEnd - bounds.yBegin) * sample_count);
+
+  // Whole tile is traced at once, so that wavefront stages run over long
+  // queues. Samples of a pixel are consecutive, so that packets span
+  // neighbouring samples of adjacent pixels.
+  for (size_t y = bounds.yBegin; y < bounds.yEnd; ++y)
+    for (size_t x = bounds.xBegin; x < bounds.xEnd; ++x)
+      for (size_t sample = 0; sample < sample_count; ++sample)
+        samples.push_back(SampleId{x, y, sample});
+
+  traceSamples(frame, samples, colors, state);
+
+  // For each pixel
+  const Color* pixel_samples = colors.data();
+  for (size_t y = bounds.yBegin; y < bounds.yEnd; ++y)
   {
-    // Add reflection
-    Vec ortho = ray.direction() - dot_product*hit.normal();
-    Vec reflected = -ray.direction() + 2*ortho;
-    Ray reflected_cast(hit.point(), reflected);
-    Color reflection = rayCast(reflected_cast, scene, max_reflexions - 1);
-    cast.color() += material.reflectivity() * reflection;
+    for (size_t x = bounds.xBegin; x < bounds.xEnd; ++x)
+    {
+      Color pixel_color = Color::Black;
+      for (size_t sample = 0; sample < sample_count; ++sample)
+        pixel_color += *pixel_samples++;
+
+      pixel_color *= 1.0/sample_count;
+      storePixel(frame, x, y, pixel_color);
+    }
   }
 
-  // If ambient light present
-  if (scene.hasAmbientLight())
+  return samples.size();
+}
+
+static size_t getAdaptiveSample(size_t grid, size_t index)
+{
+  // Start from the cell nearest to pixel center, then step through cells
+  // by roughly golden ratio of their count, so that any prefix of the
+  // sequence covers the pixel evenly
+  const size_t sample_count = grid * grid;
+  const size_t center       = (grid / 2) * grid + grid / 2;
+
+  size_t stride = std::max<size_t>(1, size_t(0.618 * double(sample_count)));
+  while (std::gcd(stride, sample_count) != 1)
+    --stride;
+
+  return (center + index * stride) % sample_count;
+}
+
+static size_t renderBaseTile(const FrameContext& frame, size_t tile,
+                             size_t worker)
+{
+  const TileBounds bounds = getTileBounds(frame, tile);
+  const size_t     sample = getAdaptiveSample(frame.sampleGrid, 0);
+
+  TileState state(getFootprint(frame, tile), frame.footprintRegion,
+                  frame.lightTree, frame.lightSamples,
+                  frame.wavefrontQueues[worker]);
+
+  std::vector<SampleId> samples;
+  std::vector<Color>    colors;
+  for (size_t y = bounds.yBegin; y < bounds.yEnd; ++y)
+    for (size_t x = bounds.xBegin; x < bounds.xEnd; ++x)
+      samples.push_back(SampleId{x, y, sample});
+
+  traceSamples(frame, samples, colors, state);
+
+  for (size_t i = 0; i < samples.size(); ++i)
+    frame.baseColors[samples[i].y * frame.width + samples[i].x] = colors[i];
+
+  return samples.size();
+}
+
+static double getContrast(const Color& lhs, const Color& rhs)
+{
+  // Compare displayed values, differences above white are invisible
+  const double red   = fabs(std::min<double>(lhs.redNormalized(),   1.0)
+                          - std::min<double>(rhs.redNormalized(),   1.0));
+  const double green = fabs(std::min<double>(lhs.greenNormalized(), 1.0)
+                          - std::min<double>(rhs.greenNormalized(), 1.0));
+  const double blue  = fabs(std::min<double>(lhs.blueNormalized(),  1.0)
+                          - std::min<double>(rhs.blueNormalized(),  1.0));
+
+  return std::max(red, std::max(green, blue));
+}
+
+static double getLuminance(const Color& color)
+{
+  return 0.2126 * std::min<double>(color.redNormalized(),   1.0)
+       + 0.7152 * std::min<double>(color.greenNormalized(), 1.0)
+       + 0.0722 * std::min<double>(color.blueNormalized(),  1.0);
+}
+
+static bool needsRefinement(const FrameContext& frame, size_t x, size_t y)
+{
+  const Color& color = frame.baseColors[y * frame.width + x];
+
+  // Compare with all eight neighbours, thin features may show up only
+  // in diagonal ones
+  const size_t x_begin = x > 0 ? x - 1 : x;
+  const size_t y_begin = y > 0 ? y - 1 : y;
+  const size_t x_end   = std::min(x + 2, frame.width);
+  const size_t y_end   = std::min(y + 2, frame.height);
+
+  for (size_t neighbour_y = y_begin; neighbour_y < y_end; ++neighbour_y)
   {
-    // Apply ambient light to ray
-    cast.color() += scene.ambientLight()*material.color();
+    for (size_t neighbour_x = x_begin; neighbour_x < x_end; ++neighbour_x)
+    {
+      const Color& neighbour =
+          frame.baseColors[neighbour_y * frame.width + neighbour_x];
+      if (getContrast(color, neighbour) > frame.adaptiveThreshold)
+        return true;
+    }
   }
 
-  return cast.color();
+  return false;
 }
 
-static Color getLighting(const RayHit& hit, const Scene& scene)
+static size_t refineTile(const FrameContext& frame, size_t tile,
+                         size_t worker)
 {
-  Color light = Color::Black;
+  const TileBounds bounds       = getTileBounds(frame, tile);
+  const size_t     sample_count = frame.sampleGrid * frame.sampleGrid;
 
-  // For each object in scene
-  for (size_t i = 0; i < scene.objectCount(); ++i)
+  // Refining stops once the mean is known this precisely
+  const double max_error = 0.25 * frame.adaptiveThreshold;
+
+  TileState state(getFootprint(frame, tile), frame.footprintRegion,
+                  frame.lightTree, frame.lightSamples,
+                  frame.wavefrontQueues[worker]);
+
+  std::vector<SampleId> samples;
+  std::vector<Color>    colors;
+  size_t traced = 0;
+
+  for (size_t y = bounds.yBegin; y < bounds.yEnd; ++y)
   {
-    const SceneObject& object = scene[i];
-    // If object is not light source
-    //    or object is the same as hit->object()
-    if (!object.isLightSource() || &object == hit.object())
+    for (size_t x = bounds.xBegin; x < bounds.xEnd; ++x)
     {
-      // Skip object
-      continue;
+      const Color& base_color = frame.baseColors[y * frame.width + x];
+      if (sample_count == 1 || !needsRefinement(frame, x, y))
+      {
+        storePixel(frame, x, y, base_color);
+        continue;
+      }
+
+      // Running mean and variance of luminance (Welford)
+      Color  pixel_color = base_color;
+      size_t count       = 1;
+      double mean        = getLuminance(base_color);
+      double deviation   = 0;
+
+      while (count < sample_count)
+      {
+        // Start with a few samples, then go by full packets
+        const size_t round = std::min(count < 4 ? 4 - count : RayPacket::SIZE,
+                                      sample_count - count);
+        samples.clear();
+        for (size_t i = count; i < count + round; ++i)
+          samples.push_back(SampleId{x, y,
+                                     getAdaptiveSample(frame.sampleGrid, i)});
+
+        traceSamples(frame, samples, colors, state);
+        traced += round;
+
+        for (size_t i = 0; i < round; ++i)
+        {
+          pixel_color += colors[i];
+
+          const double luminance = getLuminance(colors[i]);
+          const double delta     = luminance - mean;
+          mean      += delta / double(++count);
+          deviation += delta * (luminance - mean);
+        }
+
+        const double variance = deviation / double(count - 1);
+        if (variance / double(count) <= max_error * max_error)
+          break;
+      }
+
+      pixel_color *= 1.0/count;
+      storePixel(frame, x, y, pixel_color);
     }
+  }
+
+  return traced;
+}
+
+static TileBounds getTileBounds(const FrameContext& frame, size_t tile)
+{
+  const size_t tiles_x = (frame.width + Renderer::TILE_SIZE - 1)
+                       / Renderer::TILE_SIZE;
+
+  const size_t x_begin = (tile % tiles_x) * Renderer::TILE_SIZE;
+  const size_t y_begin = (tile / tiles_x) * Renderer::TILE_SIZE;
+
+  return TileBounds{
+    .xBegin = x_begin,
+    .yBegin = y_begin,
+    .xEnd   = std::min(x_begin + Renderer::TILE_SIZE, frame.width),
+    .yEnd   = std::min(y_begin + Renderer::TILE_SIZE, frame.height)
+  };
+}
+
+static size_t getTileIndex(const FrameContext& frame, size_t x, size_t y)
+{
+  return (y / Renderer::TILE_SIZE) * frame.tilesX + x / Renderer::TILE_SIZE;
+}
+
+static TileFootprint* getFootprint(const FrameContext& frame, size_t tile)
+{
+  return frame.footprints ? frame.footprints + tile : nullptr;
+}
 
-    // Cast ray towards light source
-    Vec direction = (object.transform().position() - hit.point()).normalized();
-    Ray cast(hit.point(), direction);
-    RayHit cast_hit = cast.getClosestRayHit(scene);
+static uint64_t getSampleHash(size_t pixel, size_t frame_index,
+                              size_t sample, size_t dimension)
+{
+  // Hash of sample coordinates, same for any thread and tile order
+  uint64_t value = pixel * 0x9E3779B97F4A7C15ull
+                 ^ frame_index * 0xC2B2AE3D27D4EB4Full
+                 ^ (sample * 2 + dimension) * 0x165667B19E3779F9ull;
+  value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+  value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+  value =  value ^ (value >> 31);
+
+  return value;
+}
+
+static double getJitter(size_t pixel, size_t frame_index,
+                        size_t sample, size_t dimension)
+{
+  return double(getSampleHash(pixel, frame_index, sample, dimension) >> 11)
+       * 0x1.0p-53;
+}
+
+/**
+ * @brief Start random sequence of sample `id`, different in each
+ * progressive frame
+ */
+static void seedSample(const FrameContext& frame, const SampleId& id,
+                       SampleRandom& random)
+{
+  const size_t pixel       = id.y * frame.width + id.x;
+  const size_t frame_index = frame.tileFrames
+                           ? frame.tileFrames[getTileIndex(frame, id.x, id.y)]
+                           : 0;
+
+  // Hash of the first jitter dimension, moved to a separate sequence
+  constexpr uint64_t shading_stream = 0xD1B54A32D192ED03ull;
+  random.seed(getSampleHash(pixel, frame_index, id.sample, 0)
+            ^ shading_stream);
+}
+
+/**
+ * @brief Point of render plane sample `id` goes through
+ */
+static void getSamplePoint(const FrameContext& frame, const SampleId& id,
+                           double& x, double& y)
+{
+  const size_t grid = frame.sampleGrid;
+  x = double(grid*id.x + id.sample / grid);
+  y = double(grid*id.y + id.sample % grid);
+
+  // Fixed grid samples cell corners
+  if (!frame.accumulation)
+    return;
+
+  // Progressive frames pick random point in each cell
+  const size_t pixel       = id.y * frame.width + id.x;
+  const size_t frame_index = frame.tileFrames[getTileIndex(frame, id.x, id.y)];
+  x += getJitter(pixel, frame_index, id.sample, 0);
+  y += getJitter(pixel, frame_index, id.sample, 1);
+}
 
-    // If hit light source
-    if (cast_hit.object() == &object)
+/**
+ * @brief Packet of camera rays of `count` samples starting at `first`,
+ * also stored in `rays`
+ */
+static void getSamplePacket(const FrameContext& frame,
+                            const std::vector<SampleId>& samples,
+                            size_t first, size_t count,
+                            RayPacket& packet, std::vector<Ray>& rays)
+{
+  // Pad incomplete packet with copies of its last sample
+  real sample_x[RayPacket::SIZE];
+  real sample_y[RayPacket::SIZE];
+  for (size_t lane = 0; lane < RayPacket::SIZE; ++lane)
+  {
+    double x = 0;
+    double y = 0;
+    getSamplePoint(frame, samples[first + std::min(lane, count - 1)], x, y);
+    sample_x[lane] = real(x);
+    sample_y[lane] = real(y);
+  }
+
+  frame.renderPlane.getPacketFrom(sample_x, sample_y, (1u << count) - 1,
+                                  packet, rays);
+}
+
+static void traceWavefront(const FrameContext& frame,
+                           const std::vector<SampleId>& samples,
+                           std::vector<Color>& colors, TileState& state);
+
+static void traceSamples(const FrameContext& frame,
+                         const std::vector<SampleId>& samples,
+                         std::vector<Color>& colors, TileState& state)
+{
+  if (frame.wavefront)
+  {
+    traceWavefront(frame, samples, colors, state);
+    return;
+  }
+
+  colors.clear();
+
+  if (!frame.packetTracing)
+  {
+    // Cast rays from render plane
+    for (const SampleId& id : samples)
     {
-      // Add lighting
-      double cosine = fabs(Vec::dotProduct(direction, hit.normal()));
-      light += cosine*object.material().glowColor();
+      double x = 0;
+      double y = 0;
+      getSamplePoint(frame, id, x, y);
+
+      seedSample(frame, id, state.random);
+      colors.push_back(rayCast(frame.renderPlane.getRayFrom(x, y),
+                               frame, state));
     }
+    return;
   }
 
-  // If directed light source present
-  if (scene.hasDirectedLight())
+  std::vector<Ray> rays;
+  rays.reserve(RayPacket::SIZE);
+
+  for (size_t first = 0; first < samples.size(); first += RayPacket::SIZE)
   {
-    const Vec direction = -scene.directedLight().direction;
-    Ray cast(hit.point(), direction);
-    RayHit cast_hit = cast.getClosestRayHit(scene);
-   
-    // If not occluded
-    if (!cast_hit.hasHit())
+    const size_t count = std::min(RayPacket::SIZE, samples.size() - first);
+
+    RayPacket packet;
+    getSamplePacket(frame, samples, first, count, packet, rays);
+
+    PacketHit packet_hit;
+    frame.bvh.getClosestHits(packet, packet_hit);
+
+    // Shade each sample separately, secondary rays are traced one by one
+    for (size_t lane = 0; lane < count; ++lane)
     {
-      // Add lighting
-      double cosine = fabs(Vec::dotProduct(direction, hit.normal()));
-      light += cosine*scene.directedLight().color;
+      const Ray& ray = rays[lane];
+      seedSample(frame, samples[first + lane], state.random);
+      colors.push_back(shadeHit(ray,
+                                ray.getRayHit(frame.scene,
+                                              packet_hit.objectAt(lane)),
+                                frame, state));
     }
   }
+}
 
-  // Return lighting
-  return light;
+static void storePixel(const FrameContext& frame, size_t x, size_t y,
+                       Color color)
+{
+  const size_t index = y * frame.width + x;
+
+  // Show average of all frames accumulated so far, first frame of a tile
+  // overwrites whatever was there before
+  if (frame.accumulation)
+  {
+    const size_t frame_index = frame.tileFrames[getTileIndex(frame, x, y)];
+    if (frame_index == 0)
+      frame.accumulation[index]  = color;
+    else
+      frame.accumulation[index] += color;
+
+    color = frame.accumulation[index] / double(frame_index + 1);
+  }
+
+  // Color pixel with ray color
+  frame.pixels[index] = {
+    .red   = color.red(),
+    .green = color.green(),
+    .blue  = color.blue(),
+    .alpha = uint8_t(255)
+  };
 }
 
-static Color getReflex(const RayHit& hit, const Scene& scene)
+static Color getLighting(const RayHit& hit, const Scene& scene,
+                         const Bvh& bvh, TileState& state);
+
+/**
+ * @brief Replace `ray` with its reflection off `hit`, unless reflection
+ * is past depth limit or too faint to trace
+ *
+ * @param[in]     reflections  Reflections `ray` already went through
+ * @param[in,out] throughput   Weight of `ray` in sample color, replaced by
+ *                             weight of reflection
+ *
+ * @return Whether reflection should be traced
+ */
+static bool reflectRay(const FrameContext& frame, const RayHit& hit,
+                       const Material& material, size_t reflections,
+                       SampleRandom& random, Ray& ray, double& throughput);
+
+/**
+ * @brief Replace `ray` with a path tracing bounce off `hit`: diffuse with
+ * probability of `Material::diffusion()`, specular otherwise. Path weight
+ * is `throughput` times `filter`, bounces past depth limit or too faint
+ * to trace end the path as in `reflectRay`.
+ *
+ * @param[in]     bounces     Bounces `ray` already went through
+ * @param[in,out] throughput  Scale of path weight
+ * @param[in,out] filter      Color of surfaces path scattered off
+ * @param[out]    is_diffuse  Whether bounce is diffuse
+ *
+ * @return Whether bounce should be traced
+ */
+static bool scatterRay(const FrameContext& frame, const RayHit& hit,
+                       const Material& material, size_t bounces,
+                       SampleRandom& random, Ray& ray, double& throughput,
+                       Color& filter, bool& is_diffuse);
+
+static Color rayCast(const Ray& ray, const FrameContext& frame,
+                     TileState& state)
 {
-  // TODO: FIX
-  Color reflex = Color::Black;
+  // Try to get closest ray hit
+  return shadeHit(ray, ray.getClosestRayHit(frame.bvh), frame, state);
+}
 
-  // For each object in scene
-  for (size_t i = 0; i < scene.objectCount(); ++i)
+/**
+ * @brief Light coming from the sky along `direction`
+ */
+static Color getSkyColor(const Vec& direction, const Scene& scene)
+{
+  // If directed light present
+  if (scene.hasDirectedLight())
   {
-    const SceneObject& object = scene[i];
-    // If object is the same as hit->object()
-    if (&object == hit.object())
+    const double cosine =
+      Vec::dotProduct(direction, -scene.directedLight().direction);
+    if (cosine < 0)
     {
-      // Skip object
-      continue;
+      // Render background pixel
+      return Color::Black;
     }
 
-    // Cast ray towards object
-    Vec direction = (object.transform().position() - hit.point()).normalized();
-    Ray cast(hit.point(), direction);
-    RayHit cast_hit = cast.getClosestRayHit(scene);
+    // Render directed light
+    return scene.directedLight().color * cosine;
+  }
 
-    // If hit target
-    if (cast_hit.object() == &object)
-    {
-      // Get object lighting
-      Color light = getLighting(cast_hit, scene);
+  // Render background pixel
+  return Color::Black;
+}
 
-      // Add diffused light to reflex
-      const double cosine = fabs(Vec::dotProduct(direction, hit.normal()));
-      const double scale = 1.0 / (1.0 + 0.05*hit.distance()*hit.distance());
-      reflex += scale* cosine * object.material().diffusion()
-                  * light * object.material().color();
+/**
+ * @brief Light coming along `ray` which hit nothing. Path tracing takes
+ * ambient light from the sky in every direction. Directed light is left
+ * out after diffuse bounces, as shadow rays already bring it.
+ */
+static Color getMissColor(const FrameContext& frame, const Ray& ray,
+                          bool is_diffuse)
+{
+  const Scene& scene = frame.scene;
+  if (!frame.pathTracing)
+    return getSkyColor(ray.direction(), scene);
+
+  Color color = is_diffuse ? Color::Black
+                           : getSkyColor(ray.direction(), scene);
+  if (scene.hasAmbientLight())
+    color += scene.ambientLight();
+
+  return color;
+}
+
+/**
+ * @brief Light emitted by light source of `material` towards `ray`
+ * hitting it. Path tracing leaves it out after diffuse bounces, as shadow
+ * rays already bring it.
+ */
+static Color getGlowColor(const FrameContext& frame, const Ray& ray,
+                          const RayHit& hit, const Material& material,
+                          bool is_diffuse)
+{
+  if (frame.pathTracing)
+    return is_diffuse ? Color::Black : material.glowColor();
+
+  const double cosine = fabs(Vec::dotProduct(hit.normal(), ray.direction()));
+  return material.glowColor() * (1 + cosine);
+}
+
+/**
+ * @brief Light which ray hitting surface of `material` at angle with
+ * `cosine` takes from it, not counting reflections
+ *
+ * @param[in] light  Light from scene light sources reaching the surface
+ */
+static Color getSurfaceColor(const FrameContext& frame, const Color& light,
+                             double cosine, const Material& material)
+{
+  // Path tracing surface reflects diffused share of light reaching it,
+  // light bounced off other surfaces comes with the next ray
+  if (frame.pathTracing)
+    return light * material.diffusion() * material.color();
+
+  // Apply surrounding light
+  Color color = light;
+
+  // Apply emitted light
+  color += material.glowColor();
 
-      // TODO: Add reflected light to reflex
+  // Get diffused light
+  color *= cosine * material.diffusion() * material.color();
+
+  // If ambient light present
+  if (frame.scene.hasAmbientLight())
+  {
+    // Apply ambient light to ray
+    color += frame.scene.ambientLight()*material.color();
+  }
+
+  return color;
+}
+
+static Color shadeHit(const Ray& ray, const RayHit& hit,
+                      const FrameContext& frame, TileState& state)
+{
+  const Scene& scene = frame.scene;
+  const Bvh&   bvh   = frame.bvh;
+
+  // Reflections are followed in a loop, each one adding its light scaled
+  // by the product of reflectivities along the path, and by color of
+  // surfaces it bounced off when path tracing
+  Ray    cast        = ray;
+  RayHit cast_hit    = hit;
+  Color  color       = Color::Black;
+  double throughput  = 1;
+  Color  filter      = Color::White;
+  size_t reflections = 0;
+  bool   is_diffuse  = false;
+
+  while (true)
+  {
+    // Remember what this ray saw
+    state.log.addSegment(cast, cast_hit.distance());
+    state.log.addObject(cast_hit.object());
+
+    // If no object hit
+    if (!cast_hit.hasHit())
+    {
+      color += throughput * (filter * getMissColor(frame, cast, is_diffuse));
+      break;
     }
+
+    const Material& material = scene.objectMaterial(cast_hit.object());
+    if (scene.isLightSource(cast_hit.object()))
+    {
+      color += throughput * (filter * getGlowColor(frame, cast, cast_hit,
+                                                   material, is_diffuse));
+      break;
+    }
+
+    const double cosine = fabs(Vec::dotProduct(cast.direction(),
+                                               cast_hit.normal()));
+    color += throughput
+           * (filter * getSurfaceColor(frame,
+                                       getLighting(cast_hit, scene, bvh,
+                                                   state),
+                                       cosine, material));
+
+    const bool is_traced = frame.pathTracing
+                         ? scatterRay(frame, cast_hit, material, reflections,
+                                      state.random, cast, throughput, filter,
+                                      is_diffuse)
+                         : reflectRay(frame, cast_hit, material, reflections,
+                                      state.random, cast, throughput);
+    if (!is_traced)
+      break;
+
+    cast_hit = cast.getClosestRayHit(bvh);
+    ++reflections;
   }
 
-  return reflex;
+  return color;
 }
 
-RayHit Ray::getRayHit(const SceneObject& object)
+static bool reflectRay(const FrameContext& frame, const RayHit& hit,
+                       const Material& material, size_t reflections,
+                       SampleRandom& random, Ray& ray, double& throughput)
 {
-  // If object is Hidden
-  if (object.type() == ObjectType::Empty ||
-      object.material().isHidden())
+  // Material may allow more or fewer reflections than renderer does
+  if (reflections >= material.getMaxReflections(frame.maxReflections))
+    return false;
+
+  // Faint reflections are cut off. Progressive frames instead follow
+  // them with probability proportional to their weight and make up for
+  // the rest by a larger weight, which keeps the average unbiased.
+  double next_throughput = throughput * material.reflectivity();
+  if (next_throughput < frame.reflectionThreshold)
   {
-    // No hit
-    return RayHit();
+    const double survival = next_throughput / frame.reflectionThreshold;
+    if (!frame.accumulation || !(random.next() < survival))
+      return false;
+
+    next_throughput = frame.reflectionThreshold;
   }
 
-  const Vec    translation = object.transform().position();
-  const Matrix scale       = Matrix::fromScale(object.transform().scale());
-  const Matrix rotation    = object.transform().rotation();
+  // Add reflection
+  const double dot_product = Vec::dotProduct(ray.direction(), hit.normal());
+  const Vec ortho     = ray.direction() - dot_product*hit.normal();
+  const Vec reflected = -ray.direction() + 2*ortho;
 
-  const Matrix scale_inv    = scale.getInverse();
-  const Matrix rotation_inv = rotation.getInverse();
+  ray        = Ray(hit.point(), reflected);
+  throughput = next_throughput;
+  return true;
+}
 
-  Ray transformed(scale_inv*rotation_inv*(m_source - translation),
-                  scale_inv*rotation_inv*m_direction,
-                  m_color);
+/**
+ * @brief Direction around unit `normal` with density proportional to
+ * cosine of angle to it, given by two uniform numbers in [0, 1)
+ */
+static Vec getCosineDirection(const Vec& normal, double u, double v)
+{
+  // Orthonormal basis around normal (Duff et al., 2017)
+  const real sign = std::copysign(real(1), normal.m_z);
+  const real a    = -1 / (sign + normal.m_z);
+  const real b    = normal.m_x * normal.m_y * a;
+  const Vec tangent  (1 + sign * normal.m_x * normal.m_x * a,
+                      sign * b, -sign * normal.m_x);
+  const Vec bitangent(b, sign + normal.m_y * normal.m_y * a, -normal.m_y);
+
+  // Point picked uniformly on unit disk, lifted onto hemisphere
+  const double radius = sqrt(u);
+  const double angle  = 2 * M_PI * v;
+  return tangent   * real(radius * cos(angle))
+       + bitangent * real(radius * sin(angle))
+       + normal    * real(sqrt(1 - u));
+}
 
-  RayHit hit;
+static double getMaxComponent(const Color& color)
+{
+  return std::max({double(color.redNormalized()),
+                   double(color.greenNormalized()),
+                   double(color.blueNormalized())});
+}
 
-  switch (object.type())
+static bool scatterRay(const FrameContext& frame, const RayHit& hit,
+                       const Material& material, size_t bounces,
+                       SampleRandom& random, Ray& ray, double& throughput,
+                       Color& filter, bool& is_diffuse)
+{
+  if (bounces >= material.getMaxReflections(frame.maxReflections))
+    return false;
+
+  // Each kind of bounce is picked with probability equal to its share of
+  // light, so the share cancels out of path weight. Cosine-weighted
+  // diffuse bounce likewise cancels cosine of Lambertian surface, leaving
+  // only its color.
+  is_diffuse = random.next() < material.diffusion();
+  const Color next_filter = is_diffuse ? filter * material.color() : filter;
+
+  // Faint paths are cut off, or left to Russian roulette when rendering
+  // progressively, as reflections are
+  double next_throughput = throughput;
+  const double weight = throughput * getMaxComponent(next_filter);
+  if (weight < frame.reflectionThreshold)
   {
-  case ObjectType::Sphere:
-    hit = transformed.hitSphere();
-    break;
-  case ObjectType::Box:
-    hit = transformed.hitBox();
-    break;
-  case ObjectType::Plane:
-    hit = transformed.hitPlane();
-    break;
+    const double survival = weight / frame.reflectionThreshold;
+    if (!frame.accumulation || !(random.next() < survival))
+      return false;
+
+    next_throughput = throughput / survival;
+  }
 
-  case ObjectType::Empty:
-  default: return RayHit();
+  // Surface scatters light back to the side ray came from
+  const double dot_product = Vec::dotProduct(ray.direction(), hit.normal());
+  if (is_diffuse)
+  {
+    const Vec normal = dot_product > 0 ? -hit.normal() : hit.normal();
+    const double u = random.next();
+    const double v = random.next();
+    ray = Ray(hit.point(), getCosineDirection(normal, u, v));
+  }
+  else
+  {
+    const Vec ortho = ray.direction() - dot_product*hit.normal();
+    ray = Ray(hit.point(), -ray.direction() + 2*ortho);
   }
 
-  if (!hit.hasHit())
+  throughput = next_throughput;
+  filter     = next_filter;
+  return true;
+}
+
+static size_t findOccluder(const Ray& ray, real max_distance,
+                           const Scene& scene, const Bvh& bvh,
+                           size_t& last_occluder)
+{
+  // Whatever blocked previous ray towards this light likely blocks this one
+  if (last_occluder != RayHit::NO_OBJECT
+   && ray.getHitDistance(scene, last_occluder) < max_distance)
+    return last_occluder;
+
+  const size_t occluder = ray.getOccluder(bvh, max_distance);
+  if (occluder != RayHit::NO_OBJECT)
+    last_occluder = occluder;
+
+  return occluder;
+}
+
+/**
+ * @brief Shadow ray from `hit` towards light `source`
+ *
+ * @param[out] distance  Distance to light along the ray, infinite if ray
+ *                       misses it
+ * @param[out] light     Light reaching `hit` if nothing blocks the ray
+ */
+static Ray getShadowRay(const RayHit& hit, const SceneLight& source,
+                        const Scene& scene, real& distance, Color& light)
+{
+  // Cast ray towards light source
+  Vec direction = (source.position - hit.point()).normalized();
+  Ray cast(hit.point(), direction);
+  distance = cast.getHitDistance(scene, source.object);
+
+  double cosine = fabs(Vec::dotProduct(direction, hit.normal()));
+  light = cosine*source.power;
+  return cast;
+}
+
+/**
+ * @brief Shadow ray from `hit` towards directed light of `scene`
+ *
+ * @param[out] light  Light reaching `hit` if nothing blocks the ray
+ */
+static Ray getDirectedShadowRay(const RayHit& hit, const Scene& scene,
+                                Color& light)
+{
+  const Vec direction = -scene.directedLight().direction;
+  Ray cast(hit.point(), direction);
+
+  double cosine = fabs(Vec::dotProduct(direction, hit.normal()));
+  light = cosine*scene.directedLight().color;
+  return cast;
+}
+
+/**
+ * @brief Whether anything blocks shadow ray `cast` before `distance`,
+ * using occluder cache of `slot`
+ */
+static bool isShadowed(const Ray& cast, real distance, size_t slot,
+                       const Scene& scene, const Bvh& bvh, TileState& state)
+{
+  const size_t occluder = findOccluder(cast, distance, scene, bvh,
+                                       state.shadows.lastOccluder(slot));
+  state.log.addObject(occluder);
+  state.log.addSegment(cast, distance);
+
+  return occluder != RayHit::NO_OBJECT;
+}
+
+/**
+ * @brief Light `source` adds to `hit`, tracing shadow ray with occluder
+ * cache of `slot`
+ */
+static Color getLightFrom(const RayHit& hit, const SceneLight& source,
+                          size_t slot, const Scene& scene, const Bvh& bvh,
+                          TileState& state)
+{
+  // If light source is the same as hit->object()
+  if (source.object == hit.object())
   {
-    // No hit
-    return RayHit();
+    // Skip light source
+    return Color::Black;
   }
 
-  hit.m_hitPoint    =  rotation*scale    *hit.m_hitPoint + translation;
-  hit.m_hitNormal   = (rotation*scale_inv*hit.m_hitNormal).normalized();
-  hit.m_hitDistance = (m_source - hit.m_hitPoint).length();
-  hit.m_hitObject   = &object;
+  real  light_distance = 0;
+  Color light          = Color::Black;
+  const Ray cast = getShadowRay(hit, source, scene, light_distance, light);
+
+  // Light source affects this hit even if occluded now
+  state.log.addObject(source.object);
+  if (!std::isfinite(light_distance))
+    return Color::Black;
 
-  return hit;
+  // If something between hit and light source
+  if (isShadowed(cast, light_distance, slot, scene, bvh, state))
+    return Color::Black;
+
+  // Add lighting
+  return light;
 }
 
-RayHit Ray::getClosestRayHit(const Scene& scene)
+/**
+ * @brief Call `visit(source, slot, weight)` for each light shading `hit`,
+ * except directed light. Light of `source` is scaled by `weight`, tracing
+ * its shadow ray uses occluder cache of `slot`. Lights are either all
+ * traced or sampled with `random`, either way slot is keyed by index of
+ * light, so that cached occluder belongs to the same light.
+ */
+template <typename Visit>
+static void visitLights(const RayHit& hit, const Scene& scene,
+                        TileState& state, SampleRandom& random,
+                        Visit&& visit)
 {
-  RayHit best_hit;
-  size_t object_count = scene.objectCount();
-  // For each scene object
-  for(size_t i = 0; i < object_count; ++i)
+  const std::vector<SceneLight>& lights = scene.lights();
+  if (state.lights.isEnabled())
   {
-    // Get ray hit
-    RayHit hit = getRayHit(scene[i]);
+    // Each sample is an unbiased estimate of light from all sources,
+    // their average is the result
+    const size_t sample_count = state.lights.sampleCount();
+    for (size_t i = 0; i < sample_count; ++i)
+    {
+      double probability = 0;
+      const size_t index = state.lights.sample(hit.point(), hit.normal(),
+                                               random, probability);
+      if (index == LightTree::NO_LIGHT || !(probability > 0))
+        continue;
+
+      // Slot zero is taken by directed light
+      visit(lights[index], index + 1,
+            1.0 / (probability * double(sample_count)));
+    }
+  }
+  else
+  {
+    // For each light source in scene
+    for (size_t i = 0; i < lights.size(); ++i)
+      visit(lights[i], i + 1, 1.0);
+  }
+}
+
+static Color getLighting(const RayHit& hit, const Scene& scene,
+                         const Bvh& bvh, TileState& state)
+{
+  Color light = Color::Black;
+
+  visitLights(hit, scene, state, state.random,
+              [&](const SceneLight& source, size_t slot, double weight)
+  {
+    light += getLightFrom(hit, source, slot, scene, bvh, state) * weight;
+  });
 
-    // If hit object closer than best hit
-    if (hit.hasHit() && hit.distance() < best_hit.distance())
+  // If directed light source present
+  if (scene.hasDirectedLight())
+  {
+    Color directed = Color::Black;
+    const Ray cast = getDirectedShadowRay(hit, scene, directed);
+
+    // If not occluded
+    if (!isShadowed(cast, INFINITY, 0, scene, bvh, state))
     {
-      // Update best hit
-      best_hit = hit;
+      // Add lighting
+      light += directed;
     }
   }
 
-  return best_hit;
+  // Return lighting
+  return light;
+}
+
+static void generatePaths(const FrameContext& frame,
+                          const std::vector<SampleId>& samples,
+                          size_t first, size_t count,
+                          WavefrontQueues& queues);
+static void intersectPaths(const FrameContext& frame, bool is_primary,
+                           WavefrontQueues& queues);
+static void sortPaths(WavefrontQueues& queues);
+static void shadePaths(const FrameContext& frame, TileState& state);
+static void traceShadows(const FrameContext& frame, TileState& state);
+static void finishPaths(const FrameContext& frame, std::vector<Color>& colors,
+                        WavefrontQueues& queues);
+
+/**
+ * @brief Trace `samples` stage by stage. Camera rays of a batch of samples
+ * are generated, then intersected with scene, then hits are shaded,
+ * queuing shadow rays and reflections, then shadow rays are traced and
+ * reflections go through the same stages until no path is left. Each
+ * stage runs over its whole queue, keeping its code and data in cache,
+ * and gives the same colors as tracing samples one by one.
+ */
+static void traceWavefront(const FrameContext& frame,
+                           const std::vector<SampleId>& samples,
+                           std::vector<Color>& colors, TileState& state)
+{
+  colors.assign(samples.size(), Color::Black);
+
+  for (size_t first = 0; first < samples.size();
+       first += WavefrontQueues::MAX_PATHS)
+  {
+    const size_t count = std::min(WavefrontQueues::MAX_PATHS,
+                                  samples.size() - first);
+    generatePaths(frame, samples, first, count, state.queues);
+
+    // Only camera rays are coherent enough to trace in packets, others
+    // may be sorted to become more coherent
+    bool is_primary = true;
+    while (!state.queues.paths.empty())
+    {
+      if (!is_primary && frame.sortRays)
+        sortPaths(state.queues);
+
+      intersectPaths(frame, is_primary, state.queues);
+      shadePaths(frame, state);
+      traceShadows(frame, state);
+      finishPaths(frame, colors, state.queues);
+      is_primary = false;
+    }
+  }
 }
 
-RayHit Ray::hitSphere() const
+static void generatePaths(const FrameContext& frame,
+                          const std::vector<SampleId>& samples,
+                          size_t first, size_t count,
+                          WavefrontQueues& queues)
 {
-  // Equation for sphere:
-  // (r, r) = 1
-  // Equation for ray:
-  // r = s + d*t
-  // Equation for intersection:
-  // A = (d, d)
-  // B = 2*(s, d)
-  // C = (s, s) - 1
-  // At^2 + Bt + C = 0
-  const double A = Vec::dotProduct(direction(), direction()); // = 1
-  const double B_half = Vec::dotProduct(source(), direction());
-  const double C = Vec::dotProduct(source(), source()) - 1;
-  const double D_half = B_half*B_half - A*C;
+  queues.paths.clear();
 
-  if (D_half < 0)
+  // Packet tracing computes camera rays in packets as well, which differ
+  // from rays computed one by one in rounding
+  std::vector<Ray>& rays = queues.packetRays;
+  for (size_t i = first; i < first + count; ++i)
   {
-    // No hit
-    return RayHit();
+    const size_t lane = (i - first) % RayPacket::SIZE;
+    if (frame.packetTracing && lane == 0)
+    {
+      RayPacket packet;
+      getSamplePacket(frame, samples, i,
+                      std::min(RayPacket::SIZE, first + count - i),
+                      packet, rays);
+    }
+
+    double x = 0;
+    double y = 0;
+    if (!frame.packetTracing)
+      getSamplePoint(frame, samples[i], x, y);
+
+    WavefrontPath path = {
+      .ray         = frame.packetTracing ? rays[lane]
+                                         : frame.renderPlane.getRayFrom(x, y),
+      .random      = SampleRandom(),
+      .color       = Color::Black,
+      .throughput  = 1,
+      .filter      = Color::White,
+      .sample      = uint32_t(i),
+      .reflections = 0,
+      .isActive    = true,
+      .isDiffuse   = false,
+      .material    = nullptr,
+      .cosine      = 0,
+      .weight      = 0,
+      .tint        = Color::Black,
+      .light       = Color::Black
+    };
+    seedSample(frame, samples[i], path.random);
+    queues.paths.push_back(path);
   }
+}
 
-  const double D_sqrt = sqrt(D_half);
-  const double t_0 = (-B_half - D_sqrt) / A;
-  const double t_1 = (-B_half + D_sqrt) / A;
+static void intersectPaths(const FrameContext& frame, bool is_primary,
+                           WavefrontQueues& queues)
+{
+  const std::vector<WavefrontPath>& paths = queues.paths;
+  queues.hits.clear();
 
-  double t_res = -1;
-  if      (t_0 > render_margin) t_res = t_0;
-  else if (t_1 > render_margin) t_res = t_1;
+  if (!is_primary || !frame.packetTracing)
+  {
+    for (const WavefrontPath& path : paths)
+      queues.hits.push_back(path.ray.getClosestRayHit(frame.bvh));
+    return;
+  }
 
-  if (t_res < 0)
+  std::vector<Ray>& rays = queues.packetRays;
+  for (size_t first = 0; first < paths.size(); first += RayPacket::SIZE)
   {
-    // No hit
-    return RayHit();
+    const size_t count = std::min(RayPacket::SIZE, paths.size() - first);
+
+    // Pad incomplete packet with copies of its last ray
+    rays.clear();
+    for (size_t lane = 0; lane < RayPacket::SIZE; ++lane)
+      rays.push_back(paths[first + std::min(lane, count - 1)].ray);
+
+    RayPacket packet;
+    packet.setRays(rays.data(), (1u << count) - 1);
+
+    PacketHit packet_hit;
+    frame.bvh.getClosestHits(packet, packet_hit);
+
+    for (size_t lane = 0; lane < count; ++lane)
+      queues.hits.push_back(
+          rays[lane].getRayHit(frame.scene, packet_hit.objectAt(lane)));
   }
+}
+
+/**
+ * @brief Spread lower 10 bits of `value` to every third bit
+ */
+static uint32_t spreadBits(uint32_t value)
+{
+  value &= 0x3FF;
+  value = (value | (value << 16)) & 0x030000FF;
+  value = (value | (value <<  8)) & 0x0300F00F;
+  value = (value | (value <<  4)) & 0x030C30C3;
+  value = (value | (value <<  2)) & 0x09249249;
+  return value;
+}
 
-  const Point  hit_point    = source() + t_res * direction();
-  const Vec    hit_normal   = hit_point.normalized();
-  const double hit_distance = t_res;
+/**
+ * @brief Sort key of `ray`: octant of its direction, then Morton code of
+ * its source inside `bounds`. Rays with close keys start near each other
+ * and go the same way, so they visit the same hierarchy nodes.
+ */
+static uint64_t getCoherenceKey(const Ray& ray, const Bounds& bounds)
+{
+  const Vec& direction = ray.direction();
+  const uint64_t octant = (direction.m_x < 0 ? 1u : 0u)
+                        | (direction.m_y < 0 ? 2u : 0u)
+                        | (direction.m_z < 0 ? 4u : 0u);
+
+  const Vec offset = ray.source() - bounds.min();
+  const Vec extent = bounds.extent();
+  auto quantize = [](real coord, real size)
+  {
+    // Flat bounds put all sources in the first cell
+    const double cell = size > 0 ? double(coord) / double(size) * 1023 : 0;
+    return spreadBits(uint32_t(std::min(std::max(cell, 0.0), 1023.0)));
+  };
+
+  const uint64_t morton = quantize(offset.m_x, extent.m_x)
+                        | quantize(offset.m_y, extent.m_y) << 1
+                        | quantize(offset.m_z, extent.m_z) << 2;
+
+  return octant << 30 | morton;
+}
+
+/**
+ * @brief Fill `keys` with positions of `count` rays given by
+ * `get_ray(index)` in the order they should be traced, each in low
+ * `WavefrontQueues::SORT_INDEX_BITS` bits of a key
+ */
+template <typename GetRay>
+static void sortRays(size_t count, GetRay&& get_ray,
+                     std::vector<uint64_t>& keys)
+{
+  Bounds bounds;
+  for (size_t i = 0; i < count; ++i)
+    bounds |= get_ray(i).source();
+
+  keys.clear();
+  for (size_t i = 0; i < count; ++i)
+    keys.push_back(getCoherenceKey(get_ray(i), bounds)
+                     << WavefrontQueues::SORT_INDEX_BITS | i);
 
-  return RayHit(hit_distance, hit_point, hit_normal);
+  std::sort(keys.begin(), keys.end());
 }
 
-RayHit Ray::hitBox   () const
+static void sortPaths(WavefrontQueues& queues)
 {
-  // TODO: Render boxes
-  return RayHit();
+  std::vector<WavefrontPath>& paths = queues.paths;
+  sortRays(paths.size(), [&](size_t i) -> const Ray& { return paths[i].ray; },
+           queues.sortKeys);
+
+  // Each path gathers light on its own, so their order does not change
+  // the image
+  queues.sortedPaths.clear();
+  for (uint64_t key : queues.sortKeys)
+    queues.sortedPaths.push_back(
+        paths[key & WavefrontQueues::SORT_INDEX_MASK]);
+
+  paths.swap(queues.sortedPaths);
 }
 
-RayHit Ray::hitPlane () const
+/**
+ * @brief Add `shadow` to shadow queue, tracing the queue first if full
+ */
+static void queueShadow(const FrameContext& frame, TileState& state,
+                        const WavefrontShadow& shadow)
 {
-  // Plane equation:
-  // (n, r) = 0
-  // Ray equation:
-  // r = s + d*t
-  // Intersection equation:
-  //     -(n, s)
-  // t = -------
-  //      (n, d)
-  // In standard position n = (0, 1, 0), therefore:
-  // t = -s.y / d.y
-  
-  if (fabs(direction().m_y) < render_margin)
+  if (state.queues.shadows.size() >= WavefrontQueues::MAX_SHADOWS)
+    traceShadows(frame, state);
+
+  state.queues.shadows.push_back(shadow);
+}
+
+static void shadePaths(const FrameContext& frame, TileState& state)
+{
+  const Scene&     scene  = frame.scene;
+  WavefrontQueues& queues = state.queues;
+
+  for (size_t i = 0; i < queues.paths.size(); ++i)
   {
-    // Plane parallel to ray, no hit
-    return RayHit();
+    WavefrontPath& path = queues.paths[i];
+    const RayHit&  hit  = queues.hits[i];
+
+    // Remember what this ray saw
+    state.log.addSegment(path.ray, hit.distance());
+    state.log.addObject(hit.object());
+    path.isActive = false;
+
+    // If no object hit
+    if (!hit.hasHit())
+    {
+      path.color += path.throughput
+                  * (path.filter * getMissColor(frame, path.ray,
+                                                path.isDiffuse));
+      continue;
+    }
+
+    const Material& material = scene.objectMaterial(hit.object());
+    if (scene.isLightSource(hit.object()))
+    {
+      path.color += path.throughput
+                  * (path.filter * getGlowColor(frame, path.ray, hit,
+                                                material, path.isDiffuse));
+      continue;
+    }
+
+    // Surface color is known once all its shadow rays are traced
+    path.material = &material;
+    path.cosine   = fabs(Vec::dotProduct(path.ray.direction(), hit.normal()));
+    path.weight   = path.throughput;
+    path.light    = Color::Black;
+    path.tint     = path.filter;
+
+    visitLights(hit, scene, state, path.random,
+                [&](const SceneLight& source, size_t slot, double weight)
+    {
+      // Skip light source being shaded
+      if (source.object == hit.object())
+        return;
+
+      real  distance = 0;
+      Color light    = Color::Black;
+      const Ray cast = getShadowRay(hit, source, scene, distance, light);
+
+      // Light source affects this hit even if occluded now
+      state.log.addObject(source.object);
+      if (!std::isfinite(distance))
+        return;
+
+      queueShadow(frame, state, WavefrontShadow{
+        .ray      = cast,
+        .distance = distance,
+        .light    = light * weight,
+        .path     = uint32_t(i),
+        .slot     = uint32_t(slot)
+      });
+    });
+
+    if (scene.hasDirectedLight())
+    {
+      Color light = Color::Black;
+      const Ray cast = getDirectedShadowRay(hit, scene, light);
+
+      queueShadow(frame, state, WavefrontShadow{
+        .ray      = cast,
+        .distance = INFINITY,
+        .light    = light,
+        .path     = uint32_t(i),
+        .slot     = 0
+      });
+    }
+
+    path.isActive = frame.pathTracing
+                  ? scatterRay(frame, hit, material, path.reflections,
+                               path.random, path.ray, path.throughput,
+                               path.filter, path.isDiffuse)
+                  : reflectRay(frame, hit, material, path.reflections,
+                               path.random, path.ray, path.throughput);
+    if (path.isActive)
+      ++path.reflections;
+  }
+}
+
+static void traceShadows(const FrameContext& frame, TileState& state)
+{
+  WavefrontQueues&                    queues  = state.queues;
+  const std::vector<WavefrontShadow>& shadows = queues.shadows;
+
+  if (!frame.sortRays)
+  {
+    for (const WavefrontShadow& shadow : shadows)
+    {
+      if (!isShadowed(shadow.ray, shadow.distance, shadow.slot,
+                      frame.scene, frame.bvh, state))
+        queues.paths[shadow.path].light += shadow.light;
+    }
+
+    queues.shadows.clear();
+    return;
+  }
+
+  sortRays(shadows.size(),
+           [&](size_t i) -> const Ray& { return shadows[i].ray; },
+           queues.sortKeys);
+
+  queues.isShadowed.assign(shadows.size(), 0);
+  for (uint64_t key : queues.sortKeys)
+  {
+    const size_t           index  = key & WavefrontQueues::SORT_INDEX_MASK;
+    const WavefrontShadow& shadow = shadows[index];
+    queues.isShadowed[index] = isShadowed(shadow.ray, shadow.distance,
+                                          shadow.slot, frame.scene,
+                                          frame.bvh, state);
   }
 
-  const double t = - source().m_y / direction().m_y;
-  if (t < render_margin)
+  // Light is added in queue order, so that sums do not depend on sorting
+  for (size_t i = 0; i < shadows.size(); ++i)
   {
-    // No hit
-    return RayHit();
+    if (!queues.isShadowed[i])
+      queues.paths[shadows[i].path].light += shadows[i].light;
+  }
+
+  queues.shadows.clear();
+}
+
+static void finishPaths(const FrameContext& frame, std::vector<Color>& colors,
+                        WavefrontQueues& queues)
+{
+  std::vector<WavefrontPath>& paths = queues.paths;
+
+  // Keep paths which go on, in their order
+  size_t active_count = 0;
+  for (size_t i = 0; i < paths.size(); ++i)
+  {
+    WavefrontPath& path = paths[i];
+    if (path.material)
+    {
+      path.color += path.weight
+                  * (path.tint * getSurfaceColor(frame, path.light,
+                                                    path.cosine,
+                                                    *path.material));
+      path.material = nullptr;
+    }
+
+    if (!path.isActive)
+    {
+      colors[path.sample] = path.color;
+      continue;
+    }
+
+    if (active_count != i)
+      paths[active_count] = path;
+    ++active_count;
   }
 
-  const Point hit_point = source() + t*direction();
-  return RayHit(t, hit_point, Vec::UNIT_Y);
+  paths.erase(paths.begin() + ptrdiff_t(active_count), paths.end());
 }
@@ -12,27 +12,365 @@
 #ifndef __RAY_TRACE_RENDERER_H
 #define __RAY_TRACE_RENDERER_H
 
-#include <SFML/Graphics/Texture.hpp>
+#include <cstddef>
 #include <cstdint>
+#include <vector>
 
+#include "ray_trace/bounds.h"
+#include "ray_trace/bvh.h"
+#include "ray_trace/color.h"
+#include "ray_trace/light_tree.h"
 #include "ray_trace/scene.h"
+#include "ray_trace/thread_pool.h"
+
+struct Pixel
+{
+  uint8_t red;
+  uint8_t green;
+  uint8_t blue;
+  uint8_t alpha;
+};
+
+/**
+ * @brief Rectangle of image pixels
+ */
+struct ImageRect
+{
+  size_t x;
+  size_t y;
+  size_t width;
+  size_t height;
+};
+
+/**
+ * @brief What rays traced for a tile interacted with: objects they hit or
+ * took light from, and bounds of ray segments inside the region where
+ * changes are tracked
+ */
+struct TileFootprint
+{
+  std::vector<uint32_t> objects;
+  Bounds                rays;
+
+  TileFootprint() : objects(), rays() {}
+};
+
+/**
+ * @brief Work done once per frame before tracing starts
+ */
+struct FrameStats
+{
+  // Rebuilding hierarchy, zero if no object changed
+  double hierarchyMs;
+
+  // Rebuilding light list and light hierarchy, zero if they were up to date
+  double lightsMs;
+  size_t lightCount;
+
+  FrameStats() : hierarchyMs(0), lightsMs(0), lightCount(0) {}
+};
+
+/**
+ * @brief Scratch ray queues of one render thread, see `Renderer::wavefront`
+ */
+struct WavefrontQueues;
 
 class Renderer
 {
 public:
-  Renderer(sf::Texture& texture):
-    m_texture(texture)
+  /**
+   * @brief Side of a square tile, in pixels. Tiles are the unit of work
+   * handed out to render threads.
+   */
+  static constexpr size_t TILE_SIZE = 16;
+
+  /**
+   * @brief Create renderer producing `width` by `height` images with
+   * `thread_count` render threads. Zero means one thread per hardware
+   * thread.
+   */
+  Renderer(size_t width, size_t height, size_t thread_count = 0);
+
+  Renderer(const Renderer& other) = delete;
+  Renderer& operator=(const Renderer& other) = delete;
+
+  size_t width()  const { return m_width; }
+  size_t height() const { return m_height; }
+
+  void resize(size_t width, size_t height)
+  {
+    m_width  = width;
+    m_height = height;
+    m_pixels.resize(width * height);
+    resetAccumulation();
+  }
+
+  size_t threadCount() const { return m_threadPool.threadCount(); }
+
+  /**
+   * @brief Each pixel is sampled on a `side` by `side` grid of rays
+   */
+  size_t sampleGrid() const { return m_sampleGrid; }
+  void setSampleGrid(size_t side)
+  {
+    m_sampleGrid = side > 0 ? side : 1;
+    resetAccumulation();
+  }
+
+  size_t samplesPerPixel() const { return m_sampleGrid * m_sampleGrid; }
+
+  /**
+   * @brief Number of mirror bounces traced after primary hit, or of any
+   * bounces when path tracing, unless material of surface sets its own
+   * limit
+   */
+  size_t maxReflections() const { return m_maxReflections; }
+  void setMaxReflections(size_t count)
+  {
+    m_maxReflections = count;
+    resetAccumulation();
+  }
+
+  /**
+   * @brief Reflections whose weight in pixel, the product of
+   * reflectivities along the path, falls below `threshold` are not traced.
+   * Progressive rendering instead continues them by Russian roulette, so
+   * accumulated image still converges to the full one. Zero traces all
+   * reflections up to depth limit.
+   */
+  double reflectionThreshold() const { return m_reflectionThreshold; }
+  void setReflectionThreshold(double threshold)
+  {
+    m_reflectionThreshold = threshold > 0 ? threshold : 0;
+    resetAccumulation();
+  }
+
+  /**
+   * @brief Trace shadow rays to `count` lights per shading point, picked
+   * in proportion to their estimated contribution, instead of to all of
+   * them. Cost per pixel then stays about the same however many lights
+   * scene has, at the price of noise which progressive rendering averages
+   * out. Zero, or a scene with no more lights than that, traces all.
+   */
+  size_t lightSamples() const { return m_lightSamples; }
+  void setLightSamples(size_t count)
+  {
+    m_lightSamples = count;
+    resetAccumulation();
+  }
+
+  /**
+   * @brief Trace primary rays of neighbouring samples as SIMD packets.
+   * Matches tracing them one by one up to rounding on object silhouettes.
+   */
+  bool packetTracing() const { return m_packetTracing; }
+  void setPacketTracing(bool enabled) { m_packetTracing = enabled; }
+
+  /**
+   * @brief Trace samples of each tile stage by stage instead of one by
+   * one: intersect a queue of rays, shade all of their hits, then trace
+   * all shadow rays and repeat with reflections. Queues hold a bounded
+   * number of rays, so memory does not grow with image size. Gives the
+   * same image as tracing samples one by one.
+   */
+  bool wavefront() const { return m_wavefront; }
+  void setWavefront(bool enabled) { m_wavefront = enabled; }
+
+  /**
+   * @brief Let wavefront engine sort reflection and shadow rays of a tile
+   * by direction octant and origin before tracing them, so that rays
+   * traced in a row visit the same part of hierarchy. Results go back to
+   * their samples, the image does not change. Rays of one tile already
+   * start close to each other, so sorting pays off only when their
+   * hierarchy does not fit in cache.
+   */
+  bool coherenceSorting() const { return m_coherenceSorting; }
+  void setCoherenceSorting(bool enabled) { m_coherenceSorting = enabled; }
+
+  /**
+   * @brief Shade by Monte Carlo path tracing instead of mirror reflections
+   * and direct light. Each bounce is diffuse, in a cosine-weighted random
+   * direction, with probability of material diffusion, and specular
+   * otherwise. Light sources are reached by shadow rays, ambient light
+   * comes from the sky. Random numbers of a sample depend only on its
+   * pixel, frame and index, so image is the same for any thread count.
+   * Single frames are noisy, progressive rendering averages them out.
+   */
+  bool pathTracing() const { return m_pathTracing; }
+  void setPathTracing(bool enabled)
+  {
+    m_pathTracing = enabled;
+    resetAccumulation();
+  }
+
+  /**
+   * @brief Keep adding jittered samples to every pixel while scene and
+   * camera stay unchanged, showing their running average. Each frame adds
+   * `samplesPerPixel()` samples, any change restarts accumulation (only
+   * in affected tiles when rendering incrementally).
+   */
+  bool progressive() const { return m_progressive; }
+  void setProgressive(bool enabled)
+  {
+    m_progressive = enabled;
+    resetAccumulation();
+  }
+
+  /**
+   * @brief Frames averaged in current image. Once `maxAccumulatedFrames`
+   * is reached, rendering an unchanged scene does no work. Zero means
+   * no limit.
+   */
+  size_t accumulatedFrames()    const;
+  size_t maxAccumulatedFrames() const { return m_maxAccumulatedFrames; }
+  void setMaxAccumulatedFrames(size_t count) { m_maxAccumulatedFrames = count; }
+
+  bool isConverged() const
+  {
+    return m_progressive && m_maxAccumulatedFrames > 0
+        && accumulatedFrames() >= m_maxAccumulatedFrames;
+  }
+
+  /**
+   * @brief Discard accumulated samples, next frame starts from scratch
+   */
+  void resetAccumulation() { m_fullRedraw = true; }
+
+  /**
+   * @brief Trace one sample per pixel, then add more only to pixels which
+   * differ from a neighbour by more than `adaptiveThreshold` in some color
+   * channel. Such pixels get samples until the standard error of their
+   * mean luminance drops below a quarter of the threshold or all
+   * `samplesPerPixel()` cells of the grid are used. Ignored when
+   * rendering progressively.
+   */
+  bool adaptive() const { return m_adaptive; }
+  void setAdaptive(bool enabled)
+  {
+    m_adaptive = enabled;
+    resetAccumulation();
+  }
+
+  double adaptiveThreshold() const { return m_adaptiveThreshold; }
+  void setAdaptiveThreshold(double threshold)
   {
+    m_adaptiveThreshold = threshold;
+    resetAccumulation();
   }
 
-  const sf::Texture& texture() const { return m_texture; }
-        sf::Texture& texture()       { return m_texture; }
+  /**
+   * @brief Re-trace only tiles which may have changed since last frame.
+   * Renderer remembers which objects rays of each tile hit or took light
+   * from, and where those rays went. A changed object then re-traces
+   * tiles that saw it before and tiles whose rays pass its new bounds,
+   * which covers its shadows and reflections. Camera and global light
+   * changes, as well as moving planes or light sources appearing, still
+   * re-trace everything.
+   */
+  bool incremental() const { return m_incremental; }
+  void setIncremental(bool enabled)
+  {
+    m_incremental = enabled;
+    resetAccumulation();
+  }
+
+  /**
+   * @brief Parts of image which changed during last frame
+   */
+  const std::vector<ImageRect>& updatedRects() const { return m_updatedRects; }
+
+  /**
+   * @brief Copy pixels of `rect` row by row into `destination`, which
+   * must hold `rect.width * rect.height` pixels
+   */
+  void copyRect(const ImageRect& rect, Pixel* destination) const;
+
+  /**
+   * @brief Number of primary rays traced for last frame
+   */
+  size_t tracedSamples() const { return m_tracedSamples; }
+
+  /**
+   * @brief Setup work of last frame
+   */
+  const FrameStats& frameStats() const { return m_frameStats; }
+
+  /**
+   * @brief Rendered image, row by row, in RGBA format
+   */
+  const Pixel* pixels() const { return m_pixels.data(); }
 
   void renderScene(const Scene& scene);
 
-  ~Renderer() = default;
+  ~Renderer();
 private:
-  sf::Texture& m_texture;
+  size_t                     m_width;
+  size_t                     m_height;
+  ThreadPool                 m_threadPool;
+  Bvh                        m_bvh;
+  std::vector<Pixel>         m_pixels;
+  std::vector<Color>         m_accumulation;
+  size_t                     m_sampleGrid;
+  size_t                     m_maxReflections;
+  double                     m_reflectionThreshold;
+  size_t                     m_lightSamples;
+  LightTree                  m_lightTree;
+  bool                       m_lightTreeOutdated;
+  bool                       m_packetTracing;
+  bool                       m_wavefront;
+  bool                       m_coherenceSorting;
+  bool                       m_pathTracing;
+  bool                       m_progressive;
+  std::vector<size_t>        m_tileFrames;
+  size_t                     m_maxAccumulatedFrames;
+  bool                       m_adaptive;
+  double                     m_adaptiveThreshold;
+  std::vector<Color>         m_baseColors;
+  size_t                     m_tracedSamples;
+  FrameStats                 m_frameStats;
+  bool                       m_incremental;
+  std::vector<TileFootprint> m_footprints;
+  Bounds                     m_footprintRegion;
+  std::vector<ImageRect>     m_updatedRects;
+
+  // Ray queues of wavefront engine, one per render thread, allocated once
+  // and reused by every tile
+  std::vector<WavefrontQueues> m_wavefrontQueues;
+
+  /**
+   * @brief Object state used to find tiles affected by its change
+   */
+  struct ObjectState
+  {
+    Bounds bounds;
+    bool   isLightSource;
+  };
+
+  // Scene state used for the last frame
+  const Scene*             m_scene;
+  std::vector<uint64_t>    m_objectHashes;
+  std::vector<ObjectState> m_objectStates;
+  uint64_t                 m_viewHash;
+  bool                     m_fullRedraw;
+
+  /**
+   * @brief Compare scene with the one used for last frame
+   *
+   * @param[out] changed  Objects added or changed since last frame
+   *
+   * @return Whether anything which requires full redraw changed
+   */
+  bool findChanges(const Scene& scene, std::vector<size_t>& changed);
+
+  /**
+   * @brief Mark tiles affected by `changed` objects
+   *
+   * @return `false` if change cannot be localized and all tiles are dirty
+   */
+  bool markDirtyTiles(const Scene& scene, const std::vector<size_t>& changed,
+                      std::vector<bool>& dirty) const;
+
+  void updateFootprintRegion(const Scene& scene);
 };
 
 #endif /* renderer.h */
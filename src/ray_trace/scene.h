@@ -13,10 +13,16 @@
 #define __RAY_TRACE_SCENE_H
 
 #include <cstddef>
+#include <memory>
+#include <vector>
 
+#include "ray_trace/bounds.h"
 #include "ray_trace/camera.h"
+#include "ray_trace/chunked_array.h"
 #include "ray_trace/scene_object.h"
 #include "ray_trace/color.h"
+#include "ray_trace/mapped_file.h"
+#include "ray_trace/mesh.h"
 
 struct DirectedLight
 {
@@ -30,19 +36,54 @@ struct DirectedLight
   }
 };
 
+/**
+ * @brief Object emitting light, as seen from shaded surfaces
+ */
+struct SceneLight
+{
+  uint32_t object;
+
+  // Shadow rays aim at center of light
+  Point    position;
+  Bounds   bounds;
+
+  // Color added to surfaces directly facing light
+  Color    power;
+};
+
+/**
+ * @brief Renderable objects with camera and global lighting.
+ *
+ * Objects are stored field by field: types and transforms, which are read
+ * by every ray-object test, live in their own contiguous arrays apart from
+ * material indices, which are only needed for shading. Objects are
+ * instances: materials and meshes are kept once and shared by every
+ * object referring to them. Objects, materials and meshes are addressed by
+ * index, and references to transforms and materials stay valid until
+ * they are changed.
+ *
+ * Scene also keeps a list of objects emitting light, so that shading does
+ * not look through all objects for them. Objects and materials are only
+ * changed through scene methods, so the list never misses a change.
+ */
 class Scene
 {
 public:
-  static constexpr size_t MAX_OBJECTS = 16;
-
   Scene(const Camera&        camera,
         const Color&         ambientLight = Color::Black,
         const DirectedLight& directedLight = DirectedLight()) :
     m_camera(camera),
     m_ambientLight(ambientLight),
     m_directedLight(directedLight),
-    m_objects{},
-    m_objectCount(0)
+    m_types(),
+    m_transforms(),
+    m_materialIds(),
+    m_meshIds(),
+    m_materials(),
+    m_meshes(),
+    m_storage(),
+    m_lights(),
+    m_lightsOutdated(false)
   {
   }
   Scene(const Scene& other) = delete;
@@ -66,29 +107,245 @@ public:
     return m_directedLight.color != Color::Black;
   }
 
-  size_t objectCount() const { return m_objectCount; }
+  size_t objectCount() const { return m_types.size(); }
 
-  SceneObject& operator[](size_t index) { return m_objects[index]; }
+  ObjectType objectType(size_t index) const { return m_types[index]; }
 
-  const SceneObject& operator[](size_t index) const
+  const Transform& transform(size_t index) const { return m_transforms[index]; }
+
+  /**
+   * @brief Replace transform of object at `index`. Lights are updated
+   * before next call to `lights()`.
+   */
+  void setTransform(size_t index, const Transform& transform)
   {
-    return const_cast<Scene*>(this)->operator[](index);
+    m_transforms.set(index, transform);
+    m_lightsOutdated = true;
   }
 
-  void addObject(const SceneObject& object)
+  /**
+   * @brief Index of material used by object at `index`
+   */
+  uint32_t materialId(size_t index) const { return m_materialIds[index]; }
+
+  const Material& objectMaterial(size_t index) const
+  {
+    return m_materials[m_materialIds[index]];
+  }
+
+  size_t materialCount() const { return m_materials.size(); }
+
+  /**
+   * @brief Shared material, used by every object referring to it
+   */
+  const Material& material(size_t material_id) const
   {
-    if (m_objectCount >= MAX_OBJECTS)
-      return;
-    m_objects[m_objectCount++] = object;
+    return m_materials[material_id];
+  }
+
+  /**
+   * @brief Replace shared material, changing every object using it. Lights
+   * are updated before next call to `lights()`.
+   */
+  void setMaterial(size_t material_id, const Material& material)
+  {
+    m_materials.set(material_id, material);
+    m_lightsOutdated = true;
+  }
+
+  /**
+   * @brief Add material for objects to refer to
+   *
+   * @return Index of material
+   */
+  uint32_t addMaterial(const Material& material)
+  {
+    m_materials.push_back(material);
+    return uint32_t(m_materials.size() - 1);
+  }
+
+  /**
+   * @brief Index of mesh used by object at `index`, meaningful only for
+   * objects of type `Mesh`
+   */
+  uint32_t meshId(size_t index) const { return m_meshIds[index]; }
+
+  const Mesh& objectMesh(size_t index) const
+  {
+    return *m_meshes[m_meshIds[index]];
+  }
+
+  size_t meshCount() const { return m_meshes.size(); }
+
+  const Mesh& mesh(size_t mesh_id) const { return *m_meshes[mesh_id]; }
+
+  /**
+   * @brief Share `mesh` with scene, so that objects can refer to it. Mesh
+   * geometry is never copied, scene snapshots share it as well.
+   *
+   * @return Index of mesh, used by objects of type `Mesh`
+   */
+  uint32_t addMesh(std::shared_ptr<const Mesh> mesh)
+  {
+    m_meshes.push_back(std::move(mesh));
+    return uint32_t(m_meshes.size() - 1);
+  }
+
+  bool isLightSource(size_t index) const
+  {
+    return objectMaterial(index).hasGlow();
+  }
+
+  /**
+   * @brief Visible objects emitting light, in order of their indices.
+   * After objects or materials change, first call rebuilds the list by
+   * looking through all objects, so it must be made before the scene is
+   * shared between threads.
+   */
+  const std::vector<SceneLight>& lights() const
+  {
+    if (m_lightsOutdated)
+      updateLights();
+
+    return m_lights;
+  }
+
+  /**
+   * @brief Whether next call to `lights()` rebuilds the list
+   */
+  bool lightsOutdated() const { return m_lightsOutdated; }
+
+  Bounds bounds(size_t index) const
+  {
+    if (m_types[index] == ObjectType::Mesh)
+      return SceneObject::getBounds(m_types[index],
+                                    objectMaterial(index),
+                                    m_transforms[index],
+                                    objectMesh(index).bounds());
+
+    return SceneObject::getBounds(m_types[index],
+                                  objectMaterial(index),
+                                  m_transforms[index]);
+  }
+
+  /**
+   * @brief Replace contents with copy of `other`. Scenes are not copyable
+   * otherwise, so that a copy is always explicit.
+   *
+   * Objects and materials are shared in chunks until either scene changes
+   * them, so copying takes time per chunk, not per object. Both scenes can
+   * be read from any thread, but only the thread making copies may change
+   * them.
+   */
+  void assign(const Scene& other)
+  {
+    m_camera        = other.m_camera;
+    m_ambientLight  = other.m_ambientLight;
+    m_directedLight = other.m_directedLight;
+    m_types      .assign(other.m_types);
+    m_transforms .assign(other.m_transforms);
+    m_materialIds.assign(other.m_materialIds);
+    m_meshIds    .assign(other.m_meshIds);
+    m_materials  .assign(other.m_materials);
+    m_meshes = other.m_meshes;
+
+    // Shared chunks may still point into mapped file
+    m_storage = other.m_storage;
+
+    m_lights         = other.m_lights;
+    m_lightsOutdated = other.m_lightsOutdated;
+  }
+
+  /**
+   * @brief Append `count` objects stored field by field in `storage`, and
+   * `material_count` materials they use, without copying them. Scene and
+   * its copies keep `storage` mapped. Objects and materials can be changed,
+   * but the file stays unchanged. Meshes referred to by
+   * `mesh_ids` must be added beforehand.
+   *
+   * @return `false` if scene already has objects or materials
+   */
+  bool adoptObjects(std::unique_ptr<MappedFile> storage,
+                    ObjectType* types, Transform* transforms,
+                    uint32_t* material_ids, uint32_t* mesh_ids, size_t count,
+                    Material* materials, size_t material_count)
+  {
+    if (objectCount() > 0 || materialCount() > 0)
+      return false;
+
+    m_types      .adopt(types,        count);
+    m_transforms .adopt(transforms,   count);
+    m_materialIds.adopt(material_ids, count);
+    m_meshIds    .adopt(mesh_ids,     count);
+    m_materials  .adopt(materials,    material_count);
+    m_storage = std::move(storage);
+    m_lightsOutdated = true;
+    return true;
+  }
+
+  /**
+   * @brief Add copy of `object` to scene. Material and mesh it refers to
+   * must be added beforehand.
+   *
+   * @return Index of added object
+   */
+  size_t addObject(const SceneObject& object)
+  {
+    m_types      .push_back(object.type());
+    m_transforms .push_back(object.transform());
+    m_materialIds.push_back(object.material());
+    m_meshIds    .push_back(object.mesh());
+    m_lightsOutdated = true;
+    return m_types.size() - 1;
   }
 
 private:
   Camera        m_camera;
   Color         m_ambientLight;
   DirectedLight m_directedLight;
-  // TODO: Turn into dynamic array
-  SceneObject   m_objects[MAX_OBJECTS];
-  size_t        m_objectCount;
+
+  // Hot data, read during intersection
+  ChunkedArray<ObjectType> m_types;
+  ChunkedArray<Transform>  m_transforms;
+
+  // Cold data, read during shading
+  ChunkedArray<uint32_t>   m_materialIds;
+
+  // Objects refer to shared meshes by index
+  ChunkedArray<uint32_t>   m_meshIds;
+
+  // Shared between objects
+  ChunkedArray<Material>                   m_materials;
+  std::vector<std::shared_ptr<const Mesh>> m_meshes;
+
+  // Mapped file holding adopted objects, if any, shared with copies
+  std::shared_ptr<MappedFile> m_storage;
+
+  // Derived from objects and materials when first needed
+  mutable std::vector<SceneLight> m_lights;
+  mutable bool                    m_lightsOutdated;
+
+  void updateLights() const
+  {
+    m_lights.clear();
+    for (size_t i = 0; i < objectCount(); ++i)
+    {
+      const Material& material = objectMaterial(i);
+
+      // Lights which cannot be hit give no light either
+      if (!material.hasGlow() || material.isHidden())
+        continue;
+
+      m_lights.push_back(SceneLight{
+        .object   = uint32_t(i),
+        .position = m_transforms[i].position(),
+        .bounds   = bounds(i),
+        .power    = material.glowColor()
+      });
+    }
+
+    m_lightsOutdated = false;
+  }
 };
 
 #endif /* scene.h */
@@ -0,0 +1,1045 @@
+#include "ray_trace/scene_file.h"
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "ray_trace/mapped_file.h"
+
+/**
+ * @brief Position in text being parsed
+ */
+struct TextCursor
+{
+  const char* path;
+  const char* pos;
+  size_t      line;
+};
+
+/**
+ * @brief Indices of scene materials defined by name so far
+ */
+using MaterialNames = std::unordered_map<std::string, uint32_t>;
+
+static bool readFile(const char* path, std::vector<char>& contents);
+static bool parseStatement(TextCursor& cursor, MaterialNames& names,
+                           Scene& scene);
+static void reportError(const TextCursor& cursor, const char* message);
+
+bool readSceneText(const char* path, Scene& scene)
+{
+  std::vector<char> contents;
+  if (!readFile(path, contents))
+  {
+    fprintf(stderr, "%s: cannot read file\n", path);
+    return false;
+  }
+
+  TextCursor cursor = {
+    .path = path,
+    .pos  = contents.data(),
+    .line = 1
+  };
+
+  MaterialNames names;
+  while (*cursor.pos != '\0')
+  {
+    if (!parseStatement(cursor, names, scene))
+      return false;
+  }
+
+  return true;
+}
+
+static bool readFile(const char* path, std::vector<char>& contents)
+{
+  FILE* file = fopen(path, "rb");
+  if (!file)
+    return false;
+
+  bool success = fseek(file, 0, SEEK_END) == 0;
+  const long size = success ? ftell(file) : -1;
+  success = size >= 0 && fseek(file, 0, SEEK_SET) == 0;
+
+  // Terminating zero stops parser at the end of file
+  if (success)
+  {
+    contents.assign(size_t(size) + 1, '\0');
+    success = fread(contents.data(), 1, size_t(size), file) == size_t(size);
+  }
+
+  fclose(file);
+  return success;
+}
+
+static void reportError(const TextCursor& cursor, const char* message)
+{
+  fprintf(stderr, "%s:%zu: %s\n", cursor.path, cursor.line, message);
+}
+
+static void skipSpaces(TextCursor& cursor)
+{
+  while (*cursor.pos == ' ' || *cursor.pos == '\t' || *cursor.pos == '\r')
+    ++cursor.pos;
+
+  if (*cursor.pos == '#')
+    while (*cursor.pos != '\n' && *cursor.pos != '\0')
+      ++cursor.pos;
+}
+
+static bool isLineEnd(TextCursor& cursor)
+{
+  skipSpaces(cursor);
+  return *cursor.pos == '\n' || *cursor.pos == '\0';
+}
+
+/**
+ * @brief Read next word of current line into `word`
+ *
+ * @return `false` at the end of line
+ */
+static bool readWord(TextCursor& cursor, std::string& word)
+{
+  if (isLineEnd(cursor))
+    return false;
+
+  const char* start = cursor.pos;
+  while (isalpha(*cursor.pos) || *cursor.pos == '_')
+    ++cursor.pos;
+
+  word.assign(start, cursor.pos);
+  return true;
+}
+
+/**
+ * @brief Read name made of letters, digits, `_` and `-` into `name`
+ */
+static bool readName(TextCursor& cursor, std::string& name)
+{
+  if (isLineEnd(cursor))
+  {
+    reportError(cursor, "name expected");
+    return false;
+  }
+
+  const char* start = cursor.pos;
+  while (isalnum(*cursor.pos) || *cursor.pos == '_' || *cursor.pos == '-')
+    ++cursor.pos;
+
+  if (cursor.pos == start)
+  {
+    reportError(cursor, "name expected");
+    return false;
+  }
+
+  name.assign(start, cursor.pos);
+  return true;
+}
+
+static bool readNumber(TextCursor& cursor, real& value)
+{
+  // Numbers never continue on next line
+  if (isLineEnd(cursor))
+  {
+    reportError(cursor, "number expected");
+    return false;
+  }
+
+  char* end = nullptr;
+  if (std::is_same<real, float>::value)
+    value = real(strtof(cursor.pos, &end));
+  else
+    value = real(strtod(cursor.pos, &end));
+
+  if (end == cursor.pos)
+  {
+    reportError(cursor, "number expected");
+    return false;
+  }
+
+  cursor.pos = end;
+  return true;
+}
+
+static bool readCount(TextCursor& cursor, uint32_t& value)
+{
+  if (isLineEnd(cursor))
+  {
+    reportError(cursor, "count expected");
+    return false;
+  }
+
+  char* end = nullptr;
+  const unsigned long count = strtoul(cursor.pos, &end, 10);
+
+  // Reserved value means no count at all
+  if (end == cursor.pos || *cursor.pos == '-' || count >= UINT32_MAX)
+  {
+    reportError(cursor, "count expected");
+    return false;
+  }
+
+  value      = uint32_t(count);
+  cursor.pos = end;
+  return true;
+}
+
+static bool readVec(TextCursor& cursor, Vec& vec)
+{
+  return readNumber(cursor, vec.m_x)
+      && readNumber(cursor, vec.m_y)
+      && readNumber(cursor, vec.m_z);
+}
+
+static bool readColor(TextCursor& cursor, Color& color)
+{
+  Vec channels(0, 0, 0);
+  if (!readVec(cursor, channels))
+    return false;
+
+  color = Color::fromNormalized(channels.m_x, channels.m_y, channels.m_z);
+  return true;
+}
+
+/**
+ * @brief Parts of transform described so far
+ */
+struct TransformSpec
+{
+  Point  position;
+  Vec    scale;
+  Matrix rotation;
+
+  TransformSpec() :
+    position(0, 0, 0), scale(1, 1, 1), rotation(Matrix::One)
+  {
+  }
+
+  Transform toTransform() const
+  {
+    return Transform(position, scale, rotation);
+  }
+};
+
+/**
+ * @brief Parse transform property named `word`, if it is one
+ *
+ * @return `false` if `word` is not a transform property or has errors,
+ * `is_valid` tells which
+ */
+static bool parseTransform(TextCursor& cursor, const std::string& word,
+                           TransformSpec& spec, bool& is_valid)
+{
+  is_valid = true;
+  if (word == "position")
+  {
+    is_valid = readVec(cursor, spec.position);
+    return is_valid;
+  }
+  if (word == "scale")
+  {
+    is_valid = readVec(cursor, spec.scale);
+    return is_valid;
+  }
+  if (word == "rotate")
+  {
+    Vec  axis(0, 0, 0);
+    real angle = 0;
+    is_valid = readVec(cursor, axis) && readNumber(cursor, angle);
+    if (is_valid && axis.isZero())
+    {
+      reportError(cursor, "rotation axis must be non-zero");
+      is_valid = false;
+    }
+
+    // Same composition as in `Transform::rotate`
+    if (is_valid)
+      spec.rotation = Matrix::fromRotation(axis.normalized(), angle)
+                    * spec.rotation;
+    return is_valid;
+  }
+  if (word == "rotation")
+  {
+    real coords[3][3] = {};
+    for (size_t i = 0; i < 3 && is_valid; ++i)
+      for (size_t j = 0; j < 3 && is_valid; ++j)
+        is_valid = readNumber(cursor, coords[i][j]);
+
+    if (is_valid)
+      spec.rotation = Matrix(coords);
+    return is_valid;
+  }
+
+  return false;
+}
+
+/**
+ * @brief Parts of material described so far
+ */
+struct MaterialSpec
+{
+  bool     isHidden;
+  bool     isGiven;
+  real     diffusion;
+  Color    color;
+  Color    glow;
+  uint32_t reflections;
+
+  MaterialSpec() :
+    isHidden(false), isGiven(false),
+    diffusion(1), color(Color::White), glow(Color::Black),
+    reflections(Material::DEFAULT_REFLECTIONS)
+  {
+  }
+
+  Material toMaterial() const
+  {
+    if (isHidden)
+      return Material();
+
+    Material material(diffusion, color, glow);
+    material.setMaxReflections(reflections);
+    return material;
+  }
+};
+
+/**
+ * @brief Parse material property named `word`, if it is one
+ *
+ * @return `false` if `word` is not a material property or has errors,
+ * `is_valid` tells which
+ */
+static bool parseMaterial(TextCursor& cursor, const std::string& word,
+                          MaterialSpec& spec, bool& is_valid)
+{
+  is_valid = true;
+  if (word == "hidden")
+    spec.isHidden = true;
+  else if (word == "diffusion")
+    is_valid = readNumber(cursor, spec.diffusion);
+  else if (word == "color")
+    is_valid = readColor(cursor, spec.color);
+  else if (word == "glow")
+    is_valid = readColor(cursor, spec.glow);
+  else if (word == "reflections")
+    is_valid = readCount(cursor, spec.reflections);
+  else
+    return false;
+
+  spec.isGiven = true;
+  return is_valid;
+}
+
+static bool parseMaterialDefinition(TextCursor& cursor, MaterialNames& names,
+                                    Scene& scene)
+{
+  std::string name;
+  if (!readName(cursor, name))
+    return false;
+
+  if (names.count(name) > 0)
+  {
+    reportError(cursor, "material is already defined");
+    return false;
+  }
+
+  MaterialSpec material;
+  std::string  word;
+  while (readWord(cursor, word))
+  {
+    bool is_valid = true;
+    if (parseMaterial(cursor, word, material, is_valid))
+      continue;
+    if (is_valid)
+      reportError(cursor, "unknown material property");
+    return false;
+  }
+
+  names[name] = scene.addMaterial(material.toMaterial());
+  return true;
+}
+
+static bool parseObject(TextCursor& cursor, const MaterialNames& names,
+                        ObjectType type, Scene& scene, uint32_t mesh = 0)
+{
+  TransformSpec transform;
+  MaterialSpec  material;
+  bool          is_named = false;
+  uint32_t      material_id = 0;
+
+  std::string word;
+  while (readWord(cursor, word))
+  {
+    bool is_valid = true;
+    if (parseTransform(cursor, word, transform, is_valid))
+      continue;
+    if (!is_valid)
+      return false;
+
+    if (parseMaterial(cursor, word, material, is_valid))
+      continue;
+    if (!is_valid)
+      return false;
+
+    if (word != "material")
+    {
+      reportError(cursor, "unknown object property");
+      return false;
+    }
+
+    std::string name;
+    if (!readName(cursor, name))
+      return false;
+
+    const MaterialNames::const_iterator found = names.find(name);
+    if (found == names.end())
+    {
+      reportError(cursor, "unknown material");
+      return false;
+    }
+    is_named    = true;
+    material_id = found->second;
+  }
+
+  if (is_named && material.isGiven)
+  {
+    reportError(cursor, "object has both named and own material");
+    return false;
+  }
+
+  // Objects with own properties get their own material
+  if (!is_named)
+    material_id = scene.addMaterial(material.toMaterial());
+
+  scene.addObject(SceneObject(type, material_id, transform.toTransform(),
+                              mesh));
+  return true;
+}
+
+/**
+ * @brief Read mesh file name, relative to directory of scene file, and
+ * find that mesh in `scene`, loading it if needed
+ */
+static bool readMesh(TextCursor& cursor, Scene& scene, uint32_t& mesh_id)
+{
+  if (isLineEnd(cursor))
+  {
+    reportError(cursor, "mesh file name expected");
+    return false;
+  }
+
+  const char* start = cursor.pos;
+  while (!isspace(*cursor.pos) && *cursor.pos != '\0')
+    ++cursor.pos;
+  std::string path(start, cursor.pos);
+
+  if (path[0] != '/')
+  {
+    const char* last_slash = strrchr(cursor.path, '/');
+    if (last_slash)
+      path.insert(0, cursor.path, size_t(last_slash - cursor.path) + 1);
+  }
+
+  char* absolute_path = realpath(path.c_str(), nullptr);
+  if (!absolute_path)
+  {
+    reportError(cursor, "mesh file not found");
+    return false;
+  }
+  path = absolute_path;
+  free(absolute_path);
+
+  // Objects sharing a mesh file share its geometry
+  for (size_t i = 0; i < scene.meshCount(); ++i)
+  {
+    if (scene.mesh(i).path() == path)
+    {
+      mesh_id = uint32_t(i);
+      return true;
+    }
+  }
+
+  std::shared_ptr<Mesh> mesh(new Mesh());
+  if (!mesh->loadObj(path.c_str()))
+  {
+    reportError(cursor, "cannot load mesh");
+    return false;
+  }
+
+  mesh_id = scene.addMesh(std::move(mesh));
+  return true;
+}
+
+static bool parseMesh(TextCursor& cursor, const MaterialNames& names,
+                      Scene& scene)
+{
+  uint32_t mesh_id = 0;
+  return readMesh(cursor, scene, mesh_id)
+      && parseObject(cursor, names, ObjectType::Mesh, scene, mesh_id);
+}
+
+static bool parseCamera(TextCursor& cursor, Scene& scene)
+{
+  TransformSpec transform;
+  real fov = real(scene.camera().fovDeg());
+
+  std::string word;
+  while (readWord(cursor, word))
+  {
+    bool is_valid = true;
+    if (parseTransform(cursor, word, transform, is_valid))
+      continue;
+    if (!is_valid)
+      return false;
+
+    if (word != "fov")
+    {
+      reportError(cursor, "unknown camera property");
+      return false;
+    }
+    if (!readNumber(cursor, fov))
+      return false;
+  }
+
+  scene.camera() = Camera(transform.toTransform(), fov);
+  return true;
+}
+
+static bool parseLight(TextCursor& cursor, Scene& scene)
+{
+  Vec   direction(0, 0, 0);
+  Color color = Color::White;
+
+  std::string word;
+  while (readWord(cursor, word))
+  {
+    bool is_valid = true;
+    if (word == "direction")
+      is_valid = readVec(cursor, direction);
+    else if (word == "color")
+      is_valid = readColor(cursor, color);
+    else
+    {
+      reportError(cursor, "unknown light property");
+      return false;
+    }
+
+    if (!is_valid)
+      return false;
+  }
+
+  if (direction.isZero())
+  {
+    reportError(cursor, "light direction must be non-zero");
+    return false;
+  }
+
+  scene.directedLight() = DirectedLight(direction, color);
+  return true;
+}
+
+static bool parseStatement(TextCursor& cursor, MaterialNames& names,
+                           Scene& scene)
+{
+  std::string keyword;
+  bool is_valid = true;
+  if (readWord(cursor, keyword))
+  {
+    if      (keyword == "sphere") is_valid = parseObject(cursor, names, ObjectType::Sphere, scene);
+    else if (keyword == "box")    is_valid = parseObject(cursor, names, ObjectType::Box,    scene);
+    else if (keyword == "plane")  is_valid = parseObject(cursor, names, ObjectType::Plane,  scene);
+    else if (keyword == "empty")  is_valid = parseObject(cursor, names, ObjectType::Empty,  scene);
+    else if (keyword == "mesh")   is_valid = parseMesh  (cursor, names, scene);
+    else if (keyword == "material")
+      is_valid = parseMaterialDefinition(cursor, names, scene);
+    else if (keyword == "camera") is_valid = parseCamera(cursor, scene);
+    else if (keyword == "light")  is_valid = parseLight (cursor, scene);
+    else if (keyword == "ambient")
+      is_valid = readColor(cursor, scene.ambientLight())
+              && isLineEnd(cursor);
+    else
+    {
+      reportError(cursor, "unknown statement");
+      return false;
+    }
+  }
+
+  if (!is_valid)
+    return false;
+
+  if (!isLineEnd(cursor))
+  {
+    reportError(cursor, "unexpected text at the end of line");
+    return false;
+  }
+
+  if (*cursor.pos == '\n')
+  {
+    ++cursor.pos;
+    ++cursor.line;
+  }
+  return true;
+}
+
+static const char* getTypeName(ObjectType type)
+{
+  switch (type)
+  {
+  case ObjectType::Sphere: return "sphere";
+  case ObjectType::Box:    return "box";
+  case ObjectType::Plane:  return "plane";
+  case ObjectType::Mesh:   return "mesh";
+  case ObjectType::Empty:
+  default:                 return "empty";
+  }
+}
+
+static void writeNumbers(FILE* file, const real* values, size_t count)
+{
+  constexpr int digits = std::numeric_limits<real>::max_digits10;
+  for (size_t i = 0; i < count; ++i)
+    fprintf(file, " %.*g", digits, double(values[i]));
+}
+
+static void writeVec(FILE* file, const char* name, const Vec& vec)
+{
+  const real values[] = { vec.m_x, vec.m_y, vec.m_z };
+  fprintf(file, " %s", name);
+  writeNumbers(file, values, 3);
+}
+
+static void writeColorValues(FILE* file, const Color& color)
+{
+  const real values[] = {
+    color.redNormalized(), color.greenNormalized(), color.blueNormalized()
+  };
+  writeNumbers(file, values, 3);
+}
+
+static void writeColor(FILE* file, const char* name, const Color& color)
+{
+  fprintf(file, " %s", name);
+  writeColorValues(file, color);
+}
+
+static void writeTransform(FILE* file, const Transform& transform)
+{
+  writeVec(file, "position", transform.position());
+  writeVec(file, "scale",    transform.scale());
+
+  const Matrix& rotation = transform.rotation();
+  fprintf(file, " rotation");
+  for (size_t i = 0; i < 3; ++i)
+    writeNumbers(file, rotation[i], 3);
+}
+
+static void writeMaterial(FILE* file, const Material& material)
+{
+  if (material.isHidden())
+  {
+    fprintf(file, " hidden");
+    return;
+  }
+
+  const real diffusion = real(material.diffusion());
+  fprintf(file, " diffusion");
+  writeNumbers(file, &diffusion, 1);
+  writeColor(file, "color", material.color());
+  if (material.hasGlow())
+    writeColor(file, "glow", material.glowColor());
+  if (material.hasReflectionLimit())
+    fprintf(file, " reflections %u", material.maxReflections());
+}
+
+bool writeSceneText(const char* path, const Scene& scene)
+{
+  FILE* file = fopen(path, "w");
+  if (!file)
+    return false;
+
+  const real fov = real(scene.camera().fovDeg());
+  fprintf(file, "camera");
+  writeTransform(file, scene.camera().transform());
+  fprintf(file, " fov");
+  writeNumbers(file, &fov, 1);
+
+  fprintf(file, "\nambient");
+  writeColorValues(file, scene.ambientLight());
+
+  fprintf(file, "\nlight");
+  writeVec  (file, "direction", scene.directedLight().direction);
+  writeColor(file, "color",     scene.directedLight().color);
+  fprintf(file, "\n");
+
+  // Objects refer to materials by their indices
+  for (size_t i = 0; i < scene.materialCount(); ++i)
+  {
+    fprintf(file, "material m%zu", i);
+    writeMaterial(file, scene.material(i));
+    fprintf(file, "\n");
+  }
+
+  bool success = true;
+  for (size_t i = 0; i < scene.objectCount() && success; ++i)
+  {
+    fprintf(file, "%s", getTypeName(scene.objectType(i)));
+
+    // Meshes created in memory cannot be referred to
+    if (scene.objectType(i) == ObjectType::Mesh)
+    {
+      const std::string& mesh_path = scene.objectMesh(i).path();
+      success = !mesh_path.empty();
+      fprintf(file, " %s", mesh_path.c_str());
+    }
+
+    writeTransform(file, scene.transform(i));
+    fprintf(file, " material m%u\n", scene.materialId(i));
+  }
+
+  success = success && !ferror(file);
+  return fclose(file) == 0 && success;
+}
+
+/**
+ * @brief Whether compiled scenes are written and mapped. Checked math
+ * gives vectors destructors, so math types are no longer plain bytes and
+ * such builds always parse text.
+ */
+#ifdef RAY_TRACE_CHECKED_MATH
+static constexpr bool COMPILED_SCENES = false;
+#else
+static constexpr bool COMPILED_SCENES = true;
+#endif
+
+static_assert(!COMPILED_SCENES
+           || (std::is_trivially_copyable<Transform>::value
+            && std::is_trivially_copyable<Material>::value
+            && std::is_trivially_copyable<Camera>::value
+            && std::is_trivially_copyable<DirectedLight>::value),
+              "Compiled scene stores objects as raw bytes");
+
+/**
+ * @brief Start of compiled scene file. Object arrays and shared materials
+ * follow it at offsets aligned to `COMPILED_ALIGNMENT`, then paths of mesh
+ * files, each ending with zero byte. Meshes are loaded from their files on
+ * every load.
+ */
+struct CompiledSceneHeader
+{
+  char          magic[8];
+  uint32_t      version;
+  uint32_t      realSize;
+  uint32_t      transformSize;
+  uint32_t      materialSize;
+  uint64_t      objectCount;
+  uint64_t      typesOffset;
+  uint64_t      transformsOffset;
+  uint64_t      materialIdsOffset;
+  uint64_t      meshIdsOffset;
+  uint64_t      materialCount;
+  uint64_t      materialsOffset;
+  uint64_t      meshCount;
+  uint64_t      meshPathsOffset;
+  uint64_t      meshPathsSize;
+  Camera        camera;
+  Color         ambientLight;
+  DirectedLight directedLight;
+};
+
+static const char     COMPILED_MAGIC[8]  = "RTSCENE";
+static const uint32_t COMPILED_VERSION   = 4;
+static const uint64_t COMPILED_ALIGNMENT = 64;
+
+static uint64_t alignOffset(uint64_t offset)
+{
+  return (offset + COMPILED_ALIGNMENT - 1) / COMPILED_ALIGNMENT
+                                          * COMPILED_ALIGNMENT;
+}
+
+static bool writePadding(FILE* file, uint64_t size)
+{
+  static const char zeros[COMPILED_ALIGNMENT] = {};
+  return fwrite(zeros, 1, size, file) == size;
+}
+
+bool writeCompiledScene(const char* path, const Scene& scene)
+{
+  if (!COMPILED_SCENES)
+    return false;
+
+  // Meshes created in memory cannot be referred to
+  uint64_t mesh_paths_size = 0;
+  for (size_t i = 0; i < scene.meshCount(); ++i)
+  {
+    if (scene.mesh(i).path().empty())
+      return false;
+    mesh_paths_size += scene.mesh(i).path().size() + 1;
+  }
+
+  const uint64_t count          = scene.objectCount();
+  const uint64_t material_count = scene.materialCount();
+  const uint64_t types_offset = alignOffset(sizeof(CompiledSceneHeader));
+  const uint64_t transforms_offset =
+                         alignOffset(types_offset + count * sizeof(ObjectType));
+  const uint64_t material_ids_offset =
+                   alignOffset(transforms_offset + count * sizeof(Transform));
+  const uint64_t mesh_ids_offset =
+                   alignOffset(material_ids_offset + count * sizeof(uint32_t));
+  const uint64_t materials_offset =
+                   alignOffset(mesh_ids_offset + count * sizeof(uint32_t));
+  const uint64_t mesh_paths_offset =
+            alignOffset(materials_offset + material_count * sizeof(Material));
+
+  CompiledSceneHeader header = {
+    .magic            = {},
+    .version          = COMPILED_VERSION,
+    .realSize         = sizeof(real),
+    .transformSize    = sizeof(Transform),
+    .materialSize     = sizeof(Material),
+    .objectCount      = count,
+    .typesOffset      = types_offset,
+    .transformsOffset  = transforms_offset,
+    .materialIdsOffset = material_ids_offset,
+    .meshIdsOffset     = mesh_ids_offset,
+    .materialCount     = material_count,
+    .materialsOffset   = materials_offset,
+    .meshCount         = scene.meshCount(),
+    .meshPathsOffset   = mesh_paths_offset,
+    .meshPathsSize     = mesh_paths_size,
+    .camera            = scene.camera(),
+    .ambientLight      = scene.ambientLight(),
+    .directedLight     = scene.directedLight()
+  };
+  memcpy(header.magic, COMPILED_MAGIC, sizeof(COMPILED_MAGIC));
+
+  // Readers never see partially written file under `path`
+  const std::string temp_path = std::string(path) + ".tmp";
+  FILE* file = fopen(temp_path.c_str(), "wb");
+  if (!file)
+    return false;
+
+  bool success = fwrite(&header, sizeof(header), 1, file) == 1
+              && writePadding(file, types_offset - sizeof(header));
+
+  for (size_t i = 0; i < count && success; ++i)
+  {
+    const ObjectType type = scene.objectType(i);
+    success = fwrite(&type, sizeof(type), 1, file) == 1;
+  }
+  success = success && writePadding(file, transforms_offset
+                                         - types_offset
+                                         - count * sizeof(ObjectType));
+
+  for (size_t i = 0; i < count && success; ++i)
+    success = fwrite(&scene.transform(i), sizeof(Transform), 1, file) == 1;
+  success = success && writePadding(file, material_ids_offset
+                                         - transforms_offset
+                                         - count * sizeof(Transform));
+
+  for (size_t i = 0; i < count && success; ++i)
+  {
+    const uint32_t material_id = scene.materialId(i);
+    success = fwrite(&material_id, sizeof(material_id), 1, file) == 1;
+  }
+  success = success && writePadding(file, mesh_ids_offset
+                                         - material_ids_offset
+                                         - count * sizeof(uint32_t));
+
+  for (size_t i = 0; i < count && success; ++i)
+  {
+    const uint32_t mesh_id = scene.meshId(i);
+    success = fwrite(&mesh_id, sizeof(mesh_id), 1, file) == 1;
+  }
+  success = success && writePadding(file, materials_offset
+                                         - mesh_ids_offset
+                                         - count * sizeof(uint32_t));
+
+  for (size_t i = 0; i < material_count && success; ++i)
+    success = fwrite(&scene.material(i), sizeof(Material), 1, file) == 1;
+  success = success && writePadding(file, mesh_paths_offset
+                                         - materials_offset
+                                         - material_count * sizeof(Material));
+
+  for (size_t i = 0; i < scene.meshCount() && success; ++i)
+  {
+    const std::string& mesh_path = scene.mesh(i).path();
+    success = fwrite(mesh_path.c_str(), 1, mesh_path.size() + 1, file)
+           == mesh_path.size() + 1;
+  }
+
+  success = fclose(file) == 0 && success;
+  if (success)
+    success = rename(temp_path.c_str(), path) == 0;
+
+  if (!success)
+    remove(temp_path.c_str());
+  return success;
+}
+
+/**
+ * @brief Check that array of `count` elements of `size` bytes at `offset`
+ * lies within file of `file_size` bytes and is aligned
+ */
+static bool isValidArray(uint64_t offset, uint64_t count, uint64_t size,
+                         uint64_t file_size)
+{
+  return offset % COMPILED_ALIGNMENT == 0
+      && offset <= file_size
+      && count <= (file_size - offset) / size;
+}
+
+/**
+ * @brief Check that `count` objects refer only to existing materials and
+ * meshes and have known types, so that stale or corrupted file falls
+ * back to text parser instead of breaking renderer
+ */
+static bool isValidObjects(const CompiledSceneHeader& header,
+                           const ObjectType* types,
+                           const uint32_t* material_ids,
+                           const uint32_t* mesh_ids, uint64_t count)
+{
+  for (uint64_t i = 0; i < count; ++i)
+  {
+    if (unsigned(types[i]) > unsigned(ObjectType::Mesh)
+     || material_ids[i] >= header.materialCount)
+      return false;
+
+    if (types[i] == ObjectType::Mesh && mesh_ids[i] >= header.meshCount)
+      return false;
+  }
+
+  return true;
+}
+
+bool mapCompiledScene(const char* path, Scene& scene)
+{
+  if (!COMPILED_SCENES)
+    return false;
+
+  if (scene.objectCount() > 0 || scene.materialCount() > 0
+   || scene.meshCount() > 0)
+    return false;
+
+  std::unique_ptr<MappedFile> file(new MappedFile());
+  if (!file->open(path) || file->size() < sizeof(CompiledSceneHeader))
+    return false;
+
+  const CompiledSceneHeader* header =
+                reinterpret_cast<const CompiledSceneHeader*>(file->data());
+
+  const uint64_t count = header->objectCount;
+  const bool is_valid =
+       memcmp(header->magic, COMPILED_MAGIC, sizeof(COMPILED_MAGIC)) == 0
+    && header->version       == COMPILED_VERSION
+    && header->realSize      == sizeof(real)
+    && header->transformSize == sizeof(Transform)
+    && header->materialSize  == sizeof(Material)
+    && isValidArray(header->typesOffset,      count,
+                    sizeof(ObjectType), file->size())
+    && isValidArray(header->transformsOffset,  count,
+                    sizeof(Transform),  file->size())
+    && isValidArray(header->materialIdsOffset, count,
+                    sizeof(uint32_t),   file->size())
+    && isValidArray(header->meshIdsOffset,     count,
+                    sizeof(uint32_t),   file->size())
+    && isValidArray(header->materialsOffset,   header->materialCount,
+                    sizeof(Material),   file->size())
+    && isValidArray(header->meshPathsOffset,   header->meshPathsSize,
+                    1,                  file->size());
+
+  if (!is_valid)
+    return false;
+
+  char* data = file->data();
+  ObjectType* types        =
+            reinterpret_cast<ObjectType*>(data + header->typesOffset);
+  Transform*  transforms   =
+            reinterpret_cast<Transform*> (data + header->transformsOffset);
+  uint32_t*   material_ids =
+            reinterpret_cast<uint32_t*>  (data + header->materialIdsOffset);
+  uint32_t*   mesh_ids     =
+            reinterpret_cast<uint32_t*>  (data + header->meshIdsOffset);
+  Material*   materials    =
+            reinterpret_cast<Material*>  (data + header->materialsOffset);
+
+  if (!isValidObjects(*header, types, material_ids, mesh_ids, count))
+    return false;
+
+  // Load meshes before touching scene, so that it stays empty on failure
+  std::vector<std::shared_ptr<const Mesh>> meshes;
+  const char* mesh_path = file->data() + header->meshPathsOffset;
+  const char* paths_end = mesh_path + header->meshPathsSize;
+  for (uint64_t i = 0; i < header->meshCount; ++i)
+  {
+    const char* path_end = static_cast<const char*>(
+                  memchr(mesh_path, '\0', size_t(paths_end - mesh_path)));
+    if (!path_end)
+      return false;
+
+    std::shared_ptr<Mesh> mesh(new Mesh());
+    if (!mesh->loadObj(mesh_path))
+      return false;
+
+    meshes.push_back(std::move(mesh));
+    mesh_path = path_end + 1;
+  }
+
+  // Paths must list exactly the meshes objects refer to
+  if (mesh_path != paths_end)
+    return false;
+
+  for (std::shared_ptr<const Mesh>& mesh : meshes)
+    scene.addMesh(std::move(mesh));
+
+  scene.camera()        = header->camera;
+  scene.ambientLight()  = header->ambientLight;
+  scene.directedLight() = header->directedLight;
+
+  return scene.adoptObjects(std::move(file), types, transforms, material_ids,
+                            mesh_ids, count, materials,
+                            header->materialCount);
+}
+
+/**
+ * @brief Whether file at `path` was modified no earlier than `other`
+ */
+static bool isUpToDate(const char* path, const char* other)
+{
+  struct stat path_stat  = {};
+  struct stat other_stat = {};
+  if (stat(path, &path_stat) != 0 || stat(other, &other_stat) != 0)
+    return false;
+
+  const timespec& path_time  = path_stat.st_mtim;
+  const timespec& other_time = other_stat.st_mtim;
+  if (path_time.tv_sec != other_time.tv_sec)
+    return path_time.tv_sec > other_time.tv_sec;
+  return path_time.tv_nsec >= other_time.tv_nsec;
+}
+
+bool loadScene(const char* path, Scene& scene)
+{
+  if (mapCompiledScene(path, scene))
+    return true;
+
+  const std::string cache_path = std::string(path) + ".bin";
+  if (isUpToDate(cache_path.c_str(), path)
+      && mapCompiledScene(cache_path.c_str(), scene))
+    return true;
+
+  if (!readSceneText(path, scene))
+    return false;
+
+  // Cache only speeds up later loads, scene is fine without it
+  writeCompiledScene(cache_path.c_str(), scene);
+  return true;
+}
@@ -0,0 +1,94 @@
+/**
+ * @file scene_file.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Loading scenes from text files and their compiled binary form
+ *
+ * @version 0.1
+ * @date 2023-09-29
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __RAY_TRACE_SCENE_FILE_H
+#define __RAY_TRACE_SCENE_FILE_H
+
+#include "ray_trace/scene.h"
+
+/*
+ * Text scene format. One statement per line, `#` starts a comment:
+ *
+ *   camera   [TRANSFORM] [fov DEGREES]
+ *   ambient  R G B
+ *   light    direction X Y Z [color R G B]
+ *   material NAME MATERIAL
+ *   sphere | box | plane | empty  [TRANSFORM] [MATERIAL | material NAME]
+ *   mesh     FILE.obj [TRANSFORM] [MATERIAL | material NAME]
+ *
+ * where
+ *
+ *   TRANSFORM := [position X Y Z] [scale X Y Z]
+ *                [rotate AXIS_X AXIS_Y AXIS_Z DEGREES]...
+ *                [rotation M00 M01 M02 M10 M11 M12 M20 M21 M22]
+ *   MATERIAL  := hidden | [diffusion D] [color R G B] [glow R G B]
+ *                [reflections COUNT]
+ *
+ * Rotations apply in order of appearance, `rotation` replaces everything
+ * before it. Objects are white and fully diffuse by default. Colors are
+ * normalized, 1 is full intensity. `reflections` overrides renderer's
+ * limit on reflections for rays bouncing off the material. Named
+ * materials must be defined before use, all objects referring to one name
+ * share that material; objects with their own material properties get a
+ * material each. Mesh files are looked up relative to scene file, objects
+ * using the same file share its geometry.
+ *
+ * Compiled scene is a header followed by object types, transforms,
+ * material and mesh indices and shared materials stored exactly as in
+ * memory. It is only valid for the build which produced it: same
+ * precision, same layout of math types. Meshes are not compiled, only
+ * their absolute paths are stored.
+ */
+
+/**
+ * @brief Add objects, camera and lights described in text file at `path`
+ * to `scene`. Errors are reported to stderr with line numbers.
+ *
+ * @return `false` if file could not be read or has errors
+ */
+bool readSceneText(const char* path, Scene& scene);
+
+/**
+ * @brief Write `scene` in text format. Numbers are written with enough
+ * digits to be read back exactly.
+ *
+ * @return `false` if file could not be written or scene uses meshes which
+ * were not loaded from files
+ */
+bool writeSceneText(const char* path, const Scene& scene);
+
+/**
+ * @brief Write `scene` in compiled form
+ *
+ * @return `false` if file could not be written, scene uses meshes which
+ * were not loaded from files or build has `RAY_TRACE_CHECKED_MATH`, whose
+ * math types cannot be stored as raw bytes
+ */
+bool writeCompiledScene(const char* path, const Scene& scene);
+
+/**
+ * @brief Map compiled scene at `path` into memory and use its objects in
+ * place, without parsing or copying them. `scene` must have no objects
+ * and no meshes.
+ *
+ * @return `false` if file is not a compiled scene of this build, always
+ * with `RAY_TRACE_CHECKED_MATH`
+ */
+bool mapCompiledScene(const char* path, Scene& scene);
+
+/**
+ * @brief Load text or compiled scene at `path` into empty `scene`. Text
+ * scene is compiled to `path` + ".bin" on first load, later loads map
+ * that cache while it is newer than the text.
+ */
+bool loadScene(const char* path, Scene& scene);
+
+#endif /* scene_file.h */
@@ -12,6 +12,10 @@
 #ifndef __RAY_TRACE_SCENE_OBJECT_H
 #define __RAY_TRACE_SCENE_OBJECT_H
 
+#include <cmath>
+#include <cstdint>
+
+#include "ray_trace/bounds.h"
 #include "ray_trace/material.h"
 #include "ray_trace/transform.h"
 
@@ -20,24 +24,38 @@ enum class ObjectType
   Empty,
   Sphere,
   Box,
-  Plane
+  Plane,
+  Mesh
 };
 
+/**
+ * @brief Instance of shared geometry: places primitive of given type, or
+ * scene mesh, with its own transform and refers to shared scene material.
+ * Instances are small, so many copies of one mesh cost little memory.
+ */
 class SceneObject
 {
 public:
   SceneObject() :
     m_type(ObjectType::Empty),
-    m_material(),
-    m_transform()
+    m_transform(),
+    m_material(0),
+    m_mesh(0)
   {
   }
+  /**
+   * @brief Create object of given `type` using scene material with index
+   * `material`. Objects of type `Mesh` refer to scene mesh by its index
+   * `mesh`, other types ignore it.
+   */
   SceneObject(ObjectType       type,
-              const Material&  material = Material(),
-              const Transform& transform = Transform()) :
+              uint32_t         material,
+              const Transform& transform = Transform(),
+              uint32_t         mesh = 0) :
     m_type(type),
+    m_transform(transform),
     m_material(material),
-    m_transform(transform)
+    m_mesh(mesh)
   {
   }
 
@@ -47,18 +65,81 @@ public:
   ~SceneObject() = default;
 
   ObjectType       type()      const { return m_type; }
-  const Material&  material()  const { return m_material; }
-        Material&  material()        { return m_material; }
   const Transform& transform() const { return m_transform; }
         Transform& transform()       { return m_transform; }
+  uint32_t         material()  const { return m_material; }
+  uint32_t         mesh()      const { return m_mesh; }
+
+  /**
+   * @brief World-space bounding box of object. Infinite for planes, empty
+   * for objects which cannot be hit. Meshes are bounded by `mesh_bounds`,
+   * their object-space bounds.
+   */
+  static Bounds getBounds(ObjectType       type,
+                          const Material&  material,
+                          const Transform& transform,
+                          const Bounds&    mesh_bounds = Bounds())
+  {
+    if (material.isHidden())
+      return Bounds();
+
+    // Columns of object-to-world matrix are rotated and scaled unit axes
+    const Matrix& matrix = transform.matrix();
+    double extent[3] = { 0, 0, 0 };
 
+    switch (type)
+    {
+    case ObjectType::Sphere:
+      // Unit sphere stretches by the length of each row
+      for (size_t i = 0; i < 3; ++i)
+        extent[i] = sqrt(matrix[i][0] * matrix[i][0]
+                       + matrix[i][1] * matrix[i][1]
+                       + matrix[i][2] * matrix[i][2]);
+      break;
+    case ObjectType::Box:
+      return getBoxBounds(transform, Point(0, 0, 0), Vec(1, 1, 1));
+    case ObjectType::Mesh:
+      if (mesh_bounds.isEmpty())
+        return Bounds();
+      return getBoxBounds(transform, mesh_bounds.centroid(),
+                          mesh_bounds.extent() * 0.5);
+    case ObjectType::Plane:
+      return Bounds::infinite();
 
-  bool isLightSource() const { return m_material.hasGlow(); }
+    case ObjectType::Empty:
+    default:
+      return Bounds();
+    }
+
+    return Bounds::fromCenter(transform.position(),
+                              Vec(extent[0], extent[1], extent[2]));
+  }
 
 private:
   ObjectType m_type;
-  Material   m_material;
   Transform  m_transform;
+  uint32_t   m_material;
+  uint32_t   m_mesh;
+
+  /**
+   * @brief World-space bounds of object-space box at `center`
+   */
+  static Bounds getBoxBounds(const Transform& transform,
+                             const Point& center, const Vec& half_extent)
+  {
+    // Box stretches by the sum of absolute values in each row
+    const Matrix& matrix = transform.matrix();
+    const double  half[3] = { half_extent.m_x, half_extent.m_y,
+                              half_extent.m_z };
+    double extent[3] = { 0, 0, 0 };
+    for (size_t i = 0; i < 3; ++i)
+      extent[i] = fabs(matrix[i][0]) * half[0]
+                + fabs(matrix[i][1]) * half[1]
+                + fabs(matrix[i][2]) * half[2];
+
+    return Bounds::fromCenter(transform.toWorld(center),
+                              Vec(extent[0], extent[1], extent[2]));
+  }
 };
 
 #endif /* scene_object.h */
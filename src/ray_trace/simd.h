@@ -0,0 +1,553 @@
+/**
+ * @file simd.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Eight floating-point lanes processed together
+ *
+ * @version 0.1
+ * @date 2023-09-24
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __RAY_TRACE_SIMD_H
+#define __RAY_TRACE_SIMD_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "ray_trace/real.h"
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief Bit `i` is set if lane `i` is active
+ */
+using LaneMask = uint32_t;
+
+/**
+ * @brief Eight doubles. Uses one AVX-512 register if available, two AVX2
+ * registers otherwise, and falls back to plain arrays without either.
+ */
+class Double8
+{
+public:
+  static constexpr size_t   SIZE     = 8;
+  static constexpr LaneMask ALL_MASK = (1u << SIZE) - 1;
+
+#if defined(__AVX512F__)
+
+  Double8()              : m_value(_mm512_setzero_pd())  {}
+  Double8(double value)  : m_value(_mm512_set1_pd(value)) {}
+
+  static Double8 load(const double* data)
+  {
+    return Double8(_mm512_loadu_pd(data));
+  }
+  void store(double* data) const { _mm512_storeu_pd(data, m_value); }
+
+  Double8 operator+(const Double8& other) const
+  {
+    return Double8(_mm512_add_pd(m_value, other.m_value));
+  }
+  Double8 operator-(const Double8& other) const
+  {
+    return Double8(_mm512_sub_pd(m_value, other.m_value));
+  }
+  Double8 operator*(const Double8& other) const
+  {
+    return Double8(_mm512_mul_pd(m_value, other.m_value));
+  }
+  Double8 operator/(const Double8& other) const
+  {
+    return Double8(_mm512_div_pd(m_value, other.m_value));
+  }
+  Double8 operator-() const { return Double8(0.0) - *this; }
+
+  LaneMask operator< (const Double8& other) const
+  {
+    return _mm512_cmp_pd_mask(m_value, other.m_value, _CMP_LT_OQ);
+  }
+  LaneMask operator<=(const Double8& other) const
+  {
+    return _mm512_cmp_pd_mask(m_value, other.m_value, _CMP_LE_OQ);
+  }
+  LaneMask operator> (const Double8& other) const { return other <  *this; }
+  LaneMask operator>=(const Double8& other) const { return other <= *this; }
+
+  friend Double8 sqrt(const Double8& value)
+  {
+    return Double8(_mm512_sqrt_pd(value.m_value));
+  }
+  friend Double8 min(const Double8& lhs, const Double8& rhs)
+  {
+    return Double8(_mm512_min_pd(lhs.m_value, rhs.m_value));
+  }
+  friend Double8 max(const Double8& lhs, const Double8& rhs)
+  {
+    return Double8(_mm512_max_pd(lhs.m_value, rhs.m_value));
+  }
+
+  /**
+   * @brief Take lanes of `if_set` where `mask` is set, `if_unset` elsewhere
+   */
+  friend Double8 select(LaneMask mask,
+                        const Double8& if_set, const Double8& if_unset)
+  {
+    return Double8(_mm512_mask_blend_pd(__mmask8(mask),
+                                        if_unset.m_value, if_set.m_value));
+  }
+
+private:
+  __m512d m_value;
+
+  explicit Double8(__m512d value) : m_value(value) {}
+
+#elif defined(__AVX2__)
+
+  Double8()             : m_low(_mm256_setzero_pd()), m_high(_mm256_setzero_pd()) {}
+  Double8(double value) : m_low(_mm256_set1_pd(value)), m_high(m_low) {}
+
+  static Double8 load(const double* data)
+  {
+    return Double8(_mm256_loadu_pd(data), _mm256_loadu_pd(data + 4));
+  }
+  void store(double* data) const
+  {
+    _mm256_storeu_pd(data,     m_low);
+    _mm256_storeu_pd(data + 4, m_high);
+  }
+
+  Double8 operator+(const Double8& other) const
+  {
+    return Double8(_mm256_add_pd(m_low,  other.m_low),
+                   _mm256_add_pd(m_high, other.m_high));
+  }
+  Double8 operator-(const Double8& other) const
+  {
+    return Double8(_mm256_sub_pd(m_low,  other.m_low),
+                   _mm256_sub_pd(m_high, other.m_high));
+  }
+  Double8 operator*(const Double8& other) const
+  {
+    return Double8(_mm256_mul_pd(m_low,  other.m_low),
+                   _mm256_mul_pd(m_high, other.m_high));
+  }
+  Double8 operator/(const Double8& other) const
+  {
+    return Double8(_mm256_div_pd(m_low,  other.m_low),
+                   _mm256_div_pd(m_high, other.m_high));
+  }
+  Double8 operator-() const { return Double8(0.0) - *this; }
+
+  LaneMask operator< (const Double8& other) const
+  {
+    return toMask(_mm256_cmp_pd(m_low,  other.m_low,  _CMP_LT_OQ),
+                  _mm256_cmp_pd(m_high, other.m_high, _CMP_LT_OQ));
+  }
+  LaneMask operator<=(const Double8& other) const
+  {
+    return toMask(_mm256_cmp_pd(m_low,  other.m_low,  _CMP_LE_OQ),
+                  _mm256_cmp_pd(m_high, other.m_high, _CMP_LE_OQ));
+  }
+  LaneMask operator> (const Double8& other) const { return other <  *this; }
+  LaneMask operator>=(const Double8& other) const { return other <= *this; }
+
+  friend Double8 sqrt(const Double8& value)
+  {
+    return Double8(_mm256_sqrt_pd(value.m_low), _mm256_sqrt_pd(value.m_high));
+  }
+  friend Double8 min(const Double8& lhs, const Double8& rhs)
+  {
+    return Double8(_mm256_min_pd(lhs.m_low,  rhs.m_low),
+                   _mm256_min_pd(lhs.m_high, rhs.m_high));
+  }
+  friend Double8 max(const Double8& lhs, const Double8& rhs)
+  {
+    return Double8(_mm256_max_pd(lhs.m_low,  rhs.m_low),
+                   _mm256_max_pd(lhs.m_high, rhs.m_high));
+  }
+
+  friend Double8 select(LaneMask mask,
+                        const Double8& if_set, const Double8& if_unset)
+  {
+    return Double8(
+      _mm256_blendv_pd(if_unset.m_low,  if_set.m_low,  fromMask(mask)),
+      _mm256_blendv_pd(if_unset.m_high, if_set.m_high, fromMask(mask >> 4)));
+  }
+
+private:
+  __m256d m_low;
+  __m256d m_high;
+
+  Double8(__m256d low, __m256d high) : m_low(low), m_high(high) {}
+
+  static LaneMask toMask(__m256d low, __m256d high)
+  {
+    return LaneMask(_mm256_movemask_pd(low))
+         | LaneMask(_mm256_movemask_pd(high)) << 4;
+  }
+
+  static __m256d fromMask(LaneMask mask)
+  {
+    const __m256i bits = _mm256_and_si256(_mm256_set1_epi64x(mask),
+                                          _mm256_set_epi64x(8, 4, 2, 1));
+    return _mm256_castsi256_pd(
+             _mm256_cmpgt_epi64(bits, _mm256_setzero_si256()));
+  }
+
+#else
+
+  Double8() : m_lanes{} {}
+  Double8(double value) : m_lanes{}
+  {
+    for (size_t i = 0; i < SIZE; ++i)
+      m_lanes[i] = value;
+  }
+
+  static Double8 load(const double* data)
+  {
+    Double8 result;
+    for (size_t i = 0; i < SIZE; ++i)
+      result.m_lanes[i] = data[i];
+    return result;
+  }
+  void store(double* data) const
+  {
+    for (size_t i = 0; i < SIZE; ++i)
+      data[i] = m_lanes[i];
+  }
+
+  Double8 operator+(const Double8& other) const
+  {
+    Double8 result;
+    for (size_t i = 0; i < SIZE; ++i)
+      result.m_lanes[i] = m_lanes[i] + other.m_lanes[i];
+    return result;
+  }
+  Double8 operator-(const Double8& other) const
+  {
+    Double8 result;
+    for (size_t i = 0; i < SIZE; ++i)
+      result.m_lanes[i] = m_lanes[i] - other.m_lanes[i];
+    return result;
+  }
+  Double8 operator*(const Double8& other) const
+  {
+    Double8 result;
+    for (size_t i = 0; i < SIZE; ++i)
+      result.m_lanes[i] = m_lanes[i] * other.m_lanes[i];
+    return result;
+  }
+  Double8 operator/(const Double8& other) const
+  {
+    Double8 result;
+    for (size_t i = 0; i < SIZE; ++i)
+      result.m_lanes[i] = m_lanes[i] / other.m_lanes[i];
+    return result;
+  }
+  Double8 operator-() const { return Double8(0.0) - *this; }
+
+  LaneMask operator< (const Double8& other) const
+  {
+    LaneMask mask = 0;
+    for (size_t i = 0; i < SIZE; ++i)
+      mask |= LaneMask(m_lanes[i] < other.m_lanes[i]) << i;
+    return mask;
+  }
+  LaneMask operator<=(const Double8& other) const
+  {
+    LaneMask mask = 0;
+    for (size_t i = 0; i < SIZE; ++i)
+      mask |= LaneMask(m_lanes[i] <= other.m_lanes[i]) << i;
+    return mask;
+  }
+  LaneMask operator> (const Double8& other) const { return other <  *this; }
+  LaneMask operator>=(const Double8& other) const { return other <= *this; }
+
+  friend Double8 sqrt(const Double8& value)
+  {
+    Double8 result;
+    for (size_t i = 0; i < SIZE; ++i)
+      result.m_lanes[i] = std::sqrt(value.m_lanes[i]);
+    return result;
+  }
+  friend Double8 min(const Double8& lhs, const Double8& rhs)
+  {
+    Double8 result;
+    for (size_t i = 0; i < SIZE; ++i)
+      result.m_lanes[i] = lhs.m_lanes[i] < rhs.m_lanes[i]
+                        ? lhs.m_lanes[i] : rhs.m_lanes[i];
+    return result;
+  }
+  friend Double8 max(const Double8& lhs, const Double8& rhs)
+  {
+    Double8 result;
+    for (size_t i = 0; i < SIZE; ++i)
+      result.m_lanes[i] = lhs.m_lanes[i] > rhs.m_lanes[i]
+                        ? lhs.m_lanes[i] : rhs.m_lanes[i];
+    return result;
+  }
+
+  friend Double8 select(LaneMask mask,
+                        const Double8& if_set, const Double8& if_unset)
+  {
+    Double8 result;
+    for (size_t i = 0; i < SIZE; ++i)
+      result.m_lanes[i] = (mask >> i) & 1 ? if_set.m_lanes[i]
+                                           : if_unset.m_lanes[i];
+    return result;
+  }
+
+private:
+  double m_lanes[SIZE];
+
+#endif
+
+public:
+  Double8(const Double8& other) = default;
+  Double8& operator=(const Double8& other) = default;
+
+  ~Double8() = default;
+
+  double operator[](size_t lane) const
+  {
+    double lanes[SIZE];
+    store(lanes);
+    return lanes[lane];
+  }
+
+  Double8& operator+=(const Double8& other) { return *this = *this + other; }
+  Double8& operator-=(const Double8& other) { return *this = *this - other; }
+  Double8& operator*=(const Double8& other) { return *this = *this * other; }
+  Double8& operator/=(const Double8& other) { return *this = *this / other; }
+};
+
+inline Double8 operator+(double lhs, const Double8& rhs) { return Double8(lhs) + rhs; }
+inline Double8 operator-(double lhs, const Double8& rhs) { return Double8(lhs) - rhs; }
+inline Double8 operator*(double lhs, const Double8& rhs) { return Double8(lhs) * rhs; }
+inline Double8 operator/(double lhs, const Double8& rhs) { return Double8(lhs) / rhs; }
+
+/**
+ * @brief Eight floats. Uses one AVX register if available, falls back to
+ * plain array otherwise.
+ */
+class Float8
+{
+public:
+  static constexpr size_t   SIZE     = 8;
+  static constexpr LaneMask ALL_MASK = (1u << SIZE) - 1;
+
+#if defined(__AVX2__)
+
+  Float8()             : m_value(_mm256_setzero_ps())  {}
+  Float8(float value)  : m_value(_mm256_set1_ps(value)) {}
+
+  static Float8 load(const float* data)
+  {
+    return Float8(_mm256_loadu_ps(data));
+  }
+  void store(float* data) const { _mm256_storeu_ps(data, m_value); }
+
+  Float8 operator+(const Float8& other) const
+  {
+    return Float8(_mm256_add_ps(m_value, other.m_value));
+  }
+  Float8 operator-(const Float8& other) const
+  {
+    return Float8(_mm256_sub_ps(m_value, other.m_value));
+  }
+  Float8 operator*(const Float8& other) const
+  {
+    return Float8(_mm256_mul_ps(m_value, other.m_value));
+  }
+  Float8 operator/(const Float8& other) const
+  {
+    return Float8(_mm256_div_ps(m_value, other.m_value));
+  }
+  Float8 operator-() const { return Float8(0.0f) - *this; }
+
+  LaneMask operator< (const Float8& other) const
+  {
+    return LaneMask(_mm256_movemask_ps(
+             _mm256_cmp_ps(m_value, other.m_value, _CMP_LT_OQ)));
+  }
+  LaneMask operator<=(const Float8& other) const
+  {
+    return LaneMask(_mm256_movemask_ps(
+             _mm256_cmp_ps(m_value, other.m_value, _CMP_LE_OQ)));
+  }
+  LaneMask operator> (const Float8& other) const { return other <  *this; }
+  LaneMask operator>=(const Float8& other) const { return other <= *this; }
+
+  friend Float8 sqrt(const Float8& value)
+  {
+    return Float8(_mm256_sqrt_ps(value.m_value));
+  }
+  friend Float8 min(const Float8& lhs, const Float8& rhs)
+  {
+    return Float8(_mm256_min_ps(lhs.m_value, rhs.m_value));
+  }
+  friend Float8 max(const Float8& lhs, const Float8& rhs)
+  {
+    return Float8(_mm256_max_ps(lhs.m_value, rhs.m_value));
+  }
+
+  friend Float8 select(LaneMask mask,
+                       const Float8& if_set, const Float8& if_unset)
+  {
+    const __m256i bits = _mm256_and_si256(
+                           _mm256_set1_epi32(int(mask)),
+                           _mm256_set_epi32(128, 64, 32, 16, 8, 4, 2, 1));
+    const __m256  lanes = _mm256_castsi256_ps(
+                            _mm256_cmpgt_epi32(bits, _mm256_setzero_si256()));
+    return Float8(_mm256_blendv_ps(if_unset.m_value, if_set.m_value, lanes));
+  }
+
+private:
+  __m256 m_value;
+
+  explicit Float8(__m256 value) : m_value(value) {}
+
+#else
+
+  Float8() : m_lanes{} {}
+  Float8(float value) : m_lanes{}
+  {
+    for (size_t i = 0; i < SIZE; ++i)
+      m_lanes[i] = value;
+  }
+
+  static Float8 load(const float* data)
+  {
+    Float8 result;
+    for (size_t i = 0; i < SIZE; ++i)
+      result.m_lanes[i] = data[i];
+    return result;
+  }
+  void store(float* data) const
+  {
+    for (size_t i = 0; i < SIZE; ++i)
+      data[i] = m_lanes[i];
+  }
+
+  Float8 operator+(const Float8& other) const
+  {
+    Float8 result;
+    for (size_t i = 0; i < SIZE; ++i)
+      result.m_lanes[i] = m_lanes[i] + other.m_lanes[i];
+    return result;
+  }
+  Float8 operator-(const Float8& other) const
+  {
+    Float8 result;
+    for (size_t i = 0; i < SIZE; ++i)
+      result.m_lanes[i] = m_lanes[i] - other.m_lanes[i];
+    return result;
+  }
+  Float8 operator*(const Float8& other) const
+  {
+    Float8 result;
+    for (size_t i = 0; i < SIZE; ++i)
+      result.m_lanes[i] = m_lanes[i] * other.m_lanes[i];
+    return result;
+  }
+  Float8 operator/(const Float8& other) const
+  {
+    Float8 result;
+    for (size_t i = 0; i < SIZE; ++i)
+      result.m_lanes[i] = m_lanes[i] / other.m_lanes[i];
+    return result;
+  }
+  Float8 operator-() const { return Float8(0.0f) - *this; }
+
+  LaneMask operator< (const Float8& other) const
+  {
+    LaneMask mask = 0;
+    for (size_t i = 0; i < SIZE; ++i)
+      mask |= LaneMask(m_lanes[i] < other.m_lanes[i]) << i;
+    return mask;
+  }
+  LaneMask operator<=(const Float8& other) const
+  {
+    LaneMask mask = 0;
+    for (size_t i = 0; i < SIZE; ++i)
+      mask |= LaneMask(m_lanes[i] <= other.m_lanes[i]) << i;
+    return mask;
+  }
+  LaneMask operator> (const Float8& other) const { return other <  *this; }
+  LaneMask operator>=(const Float8& other) const { return other <= *this; }
+
+  friend Float8 sqrt(const Float8& value)
+  {
+    Float8 result;
+    for (size_t i = 0; i < SIZE; ++i)
+      result.m_lanes[i] = std::sqrt(value.m_lanes[i]);
+    return result;
+  }
+  friend Float8 min(const Float8& lhs, const Float8& rhs)
+  {
+    Float8 result;
+    for (size_t i = 0; i < SIZE; ++i)
+      result.m_lanes[i] = lhs.m_lanes[i] < rhs.m_lanes[i]
+                        ? lhs.m_lanes[i] : rhs.m_lanes[i];
+    return result;
+  }
+  friend Float8 max(const Float8& lhs, const Float8& rhs)
+  {
+    Float8 result;
+    for (size_t i = 0; i < SIZE; ++i)
+      result.m_lanes[i] = lhs.m_lanes[i] > rhs.m_lanes[i]
+                        ? lhs.m_lanes[i] : rhs.m_lanes[i];
+    return result;
+  }
+
+  friend Float8 select(LaneMask mask,
+                       const Float8& if_set, const Float8& if_unset)
+  {
+    Float8 result;
+    for (size_t i = 0; i < SIZE; ++i)
+      result.m_lanes[i] = (mask >> i) & 1 ? if_set.m_lanes[i]
+                                           : if_unset.m_lanes[i];
+    return result;
+  }
+
+private:
+  float m_lanes[SIZE];
+
+#endif
+
+public:
+  Float8(const Float8& other) = default;
+  Float8& operator=(const Float8& other) = default;
+
+  ~Float8() = default;
+
+  float operator[](size_t lane) const
+  {
+    float lanes[SIZE];
+    store(lanes);
+    return lanes[lane];
+  }
+
+  Float8& operator+=(const Float8& other) { return *this = *this + other; }
+  Float8& operator-=(const Float8& other) { return *this = *this - other; }
+  Float8& operator*=(const Float8& other) { return *this = *this * other; }
+  Float8& operator/=(const Float8& other) { return *this = *this / other; }
+};
+
+inline Float8 operator+(float lhs, const Float8& rhs) { return Float8(lhs) + rhs; }
+inline Float8 operator-(float lhs, const Float8& rhs) { return Float8(lhs) - rhs; }
+inline Float8 operator*(float lhs, const Float8& rhs) { return Float8(lhs) * rhs; }
+inline Float8 operator/(float lhs, const Float8& rhs) { return Float8(lhs) / rhs; }
+
+/**
+ * @brief Eight lanes of `real`
+ */
+using Real8 = std::conditional_t<std::is_same<real, float>::value,
+                                 Float8, Double8>;
+
+#endif /* simd.h */
@@ -0,0 +1,152 @@
+#include "ray_trace/thread_pool.h"
+
+ThreadPool::ThreadPool(size_t thread_count) :
+  m_threadCount(thread_count),
+  m_threads(),
+  m_queues(),
+  m_mutex(),
+  m_wakeUp(),
+  m_finished(),
+  m_task(nullptr),
+  m_generation(0),
+  m_activeWorkers(0),
+  m_remainingTasks(0),
+  m_stopping(false)
+{
+  if (m_threadCount == 0)
+    m_threadCount = std::thread::hardware_concurrency();
+  if (m_threadCount == 0)
+    m_threadCount = 1;
+
+  m_queues.reset(new WorkQueue[m_threadCount]);
+
+  m_threads.reserve(m_threadCount);
+  for (size_t i = 0; i < m_threadCount; ++i)
+    m_threads.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+  m_wakeUp.notify_all();
+
+  for (std::thread& thread : m_threads)
+    thread.join();
+}
+
+void ThreadPool::run(size_t task_count, const Task& task)
+{
+  if (task_count == 0)
+    return;
+
+  const size_t worker_count = threadCount();
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  // Give each worker a contiguous block of tasks, so that neighbouring
+  // tiles stay on one thread unless they get stolen
+  for (size_t worker = 0; worker < worker_count; ++worker)
+  {
+    const size_t begin = task_count *  worker      / worker_count;
+    const size_t end   = task_count * (worker + 1) / worker_count;
+
+    std::lock_guard<std::mutex> queue_lock(m_queues[worker].mutex);
+    for (size_t i = begin; i < end; ++i)
+      m_queues[worker].tasks.push_back(i);
+  }
+
+  m_task = &task;
+  m_remainingTasks.store(task_count);
+  ++m_generation;
+
+  m_wakeUp.notify_all();
+
+  // Wait until every task is done and no worker still holds `task`
+  m_finished.wait(lock, [this]()
+  {
+    return m_remainingTasks.load() == 0 && m_activeWorkers == 0;
+  });
+
+  m_task = nullptr;
+}
+
+void ThreadPool::workerLoop(size_t worker_index)
+{
+  size_t seen_generation = 0;
+
+  while (true)
+  {
+    const Task* task = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wakeUp.wait(lock, [this, seen_generation]()
+      {
+        return m_stopping || m_generation != seen_generation;
+      });
+
+      if (m_stopping)
+        return;
+
+      seen_generation = m_generation;
+
+      // Woke up too late, the batch is already finished
+      if (m_remainingTasks.load() == 0)
+        continue;
+
+      task = m_task;
+      ++m_activeWorkers;
+    }
+
+    size_t task_index = 0;
+    while (popTask(worker_index, task_index))
+    {
+      (*task)(task_index, worker_index);
+
+      if (m_remainingTasks.fetch_sub(1) == 1)
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_finished.notify_all();
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      --m_activeWorkers;
+    }
+    m_finished.notify_all();
+  }
+}
+
+bool ThreadPool::popTask(size_t worker_index, size_t& task_index)
+{
+  // Take own work first
+  {
+    WorkQueue& own = m_queues[worker_index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty())
+    {
+      task_index = own.tasks.front();
+      own.tasks.pop_front();
+      return true;
+    }
+  }
+
+  // Steal from the back of other queues
+  const size_t worker_count = threadCount();
+  for (size_t offset = 1; offset < worker_count; ++offset)
+  {
+    WorkQueue& victim = m_queues[(worker_index + offset) % worker_count];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty())
+    {
+      task_index = victim.tasks.back();
+      victim.tasks.pop_back();
+      return true;
+    }
+  }
+
+  return false;
+}
@@ -0,0 +1,80 @@
+/**
+ * @file thread_pool.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Persistent pool of worker threads with work stealing
+ *
+ * @version 0.1
+ * @date 2023-09-20
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __RAY_TRACE_THREAD_POOL_H
+#define __RAY_TRACE_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+  using Task = std::function<void(size_t task_index, size_t worker_index)>;
+
+  /**
+   * @brief Start `thread_count` workers. Zero means one worker per
+   * hardware thread.
+   */
+  explicit ThreadPool(size_t thread_count = 0);
+
+  ThreadPool(const ThreadPool& other) = delete;
+  ThreadPool& operator=(const ThreadPool& other) = delete;
+
+  ~ThreadPool();
+
+  size_t threadCount() const { return m_threadCount; }
+
+  /**
+   * @brief Run `task` for every index in [0, task_count) and wait for all
+   * of them to finish.
+   *
+   * Indices are split into contiguous blocks, one per worker. Each worker
+   * takes tasks from the front of its own block and, once it runs dry,
+   * steals from the back of other workers' blocks.
+   */
+  void run(size_t task_count, const Task& task);
+
+private:
+  struct WorkQueue
+  {
+    std::mutex         mutex;
+    std::deque<size_t> tasks;
+
+    WorkQueue() : mutex(), tasks() {}
+  };
+
+  void workerLoop(size_t worker_index);
+  bool popTask(size_t worker_index, size_t& task_index);
+
+  size_t                       m_threadCount;
+  std::vector<std::thread>     m_threads;
+  std::unique_ptr<WorkQueue[]> m_queues;
+
+  std::mutex              m_mutex;
+  std::condition_variable m_wakeUp;
+  std::condition_variable m_finished;
+
+  const Task*         m_task;
+  size_t              m_generation;
+  size_t              m_activeWorkers;
+  std::atomic<size_t> m_remainingTasks;
+  bool                m_stopping;
+};
+
+#endif /* thread_pool.h */
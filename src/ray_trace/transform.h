@@ -20,8 +20,10 @@ class Transform
 public:
   Transform(const Point&  position = Point(0, 0, 0),
             const Vec&    scale    = Point(1, 1, 1), const Matrix& rotation = Matrix::One)
-    : m_position(position), m_scale(scale), m_rotation(rotation)
+    : m_position(position), m_scale(scale), m_rotation(rotation),
+      m_matrix(), m_inverseMatrix(), m_normalMatrix()
   {
+    updateMatrices();
   }
 
   Transform(const Transform& other) = default;
@@ -31,6 +33,31 @@ public:
   const Vec&    scale()    const { return m_scale; }
   const Matrix& rotation() const { return m_rotation; }
 
+  /**
+   * @brief Linear part of object-to-world transformation (rotation applied
+   * after scale)
+   */
+  const Matrix& matrix()        const { return m_matrix; }
+
+  /**
+   * @brief Linear part of world-to-object transformation
+   */
+  const Matrix& inverseMatrix() const { return m_inverseMatrix; }
+
+  /**
+   * @brief Matrix transforming object-space normals to world space
+   */
+  const Matrix& normalMatrix()  const { return m_normalMatrix; }
+
+  Point toWorld(const Point& point) const
+  {
+    return m_matrix * point + m_position;
+  }
+
+  Point toLocal(const Point& point) const
+  {
+    return m_inverseMatrix * (point - m_position);
+  }
 
   Vec right()    const { return rotation() * Vec::UNIT_X; }
   Vec left()     const { return -right(); }
@@ -46,20 +73,34 @@ public:
     m_scale.m_x *= scale.m_x;
     m_scale.m_y *= scale.m_y;
     m_scale.m_z *= scale.m_z;
+    updateMatrices();
   }
 
   void rotate(const Vec& axis, double angle_deg)
   {
     m_rotation = Matrix::fromRotation(axis, angle_deg) * m_rotation;
+    updateMatrices();
   }
 
   void moveTo (const Vec& target) { m_position  = target; }
-  void scaleTo(const Vec& scale)  { m_scale = scale; }
+  void scaleTo(const Vec& scale)  { m_scale = scale; updateMatrices(); }
 
 private:
   Point  m_position;
   Vec    m_scale;
   Matrix m_rotation;
+
+  // Cached on every change of scale or rotation
+  Matrix m_matrix;
+  Matrix m_inverseMatrix;
+  Matrix m_normalMatrix;
+
+  void updateMatrices()
+  {
+    m_matrix        = m_rotation * Matrix::fromScale(m_scale);
+    m_inverseMatrix = m_matrix.getInverse();
+    m_normalMatrix  = m_inverseMatrix.getTransposed();
+  }
 };
 
 #endif /* transform.h */
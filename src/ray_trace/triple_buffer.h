@@ -0,0 +1,105 @@
+/**
+ * @file triple_buffer.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Lock-free handoff of values between two threads
+ *
+ * @version 0.1
+ * @date 2023-09-28
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __RAY_TRACE_TRIPLE_BUFFER_H
+#define __RAY_TRACE_TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief Three slots shared by one writer and one reader. Writer fills its
+ * back slot and publishes it, reader takes the latest published slot as
+ * its front one. Neither side ever waits for the other: values published
+ * before reader gets to them are dropped in favour of newer ones.
+ */
+template <typename T>
+class TripleBuffer
+{
+public:
+  /**
+   * @brief Construct every slot as `T(args...)`
+   */
+  template <typename... Args>
+  explicit TripleBuffer(const Args&... args) :
+    m_slots{T(args...), T(args...), T(args...)},
+    m_back(0),
+    m_middle(1),
+    m_front(2)
+  {
+  }
+
+  TripleBuffer(const TripleBuffer& other) = delete;
+  TripleBuffer& operator=(const TripleBuffer& other) = delete;
+
+  ~TripleBuffer() = default;
+
+  /**
+   * @brief Slot owned by writer
+   */
+  T& back() { return m_slots[m_back]; }
+
+  /**
+   * @brief Make back slot the latest value, writer gets another slot,
+   * whose contents are stale
+   */
+  void publish()
+  {
+    const uint8_t old_middle = m_middle.exchange(m_back | FRESH,
+                                                 std::memory_order_acq_rel);
+    m_back = old_middle & INDEX_MASK;
+  }
+
+  /**
+   * @brief Whether some published value was not taken by reader yet. For
+   * writer, a `false` answer holds until it publishes again.
+   */
+  bool hasFresh() const
+  {
+    return m_middle.load(std::memory_order_acquire) & FRESH;
+  }
+
+  /**
+   * @brief Make latest published value the front slot
+   *
+   * @return `false` if nothing was published since the last call
+   */
+  bool take()
+  {
+    if (!hasFresh())
+      return false;
+
+    const uint8_t old_middle = m_middle.exchange(m_front,
+                                                 std::memory_order_acq_rel);
+    m_front = old_middle & INDEX_MASK;
+    return true;
+  }
+
+  /**
+   * @brief Slot owned by reader
+   */
+  const T& front() const { return m_slots[m_front]; }
+        T& front()       { return m_slots[m_front]; }
+
+private:
+  static constexpr uint8_t INDEX_MASK = 0x3;
+  static constexpr uint8_t FRESH      = 0x4;
+
+  T m_slots[3];
+
+  // Writer and reader each own one index, the third one is exchanged
+  // between them. Separate cache lines keep them from false sharing.
+  alignas(64) uint8_t              m_back;
+  alignas(64) std::atomic<uint8_t> m_middle;
+  alignas(64) uint8_t              m_front;
+};
+
+#endif /* triple_buffer.h */
@@ -1,5 +0,0 @@
-#include "ray_trace/vec.h"
-
-const Vec Vec::UNIT_X = Vec(1, 0, 0);
-const Vec Vec::UNIT_Y = Vec(0, 1, 0);
-const Vec Vec::UNIT_Z = Vec(0, 0, 1);
@@ -2,7 +2,7 @@
  * @file vec.h
  * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
  *
- * @brief 3D vector with double-precision floating-point coordinates
+ * @brief 3D vector with floating-point coordinates
  *
  * @version 0.1
  * @date 2023-09-10
@@ -13,32 +13,52 @@
 #define __RAY_TRACE_VEC_H
 
 #include <cmath>
+#include <type_traits>
 
-class Vec
+#include "ray_trace/real.h"
+
+template <typename T>
+class VecT
 {
 public:
-  double m_x, m_y, m_z;
+  using Scalar = T;
+
+  T m_x, m_y, m_z;
 
-  static const Vec UNIT_X;
-  static const Vec UNIT_Y;
-  static const Vec UNIT_Z;
+  static const VecT UNIT_X;
+  static const VecT UNIT_Y;
+  static const VecT UNIT_Z;
 
-  Vec(double x, double y, double z) :
+  constexpr VecT(T x, T y, T z) :
     m_x(x), m_y(y), m_z(z)
   {
   }
 
-  Vec(const Vec& other) = default;
-  Vec& operator=(const Vec& other) = default;
+  /**
+   * @brief Convert vector of other precision
+   */
+  template <typename U>
+  constexpr explicit VecT(const VecT<U>& other) :
+    m_x(T(other.m_x)), m_y(T(other.m_y)), m_z(T(other.m_z))
+  {
+  }
+
+  VecT(const VecT& other) = default;
+  VecT& operator=(const VecT& other) = default;
 
-  ~Vec()
+#ifdef RAY_TRACE_CHECKED_MATH
+  // Reads of destroyed vectors show up as NaN
+  ~VecT()
   {
     m_x = NAN;
     m_y = NAN;
     m_z = NAN;
   }
+#else
+  ~VecT() = default;
+#endif
 
-  Vec& operator+=(const Vec& other)
+  constexpr VecT& operator+=(const VecT& other)
   {
     m_x += other.m_x;
     m_y += other.m_y;
@@ -46,7 +66,7 @@ public:
     return *this;
   }
 
-  Vec& operator-=(const Vec& other)
+  constexpr VecT& operator-=(const VecT& other)
   {
     m_x -= other.m_x;
     m_y -= other.m_y;
@@ -54,7 +74,7 @@ public:
     return *this;
   }
 
-  Vec& operator*=(double scale)
+  constexpr VecT& operator*=(T scale)
   {
     m_x *= scale;
     m_y *= scale;
@@ -62,72 +82,92 @@ public:
     return *this;
   }
 
-  Vec& operator/=(double scale)
+  constexpr VecT& operator/=(T scale)
   {
-    return *this *= 1.0 / scale;
+    return *this *= T(1) / scale;
   }
 
-  Vec operator+(const Vec& other) const { return Vec(*this) += other; }
-  Vec operator-(const Vec& other) const { return Vec(*this) -= other; }
+  constexpr VecT operator+(const VecT& other) const { return VecT(*this) += other; }
+  constexpr VecT operator-(const VecT& other) const { return VecT(*this) -= other; }
 
-  Vec operator*(double scale) const { return Vec(*this) *= scale; }
-  Vec operator/(double scale) const { return Vec(*this) /= scale; }
+  constexpr VecT operator*(T scale) const { return VecT(*this) *= scale; }
+  constexpr VecT operator/(T scale) const { return VecT(*this) /= scale; }
 
-  Vec operator-() const { return *this * (-1); }
-  Vec operator+() const { return *this; }
+  constexpr VecT operator-() const { return *this * (-1); }
+  constexpr VecT operator+() const { return *this; }
 
-  double length() const
+  T length() const
   {
-    return sqrt(dotProduct(*this, *this));
+    return std::sqrt(dotProduct(*this, *this));
   }
 
-  bool isZero() const { return fabs(length()) < EPS; }
+  bool isZero() const { return std::fabs(length()) < EPS; }
 
-  Vec normalized() const { return *this / length(); }
+  VecT normalized() const { return *this / length(); }
 
-  Vec projectOn(const Vec& other) const
+  VecT projectOn(const VecT& other) const
   {
     if (other.isZero())
     {
-      return Vec(NAN, NAN, NAN);
+      return VecT(NAN, NAN, NAN);
     }
-    const double scale = dotProduct(*this, other) / other.length();
+    const T scale = dotProduct(*this, other) / other.length();
     return other * scale;
   }
 
-  bool isParallelTo(const Vec& other) const
+  bool isParallelTo(const VecT& other) const
   {
-    return Vec::crossProduct(*this, other).isZero();
+    return VecT::crossProduct(*this, other).isZero();
   }
 
-  static double dotProduct(const Vec& vec1, const Vec& vec2)
+  static constexpr T dotProduct(const VecT& vec1, const VecT& vec2)
   {
     return vec1.m_x * vec2.m_x
          + vec1.m_y * vec2.m_y
          + vec1.m_z * vec2.m_z;
   }
 
-  static Vec crossProduct(const Vec& vec1, const Vec& vec2)
+  static constexpr VecT crossProduct(const VecT& vec1, const VecT& vec2)
   {
-    return Vec(vec1.m_y * vec2.m_z - vec1.m_z * vec2.m_y,
-               vec1.m_z * vec2.m_x - vec1.m_x * vec2.m_z,
-               vec1.m_x * vec2.m_y - vec1.m_y * vec2.m_x);
+    return VecT(vec1.m_y * vec2.m_z - vec1.m_z * vec2.m_y,
+                vec1.m_z * vec2.m_x - vec1.m_x * vec2.m_z,
+                vec1.m_x * vec2.m_y - vec1.m_y * vec2.m_x);
   }
 
 private:
-  static constexpr double EPS = 1e-6;
+  static constexpr T EPS = T(1e-6);
 };
 
-inline Vec operator*(double scale, const Vec& vec) { return vec * scale; }
-inline bool operator==(const Vec& lhs, const Vec& rhs)
+template <typename T> RAY_TRACE_MATH_CONSTEXPR VecT<T> VecT<T>::UNIT_X = VecT<T>(1, 0, 0);
+template <typename T> RAY_TRACE_MATH_CONSTEXPR VecT<T> VecT<T>::UNIT_Y = VecT<T>(0, 1, 0);
+template <typename T> RAY_TRACE_MATH_CONSTEXPR VecT<T> VecT<T>::UNIT_Z = VecT<T>(0, 0, 1);
+
+// Scale is not deduced, so that any arithmetic type converts to it
+template <typename T>
+constexpr VecT<T> operator*(typename VecT<T>::Scalar scale, const VecT<T>& vec)
+{
+  return vec * scale;
+}
+template <typename T>
+inline bool operator==(const VecT<T>& lhs, const VecT<T>& rhs)
 {
   return (lhs - rhs).isZero();
 }
-inline bool operator!=(const Vec& lhs, const Vec& rhs)
+template <typename T>
+inline bool operator!=(const VecT<T>& lhs, const VecT<T>& rhs)
 {
   return !(lhs == rhs);
 }
 
+using Vec   = VecT<real>;
 using Point = Vec;
 
+#ifndef RAY_TRACE_CHECKED_MATH
+static_assert(std::is_trivially_copyable<Vec>::value,
+              "Vec must be copyable with memcpy");
+static_assert(VecT<double>::crossProduct(VecT<double>::UNIT_X,
+                                         VecT<double>::UNIT_Y).m_z > 0,
+              "Vec must be usable in constant expressions");
+#endif
+
 #endif /* vec.h */
@@ -0,0 +1,85 @@
+#include "scenes/demo_scene.h"
+
+#include "ray_trace/camera.h"
+#include "ray_trace/color.h"
+#include "ray_trace/material.h"
+#include "ray_trace/scene_object.h"
+#include "ray_trace/transform.h"
+
+static void setupLighting(Scene& scene);
+
+Camera getDemoCamera()
+{
+  return Camera(Transform(Vec(0, 0, 0)), 30);
+}
+
+void populateDemoScene(Scene& scene)
+{
+  setupLighting(scene);
+
+  SceneObject ellipsoid(ObjectType::Sphere,
+                        scene.addMaterial(
+                          Material(0.85, Color::Red + Color::White * 0.33)),
+                        Transform(
+                            /* position = */ Vec(0, 0, 10),
+                            /* scale    = */ Vec(0.8, 0.8, 1.5)));
+  ellipsoid.transform().rotate(Vec::UNIT_X, -45);
+  ellipsoid.transform().rotate(Vec::UNIT_Y, -75);
+
+  scene.addObject(ellipsoid);
+}
+
+void populateShowcaseScene(Scene& scene)
+{
+  populateDemoScene(scene);
+
+  SceneObject mirror(ObjectType::Sphere,
+                     scene.addMaterial(
+                       Material(0.3, Color::fromNormalized(0.5, 0.7, 0.6))),
+                     Transform(
+                       /* position = */ Vec(-2, -1, 11),
+                       /* scale    = */ Vec(0.7, 0.7, 0.7)));
+  SceneObject sphere(ObjectType::Sphere,
+                     scene.addMaterial(
+                       Material(0.98, Color::fromNormalized(0.8, 0.7, 0.65))),
+                     Transform(
+                       /* position = */ Vec(-0.7, -1.5, 8.5),
+                       /* scale    = */ Vec(0.5, 0.5, 0.5)));
+
+  SceneObject floor(ObjectType::Plane,
+                    scene.addMaterial(Material(1, Color::White)),
+                    Transform(Vec(0, -2, 0)));
+  SceneObject left_wall(ObjectType::Plane,
+                        scene.addMaterial(Material(1, Color::Blue)),
+                        Transform(Vec(-3, 0, 0)));
+  left_wall.transform().rotate(Vec::UNIT_Z, 90);
+
+  SceneObject right_wall(ObjectType::Plane,
+                        scene.addMaterial(Material(1, Color::Green)),
+                        Transform(Vec(3, 0, 0)));
+  right_wall.transform().rotate(Vec::UNIT_Z, 90);
+
+  SceneObject back_wall(ObjectType::Plane,
+                        scene.addMaterial(Material(1, Color::White*0.3)),
+                        Transform(Vec(0, 0, 15)));
+  back_wall.transform().rotate(Vec::UNIT_X, 90);
+
+  Color blue_light = Color::Blue*0.7 + 0.5 * Color::White;
+  SceneObject light(ObjectType::Sphere,
+                    scene.addMaterial(Material(1, blue_light, blue_light)),
+                    Transform(Vec(1.7, -0.1, 8), Vec(0.2, 0.2, 0.2)));
+
+  scene.addObject(mirror);
+  scene.addObject(sphere);
+  scene.addObject(floor);
+  scene.addObject(back_wall);
+  scene.addObject(left_wall);
+  scene.addObject(right_wall);
+  scene.addObject(light);
+}
+
+static void setupLighting(Scene& scene)
+{
+  scene.ambientLight()  = Color::White * 0.3;
+  scene.directedLight() = DirectedLight(Vec(0, -1, 1), Color::White * 1.5);
+}
@@ -0,0 +1,32 @@
+/**
+ * @file demo_scene.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Built-in scenes shared by interactive and batch renderers
+ *
+ * @version 0.1
+ * @date 2023-09-26
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __SCENES_DEMO_SCENE_H
+#define __SCENES_DEMO_SCENE_H
+
+#include "ray_trace/scene.h"
+
+/**
+ * @brief Camera used by built-in scenes
+ */
+Camera getDemoCamera();
+
+/**
+ * @brief Add lights and a single ellipsoid to `scene`
+ */
+void populateDemoScene(Scene& scene);
+
+/**
+ * @brief Add lights, spheres, walls and a light source to `scene`
+ */
+void populateShowcaseScene(Scene& scene);
+
+#endif /* demo_scene.h */
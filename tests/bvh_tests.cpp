@@ -0,0 +1,191 @@
+/**
+ * @file bvh_tests.cpp
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Tests of bounding volume hierarchy against linear scan of scene
+ *
+ * @version 0.1
+ * @date 2023-10-04
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#include <cmath>
+#include <cstdint>
+
+#include "ray_trace/bvh.h"
+#include "ray_trace/scene.h"
+
+#include "test.h"
+
+/**
+ * @brief Deterministic generator of uniform numbers, so that failures
+ * reproduce
+ */
+class TestRandom
+{
+public:
+  explicit TestRandom(uint64_t seed) : m_state(seed) {}
+
+  double uniform(double min, double max)
+  {
+    // xorshift64*
+    m_state ^= m_state >> 12;
+    m_state ^= m_state << 25;
+    m_state ^= m_state >> 27;
+    const uint64_t bits = m_state * 0x2545F4914F6CDD1Dull;
+    return min + (max - min) * double(bits >> 11) / double(1ull << 53);
+  }
+
+private:
+  uint64_t m_state;
+};
+
+/**
+ * @brief Spheres and rotated boxes of different sizes, two planes and a
+ * few hidden objects, which no ray may hit
+ */
+static void populateRandomScene(Scene& scene, TestRandom& random)
+{
+  const uint32_t visible = scene.addMaterial(Material(1, Color::White));
+  const uint32_t hidden  = scene.addMaterial(Material());
+
+  for (size_t i = 0; i < 400; ++i)
+  {
+    const ObjectType type = i % 3 == 0 ? ObjectType::Box : ObjectType::Sphere;
+    Transform transform(Point(random.uniform(-20, 20),
+                              random.uniform(-20, 20),
+                              random.uniform(-20, 20)),
+                        Vec(random.uniform(0.1, 2),
+                            random.uniform(0.1, 2),
+                            random.uniform(0.1, 2)));
+    transform.rotate(Vec(random.uniform(-1, 1),
+                         random.uniform(-1, 1),
+                         1),
+                     random.uniform(0, 360));
+
+    scene.addObject(SceneObject(type, i % 50 == 7 ? hidden : visible,
+                                transform));
+  }
+
+  scene.addObject(SceneObject(ObjectType::Plane, visible,
+                              Transform(Point(0, -25, 0))));
+  Transform wall(Point(0, 0, 25));
+  wall.rotate(Vec(1, 0, 0), 90);
+  scene.addObject(SceneObject(ObjectType::Plane, visible, wall));
+}
+
+/**
+ * @brief Closest visible object hit by `ray` and distance to it, found by
+ * testing every object
+ */
+static size_t findClosestLinear(const Scene& scene, const Ray& ray,
+                                real& distance)
+{
+  size_t closest = RayHit::NO_OBJECT;
+  distance = INFINITY;
+  for (size_t i = 0; i < scene.objectCount(); ++i)
+  {
+    if (scene.objectMaterial(i).isHidden())
+      continue;
+
+    const real hit_distance = ray.getHitDistance(scene, i);
+    if (hit_distance < distance)
+    {
+      distance = hit_distance;
+      closest  = i;
+    }
+  }
+
+  return closest;
+}
+
+static void testClosestHit(TestReport& report)
+{
+  report.begin("bvh_closest_hit");
+
+  TestRandom random(7);
+  Scene scene(Camera(Transform(Vec(0, 0, 0))));
+  populateRandomScene(scene, random);
+
+  Bvh bvh;
+  bvh.build(scene);
+
+  size_t mismatches = 0;
+  size_t misses     = 0;
+  for (size_t i = 0; i < 2000; ++i)
+  {
+    const Ray ray(Point(random.uniform(-30, 30),
+                        random.uniform(-30, 30),
+                        random.uniform(-30, 30)),
+                  Vec(random.uniform(-1, 1),
+                      random.uniform(-1, 1),
+                      random.uniform(-1, 1)));
+
+    real distance = 0;
+    const size_t expected = findClosestLinear(scene, ray, distance);
+    const RayHit hit      = bvh.getClosestHit(ray);
+
+    misses += expected == RayHit::NO_OBJECT;
+    if (hit.object() != expected)
+      ++mismatches;
+    else if (hit.hasHit()
+          && std::fabs(hit.distance() - distance) > real(1e-4) * distance)
+      ++mismatches;
+  }
+
+  TEST_CHECK(report, mismatches == 0);
+
+  // Both hits and misses were tested
+  TEST_CHECK(report, misses > 0 && misses < 2000);
+}
+
+static void testOccluder(TestReport& report)
+{
+  report.begin("bvh_occluder");
+
+  TestRandom random(11);
+  Scene scene(Camera(Transform(Vec(0, 0, 0))));
+  populateRandomScene(scene, random);
+
+  Bvh bvh;
+  bvh.build(scene);
+
+  size_t mismatches = 0;
+  size_t occluded   = 0;
+  for (size_t i = 0; i < 2000; ++i)
+  {
+    const Ray ray(Point(random.uniform(-30, 30),
+                        random.uniform(-30, 30),
+                        random.uniform(-30, 30)),
+                  Vec(random.uniform(-1, 1),
+                      random.uniform(-1, 1),
+                      random.uniform(-1, 1)));
+    const real max_distance = real(random.uniform(1, 40));
+
+    real distance = 0;
+    findClosestLinear(scene, ray, distance);
+    const size_t occluder = bvh.findOccluder(ray, max_distance);
+
+    // Occluder need not be the closest object, only a visible one closer
+    // than `max_distance`
+    if (distance < max_distance)
+    {
+      ++occluded;
+      if (occluder == RayHit::NO_OBJECT
+       || scene.objectMaterial(occluder).isHidden()
+       || !(ray.getHitDistance(scene, occluder) < max_distance))
+        ++mismatches;
+    }
+    else if (occluder != RayHit::NO_OBJECT)
+      ++mismatches;
+  }
+
+  TEST_CHECK(report, mismatches == 0);
+  TEST_CHECK(report, occluded > 0 && occluded < 2000);
+}
+
+void runBvhTests(TestReport& report)
+{
+  testClosestHit(report);
+  testOccluder(report);
+}
@@ -0,0 +1,97 @@
+/**
+ * @file chunked_array_tests.cpp
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Tests of adopting external memory and sharing chunks between
+ * copies of chunked array
+ *
+ * @version 0.1
+ * @date 2023-10-04
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#include "ray_trace/chunked_array.h"
+
+#include "test.h"
+
+using TestArray = ChunkedArray<int, 4>;
+
+static void testAdopt(TestReport& report)
+{
+  report.begin("chunked_array_adopt");
+
+  int data[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+  TestArray array;
+  array.adopt(data, 10);
+  TEST_CHECK(report, array.size() == 10);
+
+  // Full chunks are used in place, the rest is copied
+  TEST_CHECK(report, &array[0] == data);
+  TEST_CHECK(report, &array[7] == data + 7);
+  TEST_CHECK(report, &array[8] != data + 8);
+
+  bool has_values = true;
+  for (int i = 0; i < 10; ++i)
+    has_values = has_values && array[size_t(i)] == i;
+  TEST_CHECK(report, has_values);
+
+  // Array keeps growing past adopted elements
+  array.push_back(10);
+  array.push_back(11);
+  array.push_back(12);
+  TEST_CHECK(report, array.size() == 13);
+  TEST_CHECK(report, array[12] == 12);
+
+  // Changes never reach external memory
+  array.set(1, 100);
+  TEST_CHECK(report, array[1] == 100);
+  TEST_CHECK(report, data[1] == 1);
+  TEST_CHECK(report, array[2] == 2);
+
+  // Adopting less than a chunk copies everything
+  TestArray small;
+  small.adopt(data, 3);
+  TEST_CHECK(report, small.size() == 3);
+  TEST_CHECK(report, &small[0] != data);
+  TEST_CHECK(report, small[2] == 2);
+}
+
+static void testAssign(TestReport& report)
+{
+  report.begin("chunked_array_assign");
+
+  TestArray array;
+  for (int i = 0; i < 10; ++i)
+    array.push_back(i);
+
+  TestArray copy;
+  copy.assign(array);
+  TEST_CHECK(report, copy.size() == 10);
+
+  // Unchanged chunks are shared
+  TEST_CHECK(report, &copy[0] == &array[0]);
+
+  // Changing either array leaves the other one intact
+  array.set(1, 100);
+  copy.set(9, 900);
+  TEST_CHECK(report, array[1] == 100 && copy[1] == 1);
+  TEST_CHECK(report, array[9] == 9   && copy[9] == 900);
+  TEST_CHECK(report, &copy[4] == &array[4]);
+
+  // Growing into shared last chunk copies it as well
+  array.push_back(10);
+  copy.push_back(77);
+  TEST_CHECK(report, array[10] == 10 && copy[10] == 77);
+  TEST_CHECK(report, array.size() == 11 && copy.size() == 11);
+
+  array.clear();
+  TEST_CHECK(report, array.empty());
+  TEST_CHECK(report, copy[5] == 5);
+}
+
+void runChunkedArrayTests(TestReport& report)
+{
+  testAdopt(report);
+  testAssign(report);
+}
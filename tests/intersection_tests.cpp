@@ -0,0 +1,100 @@
+/**
+ * @file intersection_tests.cpp
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Tests of ray intersection with unit sphere, box and plane
+ *
+ * @version 0.1
+ * @date 2023-10-04
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#include <cmath>
+
+#include "ray_trace/ray.h"
+
+#include "test.h"
+
+static bool isNear(real value, real expected)
+{
+  return std::fabs(value - expected) < real(1e-5);
+}
+
+static void testSphere(TestReport& report)
+{
+  report.begin("intersect_unit_sphere");
+
+  // Hit from outside, from inside and after the first hit
+  TEST_CHECK(report, isNear(intersectUnitSphere(Vec(0, 0, -5), Vec(0, 0, 1),
+                                                real(0)), 4));
+  TEST_CHECK(report, isNear(intersectUnitSphere(Vec(0, 0, 0), Vec(1, 0, 0),
+                                                real(0)), 1));
+  TEST_CHECK(report, isNear(intersectUnitSphere(Vec(0, 0, -5), Vec(0, 0, 1),
+                                                real(5)), 6));
+
+  // Direction need not be normalized
+  TEST_CHECK(report, isNear(intersectUnitSphere(Vec(0, 0, -5), Vec(0, 0, 2),
+                                                real(0)), 2));
+
+  // Misses: beside sphere, pointing away, sphere behind `t_min`
+  TEST_CHECK(report, std::isinf(intersectUnitSphere(Vec(0, 2, -5),
+                                                    Vec(0, 0, 1), real(0))));
+  TEST_CHECK(report, std::isinf(intersectUnitSphere(Vec(0, 0, -5),
+                                                    Vec(0, 0, -1), real(0))));
+  TEST_CHECK(report, std::isinf(intersectUnitSphere(Vec(0, 0, -5),
+                                                    Vec(0, 0, 1), real(7))));
+}
+
+static void testBox(TestReport& report)
+{
+  report.begin("intersect_unit_box");
+
+  TEST_CHECK(report, isNear(intersectUnitBox(Vec(-5, 0, 0), Vec(1, 0, 0),
+                                             real(0)), 4));
+  TEST_CHECK(report, isNear(intersectUnitBox(Vec(0, 0, 0), Vec(0, -1, 0),
+                                             real(0)), 1));
+  TEST_CHECK(report, isNear(intersectUnitBox(Vec(-5, -5, -5), Vec(1, 1, 1),
+                                             real(0)), 4));
+  TEST_CHECK(report, isNear(intersectUnitBox(Vec(-5, 0, 0), Vec(2, 0, 0),
+                                             real(0)), 2));
+
+  // Axis-parallel rays in the plane of a face must not produce NaN
+  const real on_face = intersectUnitBox(Vec(0, 1, -5), Vec(0, 0, 1), real(0));
+  TEST_CHECK(report, !std::isnan(on_face));
+  TEST_CHECK(report, isNear(on_face, 4));
+  TEST_CHECK(report, std::isinf(intersectUnitBox(Vec(0, 2, -5), Vec(0, 0, 1),
+                                                 real(0))));
+
+  TEST_CHECK(report, std::isinf(intersectUnitBox(Vec(-5, 0, 0),
+                                                 Vec(-1, 0, 0), real(0))));
+  TEST_CHECK(report, std::isinf(intersectUnitBox(Vec(-5, 0, 0),
+                                                 Vec(1, 0, 0), real(7))));
+
+  TEST_CHECK(report, getUnitBoxNormal(Vec(real(0.5), -1, real(0.2))).m_y
+                     < 0);
+}
+
+static void testPlane(TestReport& report)
+{
+  report.begin("intersect_unit_plane");
+
+  TEST_CHECK(report, isNear(intersectUnitPlane(Vec(0, 3, 0), Vec(0, -1, 0),
+                                               real(0)), 3));
+  TEST_CHECK(report, isNear(intersectUnitPlane(Vec(0, -2, 0), Vec(1, 1, 0),
+                                               real(0)), 2));
+
+  // Parallel to plane, pointing away and behind `t_min`
+  TEST_CHECK(report, std::isinf(intersectUnitPlane(Vec(0, 3, 0),
+                                                   Vec(1, 0, 0), real(0))));
+  TEST_CHECK(report, std::isinf(intersectUnitPlane(Vec(0, 3, 0),
+                                                   Vec(0, 1, 0), real(0))));
+  TEST_CHECK(report, std::isinf(intersectUnitPlane(Vec(0, 3, 0),
+                                                   Vec(0, -1, 0), real(4))));
+}
+
+void runIntersectionTests(TestReport& report)
+{
+  testSphere(report);
+  testBox(report);
+  testPlane(report);
+}
@@ -0,0 +1,72 @@
+/**
+ * @file main.cpp
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Test runner. Failed checks go to stderr, exit code is non-zero
+ * if any check failed.
+ *
+ * @version 0.1
+ * @date 2023-10-04
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "test.h"
+
+int main()
+{
+  TestReport report;
+  runThreadPoolTests  (report);
+  runIntersectionTests(report);
+  runBvhTests         (report);
+  runChunkedArrayTests(report);
+  runSceneFileTests   (report);
+  runTripleBufferTests(report);
+  runRenderTests      (report);
+
+  fprintf(stderr, "%zu checks, %zu failed\n",
+                  report.checks(), report.failures());
+
+  return report.failures() == 0 ? 0 : 1;
+}
+
+std::string getTempPath()
+{
+  char path[] = "/tmp/ray_trace_test_XXXXXX";
+  const int fd = mkstemp(path);
+  if (fd < 0)
+  {
+    fprintf(stderr, "Failed to create temporary file\n");
+    exit(1);
+  }
+  close(fd);
+  return path;
+}
+
+QuietStderr::QuietStderr() :
+  m_savedFd(-1)
+{
+  fflush(stderr);
+  m_savedFd = dup(STDERR_FILENO);
+
+  const int null_fd = open("/dev/null", O_WRONLY);
+  if (null_fd >= 0)
+  {
+    dup2(null_fd, STDERR_FILENO);
+    close(null_fd);
+  }
+}
+
+QuietStderr::~QuietStderr()
+{
+  fflush(stderr);
+  if (m_savedFd >= 0)
+  {
+    dup2(m_savedFd, STDERR_FILENO);
+    close(m_savedFd);
+  }
+}
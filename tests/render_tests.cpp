@@ -0,0 +1,102 @@
+/**
+ * @file render_tests.cpp
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Tests of renderer producing the same image for any thread count
+ *
+ * @version 0.1
+ * @date 2023-10-04
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#include <cstring>
+#include <vector>
+
+#include "ray_trace/renderer.h"
+#include "ray_trace/scene.h"
+#include "scenes/demo_scene.h"
+
+#include "test.h"
+
+/**
+ * @brief Renderer configuration, tested with different thread counts
+ */
+struct RenderMode
+{
+  const char* name;
+  bool        packets;
+  bool        wavefront;
+  bool        sorting;
+  bool        pathTracing;
+  bool        progressive;
+  bool        incremental;
+  size_t      lightSamples;
+};
+
+static const size_t IMAGE_WIDTH  = 64;
+static const size_t IMAGE_HEIGHT = 40;
+
+/**
+ * @brief Frames of `mode` rendered with `thread_count` threads, one object
+ * moves between frames
+ */
+static std::vector<Pixel> renderFrames(const RenderMode& mode,
+                                       size_t thread_count)
+{
+  Scene scene(getDemoCamera());
+  populateShowcaseScene(scene);
+
+  Renderer renderer(IMAGE_WIDTH, IMAGE_HEIGHT, thread_count);
+  renderer.setSampleGrid(2);
+  renderer.setLightSamples(mode.lightSamples);
+  renderer.setPacketTracing(mode.packets);
+  renderer.setWavefront(mode.wavefront);
+  renderer.setCoherenceSorting(mode.sorting);
+  renderer.setPathTracing(mode.pathTracing);
+  renderer.setProgressive(mode.progressive);
+  renderer.setIncremental(mode.incremental);
+
+  std::vector<Pixel> frames;
+  for (size_t frame = 0; frame < 3; ++frame)
+  {
+    if (frame == 2)
+    {
+      Transform transform = scene.transform(0);
+      transform.move(Vec(real(0.3), 0, 0));
+      scene.setTransform(0, transform);
+    }
+
+    renderer.renderScene(scene);
+    frames.insert(frames.end(), renderer.pixels(),
+                  renderer.pixels() + IMAGE_WIDTH * IMAGE_HEIGHT);
+  }
+
+  return frames;
+}
+
+static void testThreadCounts(TestReport& report)
+{
+  const RenderMode modes[] = {
+    {"render_threads_scalar",      false, false, false, false, false, false, 1},
+    {"render_threads_packets",     true,  false, false, false, false, false, 1},
+    {"render_threads_wavefront",   false, true,  true,  false, false, false, 4},
+    {"render_threads_progressive", false, false, false, false, true,  true,  4},
+    {"render_threads_paths",       false, true,  false, true,  true,  false, 1},
+  };
+
+  for (const RenderMode& mode : modes)
+  {
+    report.begin(mode.name);
+
+    const std::vector<Pixel> single = renderFrames(mode, 1);
+    const std::vector<Pixel> multi  = renderFrames(mode, 3);
+    TEST_CHECK(report, single.size() == multi.size());
+    TEST_CHECK(report, memcmp(single.data(), multi.data(),
+                              single.size() * sizeof(Pixel)) == 0);
+  }
+}
+
+void runRenderTests(TestReport& report)
+{
+  testThreadCounts(report);
+}
@@ -0,0 +1,307 @@
+/**
+ * @file scene_file_tests.cpp
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Tests of text and compiled scene files, including damaged ones
+ *
+ * @version 0.1
+ * @date 2023-10-04
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "ray_trace/renderer.h"
+#include "ray_trace/scene.h"
+#include "ray_trace/scene_file.h"
+#include "scenes/demo_scene.h"
+
+#include "test.h"
+
+/**
+ * @brief Leading fields of compiled scene header, whose layout does not
+ * depend on build
+ */
+struct CompiledPrefix
+{
+  char     magic[8];
+  uint32_t version;
+  uint32_t realSize;
+  uint32_t transformSize;
+  uint32_t materialSize;
+  uint64_t objectCount;
+  uint64_t typesOffset;
+  uint64_t transformsOffset;
+  uint64_t materialIdsOffset;
+};
+
+static std::vector<char> readFile(const char* path)
+{
+  std::vector<char> contents;
+  FILE* file = fopen(path, "rb");
+  if (!file)
+    return contents;
+
+  char buffer[4096];
+  size_t count = 0;
+  while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    contents.insert(contents.end(), buffer, buffer + count);
+
+  fclose(file);
+  return contents;
+}
+
+static void writeFile(const char* path, const char* data, size_t size)
+{
+  FILE* file = fopen(path, "wb");
+  if (!file)
+    return;
+
+  fwrite(data, 1, size, file);
+  fclose(file);
+}
+
+/**
+ * @brief Small image of `scene`, identical for identical scenes
+ */
+static std::vector<Pixel> renderImage(const Scene& scene)
+{
+  const size_t width  = 48;
+  const size_t height = 30;
+
+  Renderer renderer(width, height, 1);
+  renderer.renderScene(scene);
+  return std::vector<Pixel>(renderer.pixels(),
+                            renderer.pixels() + width * height);
+}
+
+static bool isSameScene(const Scene& scene, const Scene& other)
+{
+  if (scene.objectCount() != other.objectCount())
+    return false;
+
+  for (size_t i = 0; i < scene.objectCount(); ++i)
+    if (scene.objectType(i) != other.objectType(i))
+      return false;
+
+  const std::vector<Pixel> image       = renderImage(scene);
+  const std::vector<Pixel> other_image = renderImage(other);
+  return memcmp(image.data(), other_image.data(),
+                image.size() * sizeof(Pixel)) == 0;
+}
+
+static void testTextRoundTrip(TestReport& report)
+{
+  report.begin("scene_file_text_round_trip");
+
+  Scene scene(getDemoCamera());
+  populateShowcaseScene(scene);
+
+  const std::string path = getTempPath();
+  TEST_CHECK(report, writeSceneText(path.c_str(), scene));
+
+  Scene loaded(getDemoCamera());
+  TEST_CHECK(report, readSceneText(path.c_str(), loaded));
+  TEST_CHECK(report, isSameScene(scene, loaded));
+
+  // Loading caches compiled scene next to text, where builds support it
+  Scene cached(getDemoCamera());
+  TEST_CHECK(report, loadScene(path.c_str(), cached));
+  TEST_CHECK(report, isSameScene(scene, cached));
+
+  remove(path.c_str());
+  remove((path + ".bin").c_str());
+}
+
+static void testTextErrors(TestReport& report)
+{
+  report.begin("scene_file_text_errors");
+
+  // Each scene is broken in one line
+  const char* broken_scenes[] = {
+    "sphere position 1 2\n",
+    "sphere position a b c\n",
+    "sphere color 1 1\n",
+    "cylinder position 0 0 0\n",
+    "sphere material missing\n",
+    "material shiny diffusion\n",
+    "camera fov\n",
+    "mesh\n"
+  };
+
+  const std::string path = getTempPath();
+  for (const char* text : broken_scenes)
+  {
+    writeFile(path.c_str(), text, strlen(text));
+
+    bool is_accepted = false;
+    {
+      QuietStderr quiet;
+      Scene scene(getDemoCamera());
+      is_accepted = readSceneText(path.c_str(), scene);
+    }
+
+    if (!TEST_CHECK(report, !is_accepted))
+      fprintf(stderr, "  accepted: %s", text);
+  }
+
+  // Missing file is an error as well
+  remove(path.c_str());
+  bool is_missing_accepted = false;
+  {
+    QuietStderr quiet;
+    Scene scene(getDemoCamera());
+    is_missing_accepted = readSceneText(path.c_str(), scene);
+  }
+  TEST_CHECK(report, !is_missing_accepted);
+
+  // Text cut at any byte never breaks parser
+  Scene showcase(getDemoCamera());
+  populateShowcaseScene(showcase);
+  TEST_CHECK(report, writeSceneText(path.c_str(), showcase));
+
+  const std::vector<char> contents = readFile(path.c_str());
+  size_t extra_objects = 0;
+  for (size_t size = 0; size < contents.size(); size += 7)
+  {
+    writeFile(path.c_str(), contents.data(), size);
+
+    QuietStderr quiet;
+    Scene truncated(getDemoCamera());
+    if (readSceneText(path.c_str(), truncated)
+     && truncated.objectCount() > showcase.objectCount())
+      ++extra_objects;
+  }
+  TEST_CHECK(report, extra_objects == 0);
+
+  remove(path.c_str());
+}
+
+#ifndef RAY_TRACE_CHECKED_MATH
+
+static void testCompiledRoundTrip(TestReport& report)
+{
+  report.begin("scene_file_compiled_round_trip");
+
+  Scene scene(getDemoCamera());
+  populateShowcaseScene(scene);
+
+  const std::string path = getTempPath();
+  TEST_CHECK(report, writeCompiledScene(path.c_str(), scene));
+
+  Scene mapped(getDemoCamera());
+  TEST_CHECK(report, mapCompiledScene(path.c_str(), mapped));
+  TEST_CHECK(report, isSameScene(scene, mapped));
+
+  // Only empty scenes can adopt mapped objects
+  TEST_CHECK(report, !mapCompiledScene(path.c_str(), mapped));
+
+  // Snapshot of mapped scene outlives it
+  Scene snapshot(getDemoCamera());
+  {
+    Scene source(getDemoCamera());
+    TEST_CHECK(report, mapCompiledScene(path.c_str(), source));
+    snapshot.assign(source);
+  }
+  TEST_CHECK(report, isSameScene(scene, snapshot));
+
+  remove(path.c_str());
+}
+
+static void testCompiledErrors(TestReport& report)
+{
+  report.begin("scene_file_compiled_errors");
+
+  Scene scene(getDemoCamera());
+  populateShowcaseScene(scene);
+
+  const std::string path = getTempPath();
+  TEST_CHECK(report, writeCompiledScene(path.c_str(), scene));
+  const std::vector<char> contents = readFile(path.c_str());
+  TEST_CHECK(report, contents.size() > sizeof(CompiledPrefix));
+
+  // File cut at any byte is rejected
+  size_t accepted = 0;
+  for (size_t size = 0; size < contents.size(); ++size)
+  {
+    writeFile(path.c_str(), contents.data(), size);
+
+    Scene truncated(getDemoCamera());
+    accepted += mapCompiledScene(path.c_str(), truncated);
+  }
+  TEST_CHECK(report, accepted == 0);
+
+  CompiledPrefix prefix = {};
+  memcpy(&prefix, contents.data(), sizeof(prefix));
+
+  // Damage one field at a time
+  const uint32_t bad_type        = 17;
+  const uint32_t bad_material_id = 0x7FFFFFF0;
+  const uint64_t bad_count       = uint64_t(1) << 40;
+  const uint64_t bad_offset      = prefix.typesOffset + 1;
+  const struct
+  {
+    size_t      offset;
+    const void* value;
+    size_t      size;
+  } damages[] = {
+    {offsetof(CompiledPrefix, magic),       "RTSCENX",        8},
+    {offsetof(CompiledPrefix, version),     &bad_type,        4},
+    {offsetof(CompiledPrefix, realSize),    &bad_type,        4},
+    {offsetof(CompiledPrefix, objectCount), &bad_count,       8},
+    {offsetof(CompiledPrefix, typesOffset), &bad_offset,      8},
+    {size_t(prefix.typesOffset),            &bad_type,        1},
+    {size_t(prefix.materialIdsOffset),      &bad_material_id, 4},
+  };
+
+  for (const auto& damage : damages)
+  {
+    std::vector<char> damaged = contents;
+    memcpy(damaged.data() + damage.offset, damage.value, damage.size);
+    writeFile(path.c_str(), damaged.data(), damaged.size());
+
+    Scene corrupted(getDemoCamera());
+    TEST_CHECK(report, !mapCompiledScene(path.c_str(), corrupted));
+    TEST_CHECK(report, corrupted.objectCount() == 0);
+  }
+
+  remove(path.c_str());
+}
+
+#else
+
+static void testCompiledRoundTrip(TestReport& report)
+{
+  report.begin("scene_file_compiled_disabled");
+
+  // Checked math types are not plain bytes, so nothing is compiled
+  Scene scene(getDemoCamera());
+  populateShowcaseScene(scene);
+
+  const std::string path = getTempPath();
+  TEST_CHECK(report, !writeCompiledScene(path.c_str(), scene));
+
+  Scene mapped(getDemoCamera());
+  TEST_CHECK(report, !mapCompiledScene(path.c_str(), mapped));
+
+  remove(path.c_str());
+}
+
+static void testCompiledErrors(TestReport&)
+{
+}
+
+#endif
+
+void runSceneFileTests(TestReport& report)
+{
+  testTextRoundTrip(report);
+  testTextErrors(report);
+  testCompiledRoundTrip(report);
+  testCompiledErrors(report);
+}
@@ -0,0 +1,102 @@
+/**
+ * @file test.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Minimal test harness counting failed checks
+ *
+ * @version 0.1
+ * @date 2023-10-04
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __TESTS_TEST_H
+#define __TESTS_TEST_H
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+/**
+ * @brief Failed checks of all tests, printed as they happen
+ */
+class TestReport
+{
+public:
+  TestReport() : m_test(), m_checks(0), m_failures(0) {}
+
+  TestReport(const TestReport& other) = delete;
+  TestReport& operator=(const TestReport& other) = delete;
+
+  ~TestReport() = default;
+
+  /**
+   * @brief Attribute following checks to test `name`
+   */
+  void begin(const char* name)
+  {
+    m_test = name;
+    fprintf(stderr, "%s\n", name);
+  }
+
+  /**
+   * @brief Count check of `expression` at `file`:`line`, reporting it
+   * unless it `passed`
+   *
+   * @return `passed`
+   */
+  bool check(bool passed, const char* expression, const char* file, int line)
+  {
+    ++m_checks;
+    if (passed)
+      return true;
+
+    ++m_failures;
+    fprintf(stderr, "  %s:%d: %s: check failed: %s\n",
+                    file, line, m_test.c_str(), expression);
+    return false;
+  }
+
+  size_t checks()   const { return m_checks; }
+  size_t failures() const { return m_failures; }
+
+private:
+  std::string m_test;
+  size_t      m_checks;
+  size_t      m_failures;
+};
+
+#define TEST_CHECK(report, condition) \
+  (report).check(bool(condition), #condition, __FILE__, __LINE__)
+
+/**
+ * @brief Discard stderr while alive, so that errors reported by tested
+ * code on purpose do not bury failed checks
+ */
+class QuietStderr
+{
+public:
+  QuietStderr();
+
+  QuietStderr(const QuietStderr& other) = delete;
+  QuietStderr& operator=(const QuietStderr& other) = delete;
+
+  ~QuietStderr();
+
+private:
+  int m_savedFd;
+};
+
+/**
+ * @brief Name of a new temporary file, removed by caller
+ */
+std::string getTempPath();
+
+void runThreadPoolTests   (TestReport& report);
+void runIntersectionTests (TestReport& report);
+void runBvhTests          (TestReport& report);
+void runChunkedArrayTests (TestReport& report);
+void runSceneFileTests    (TestReport& report);
+void runTripleBufferTests (TestReport& report);
+void runRenderTests       (TestReport& report);
+
+#endif /* test.h */
@@ -0,0 +1,110 @@
+/**
+ * @file thread_pool_tests.cpp
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Tests of task completion and work stealing in thread pool
+ *
+ * @version 0.1
+ * @date 2023-10-04
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "ray_trace/thread_pool.h"
+
+#include "test.h"
+
+static void testCompletion(TestReport& report)
+{
+  report.begin("thread_pool_completion");
+
+  ThreadPool pool(4);
+  TEST_CHECK(report, pool.threadCount() == 4);
+
+  // Batches of different sizes, including fewer tasks than workers
+  const size_t task_counts[] = {0, 1, 3, 4, 1000};
+  for (size_t task_count : task_counts)
+  {
+    std::unique_ptr<std::atomic<size_t>[]> runs(
+                                      new std::atomic<size_t>[task_count]);
+    for (size_t i = 0; i < task_count; ++i)
+      runs[i] = 0;
+
+    std::atomic<bool> has_bad_worker(false);
+    pool.run(task_count, [&](size_t task_index, size_t worker_index)
+    {
+      if (worker_index >= pool.threadCount())
+        has_bad_worker = true;
+      ++runs[task_index];
+    });
+
+    // Every task ran exactly once before `run()` returned
+    size_t exact_runs = 0;
+    for (size_t i = 0; i < task_count; ++i)
+      exact_runs += runs[i] == 1;
+
+    TEST_CHECK(report, exact_runs == task_count);
+    TEST_CHECK(report, !has_bad_worker);
+  }
+}
+
+static void testStealing(TestReport& report)
+{
+  report.begin("thread_pool_stealing");
+
+  // Worker 0 owns tasks [0, 4), worker 1 owns [4, 8). Task 0 blocks its
+  // worker until tasks 1 to 3 are done, which only some other worker can
+  // do by stealing them.
+  ThreadPool pool(2);
+  const size_t task_count = 8;
+
+  std::atomic<size_t> blocked_done(0);
+  std::atomic<bool>   has_timed_out(false);
+  std::vector<size_t> workers(task_count, size_t(-1));
+
+  pool.run(task_count, [&](size_t task_index, size_t worker_index)
+  {
+    workers[task_index] = worker_index;
+    if (task_index == 0)
+    {
+      const auto deadline = std::chrono::steady_clock::now()
+                          + std::chrono::seconds(10);
+      while (blocked_done < 3)
+      {
+        if (std::chrono::steady_clock::now() > deadline)
+        {
+          has_timed_out = true;
+          break;
+        }
+        std::this_thread::yield();
+      }
+    }
+    else if (task_index < 4)
+      ++blocked_done;
+  });
+
+  TEST_CHECK(report, !has_timed_out);
+
+  // Either worker 1 stole tasks 1 to 3 while task 0 was blocked, or it
+  // got to task 0 first, stealing it together with the rest
+  size_t stolen = 0;
+  for (size_t i = 0; i < task_count; ++i)
+    stolen += workers[i] != (i < task_count / 2 ? 0 : 1);
+  TEST_CHECK(report, stolen > 0);
+
+  // Pool stays usable after stealing
+  std::atomic<size_t> runs(0);
+  pool.run(task_count, [&](size_t, size_t) { ++runs; });
+  TEST_CHECK(report, runs == task_count);
+}
+
+void runThreadPoolTests(TestReport& report)
+{
+  testCompletion(report);
+  testStealing(report);
+}
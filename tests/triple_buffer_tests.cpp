@@ -0,0 +1,101 @@
+/**
+ * @file triple_buffer_tests.cpp
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Tests of handing values over through triple buffer
+ *
+ * @version 0.1
+ * @date 2023-10-04
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#include <thread>
+
+#include "ray_trace/triple_buffer.h"
+
+#include "test.h"
+
+static void testHandoff(TestReport& report)
+{
+  report.begin("triple_buffer_handoff");
+
+  TripleBuffer<int> buffer(0);
+  TEST_CHECK(report, !buffer.hasFresh());
+  TEST_CHECK(report, !buffer.take());
+
+  buffer.back() = 1;
+  buffer.publish();
+  TEST_CHECK(report, buffer.hasFresh());
+  TEST_CHECK(report, buffer.take());
+  TEST_CHECK(report, buffer.front() == 1);
+  TEST_CHECK(report, !buffer.take());
+
+  // Writer never gets reader's slot
+  buffer.back() = 2;
+  TEST_CHECK(report, buffer.front() == 1);
+
+  // Values published before reader gets to them are dropped
+  buffer.publish();
+  buffer.back() = 3;
+  buffer.publish();
+  TEST_CHECK(report, buffer.take());
+  TEST_CHECK(report, buffer.front() == 3);
+  TEST_CHECK(report, !buffer.hasFresh());
+}
+
+static void testConcurrentHandoff(TestReport& report)
+{
+  report.begin("triple_buffer_concurrent_handoff");
+
+  // Writer publishes growing values, each filling its slot as a whole
+  struct Value
+  {
+    int number;
+    int copy;
+
+    Value() : number(0), copy(0) {}
+  };
+
+  const int last = 200000;
+  TripleBuffer<Value> buffer;
+
+  std::thread writer([&buffer]()
+  {
+    for (int i = 1; i <= last; ++i)
+    {
+      buffer.back().number = i;
+      buffer.back().copy   = i;
+      buffer.publish();
+    }
+  });
+
+  // Reader sees values in order, never torn, and gets the last one
+  int  previous    = 0;
+  bool is_ordered  = true;
+  bool is_whole    = true;
+  while (previous != last)
+  {
+    if (!buffer.take())
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    const Value& value = buffer.front();
+    is_ordered = is_ordered && value.number > previous;
+    is_whole   = is_whole   && value.copy == value.number;
+    previous   = value.number;
+  }
+
+  writer.join();
+
+  TEST_CHECK(report, is_ordered);
+  TEST_CHECK(report, is_whole);
+  TEST_CHECK(report, !buffer.take());
+}
+
+void runTripleBufferTests(TestReport& report)
+{
+  testHandoff(report);
+  testConcurrentHandoff(report);
+}
@@ -0,0 +1,280 @@
+/**
+ * @file batch_render.cpp
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Headless renderer for batch jobs. Renders several frames of a
+ * built-in or loaded scene, saves them to disk and reports timing
+ * statistics.
+ *
+ * @version 0.1
+ * @date 2023-09-26
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+#include "ray_trace/image_writer.h"
+#include "ray_trace/renderer.h"
+#include "ray_trace/scene.h"
+#include "ray_trace/scene_file.h"
+#include "scenes/demo_scene.h"
+
+struct BatchOptions
+{
+  size_t      width;
+  size_t      height;
+  size_t      samples;
+  size_t      frames;
+  size_t      threads;
+  size_t      lightSamples;
+  size_t      reflections;
+  const char* output;
+  const char* format;
+  const char* scene;
+  double      adaptiveThreshold;
+  double      reflectionCutoff;
+  bool        packetTracing;
+  bool        wavefront;
+  bool        sortRays;
+  bool        pathTracing;
+  bool        dryRun;
+};
+
+static void printUsage(const char* program);
+static bool parseSize(const char* str, size_t& value);
+static bool parseThreshold(const char* str, double& value);
+static bool parseWeight(const char* str, double& value);
+static bool parseOptions(int argc, char** argv, BatchOptions& options);
+
+int main(int argc, char** argv)
+{
+  BatchOptions options = {
+    .width             = 1024,
+    .height            = 640,
+    .samples           = 4,
+    .frames            = 1,
+    .threads           = 0,
+    .lightSamples      = 0,
+    .reflections       = 2,
+    .output            = "frame",
+    .format            = "png",
+    .scene             = "showcase",
+    .adaptiveThreshold = 0,
+    .reflectionCutoff  = 1.0 / 256,
+    .packetTracing     = true,
+    .wavefront         = false,
+    .sortRays          = false,
+    .pathTracing       = false,
+    .dryRun            = false
+  };
+
+  if (!parseOptions(argc, argv, options))
+  {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  Scene scene(getDemoCamera());
+  if (strcmp(options.scene, "demo") == 0)
+    populateDemoScene(scene);
+  else if (strcmp(options.scene, "showcase") == 0)
+    populateShowcaseScene(scene);
+  else if (!loadScene(options.scene, scene))
+    return 1;
+
+  Renderer renderer(options.width, options.height, options.threads);
+  renderer.setSampleGrid(size_t(std::lround(std::sqrt(options.samples))));
+  renderer.setPacketTracing(options.packetTracing);
+  renderer.setWavefront(options.wavefront);
+  renderer.setCoherenceSorting(options.sortRays);
+  renderer.setAdaptive(options.adaptiveThreshold > 0);
+  renderer.setAdaptiveThreshold(options.adaptiveThreshold);
+  renderer.setLightSamples(options.lightSamples);
+  renderer.setMaxReflections(options.reflections);
+  renderer.setReflectionThreshold(options.reflectionCutoff);
+  renderer.setPathTracing(options.pathTracing);
+
+  // Path traced frames are noisy, each image averages all frames so far
+  renderer.setProgressive(options.pathTracing);
+
+  printf("Rendering %zu frame(s) of '%s' at %zux%zu, %zu spp, %zu thread(s)\n",
+         options.frames, options.scene, options.width, options.height,
+         renderer.samplesPerPixel(), renderer.threadCount());
+
+  using Clock = std::chrono::steady_clock;
+
+  double min_time   = INFINITY;
+  double max_time   = 0;
+  double total_time = 0;
+  double write_time = 0;
+  double setup_time = 0;
+  double light_time = 0;
+  size_t traced     = 0;
+
+  char filename[FILENAME_MAX] = "";
+  for (size_t frame = 0; frame < options.frames; ++frame)
+  {
+    const Clock::time_point render_start = Clock::now();
+    renderer.renderScene(scene);
+    const Clock::time_point render_end = Clock::now();
+
+    const double frame_time =
+        std::chrono::duration<double>(render_end - render_start).count();
+    min_time    = std::min(min_time, frame_time);
+    max_time    = std::max(max_time, frame_time);
+    total_time += frame_time;
+    traced     += renderer.tracedSamples();
+    setup_time += renderer.frameStats().hierarchyMs;
+    light_time += renderer.frameStats().lightsMs;
+
+    if (options.dryRun)
+      continue;
+
+    snprintf(filename, sizeof(filename), "%s_%04zu.%s",
+             options.output, frame, options.format);
+    if (!writeImage(filename, renderer.pixels(),
+                    renderer.width(), renderer.height()))
+    {
+      fprintf(stderr, "Failed to write '%s'\n", filename);
+      return 1;
+    }
+
+    write_time += std::chrono::duration<double>(Clock::now() - render_end)
+                    .count();
+  }
+
+  const double pixel_count = double(options.width * options.height);
+  const double ray_count   = double(traced) / options.frames;
+  const double avg_time    = total_time / options.frames;
+
+  printf("Frame time:   min %.3f ms, avg %.3f ms, max %.3f ms\n",
+         min_time * 1e3, avg_time * 1e3, max_time * 1e3);
+  printf("Total render: %.3f s, writing: %.3f s\n", total_time, write_time);
+  printf("Setup:        hierarchy %.3f ms, lights %.3f ms (%zu light(s))\n",
+         setup_time, light_time, renderer.frameStats().lightCount);
+  printf("Samples:      %.2f per pixel on average\n",
+         ray_count / pixel_count);
+  printf("Throughput:   %.2f Mrays/s (primary), %.1f ns/pixel\n",
+         ray_count / avg_time * 1e-6, avg_time / pixel_count * 1e9);
+
+  return 0;
+}
+
+static void printUsage(const char* program)
+{
+  fprintf(stderr,
+    "Usage: %s [options]\n"
+    "  -w WIDTH    image width in pixels (default 1024)\n"
+    "  -h HEIGHT   image height in pixels (default 640)\n"
+    "  -s SAMPLES  samples per pixel, a perfect square (default 4)\n"
+    "  -a LIMIT    sample adaptively, SAMPLES is the maximum; refine pixels\n"
+    "              whose color differs from a neighbour by more than LIMIT\n"
+    "  -n FRAMES   number of frames to render (default 1)\n"
+    "  -t THREADS  render threads, 0 for all cores (default 0)\n"
+    "  -l COUNT    sample COUNT lights per shading point instead of all\n"
+    "              of them, 0 traces all lights (default 0)\n"
+    "  -r DEPTH    trace up to DEPTH mirror reflections (default 2)\n"
+    "  -c WEIGHT   cut off reflections adding less than WEIGHT of pixel\n"
+    "              color, 0 traces all (default 0.0039)\n"
+    "  -o PREFIX   output files are PREFIX_NNNN.FORMAT (default 'frame')\n"
+    "  -f FORMAT   'png' or 'ppm' (default 'png')\n"
+    "  -S SCENE    'demo', 'showcase' or path to scene file\n"
+    "              (default 'showcase')\n"
+    "  -P          trace primary rays one by one instead of in packets\n"
+    "  -W          trace tiles stage by stage over ray queues\n"
+    "  -R          with -W, sort secondary rays by origin and direction\n"
+    "  -T          path trace, averaging frames; DEPTH limits bounces\n"
+    "  -d          dry run, do not write images\n",
+    program);
+}
+
+static bool parseSize(const char* str, size_t& value)
+{
+  char* end = nullptr;
+  const unsigned long long parsed = strtoull(str, &end, 10);
+  if (end == str || *end != '\0')
+    return false;
+
+  value = size_t(parsed);
+  return true;
+}
+
+static bool parseThreshold(const char* str, double& value)
+{
+  char* end = nullptr;
+  const double parsed = strtod(str, &end);
+  if (end == str || *end != '\0' || !(parsed > 0))
+    return false;
+
+  value = parsed;
+  return true;
+}
+
+static bool parseWeight(const char* str, double& value)
+{
+  char* end = nullptr;
+  const double parsed = strtod(str, &end);
+  if (end == str || *end != '\0' || !(parsed >= 0 && parsed <= 1))
+    return false;
+
+  value = parsed;
+  return true;
+}
+
+static bool parseOptions(int argc, char** argv, BatchOptions& options)
+{
+  int option = 0;
+  while ((option = getopt(argc, argv, "w:h:s:a:n:t:l:r:c:o:f:S:PWRTd")) != -1)
+  {
+    bool valid = true;
+    switch (option)
+    {
+    case 'w': valid = parseSize(optarg, options.width);   break;
+    case 'h': valid = parseSize(optarg, options.height);  break;
+    case 's': valid = parseSize(optarg, options.samples); break;
+    case 'a': valid = parseThreshold(optarg, options.adaptiveThreshold);
+              break;
+    case 'n': valid = parseSize(optarg, options.frames);  break;
+    case 't': valid = parseSize(optarg, options.threads); break;
+    case 'l': valid = parseSize(optarg, options.lightSamples); break;
+    case 'r': valid = parseSize(optarg, options.reflections);  break;
+    case 'c': valid = parseWeight(optarg, options.reflectionCutoff); break;
+    case 'o': options.output = optarg; break;
+    case 'f': options.format = optarg; break;
+    case 'S': options.scene  = optarg; break;
+    case 'P': options.packetTracing = false; break;
+    case 'W': options.wavefront     = true;  break;
+    case 'R': options.sortRays      = true;  break;
+    case 'T': options.pathTracing   = true;  break;
+    case 'd': options.dryRun        = true;  break;
+    default:  return false;
+    }
+
+    if (!valid)
+      return false;
+  }
+
+  if (options.width == 0 || options.height == 0 || options.frames == 0)
+    return false;
+
+  const size_t grid = size_t(std::lround(std::sqrt(options.samples)));
+  if (options.samples == 0 || grid * grid != options.samples)
+  {
+    fprintf(stderr, "Sample count must be a perfect square\n");
+    return false;
+  }
+
+  if (strcmp(options.format, "png") != 0 && strcmp(options.format, "ppm") != 0)
+  {
+    fprintf(stderr, "Unknown image format '%s'\n", options.format);
+    return false;
+  }
+
+  return optind == argc;
+}